@@ -130,6 +130,12 @@ typedef struct BenchmarkTimeStamps {
 static BenchmarkTimeStamps get_benchmark_time_stamps(void);
 static int64_t getmaxrss(void);
 static int ifilter_has_all_input_formats(FilterGraph *fg);
+#if HAVE_THREADS
+static void enc_thread_stop(OutputStream *ost);
+
+/* output streams in the order frames were sent to their encoder threads */
+static AVFifo *enc_jobs;
+#endif
 
 static int64_t nb_frames_dup = 0;
 static uint64_t dup_warning = 1000;
@@ -572,6 +578,9 @@ static void ffmpeg_cleanup(int ret)
         if (!ost)
             continue;
 
+#if HAVE_THREADS
+        enc_thread_stop(ost);
+#endif
         av_bsf_free(&ost->bsf_ctx);
 
         av_frame_free(&ost->filtered_frame);
@@ -603,6 +612,7 @@ static void ffmpeg_cleanup(int ret)
         av_freep(&output_streams[i]);
     }
 #if HAVE_THREADS
+    av_fifo_freep2(&enc_jobs);
     free_input_threads();
 #endif
     for (i = 0; i < nb_input_files; i++) {
@@ -635,6 +645,7 @@ static void ffmpeg_cleanup(int ret)
     }
     av_freep(&vstats_filename);
     av_freep(&filter_nbthreads);
+    av_buffer_unref(&thread_pool);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -889,6 +900,260 @@ static void update_video_stats(OutputStream *ost, const AVPacket *pkt, int write
     fprintf(vstats_file, "type= %c\n", av_get_picture_type_char(ost->pict_type));
 }
 
+static void output_encoded_packet(OutputFile *of, OutputStream *ost,
+                                  AVPacket *pkt)
+{
+    AVCodecContext   *enc = ost->enc_ctx;
+    const char *type_desc = av_get_media_type_string(enc->codec_type);
+
+    if (debug_ts) {
+        av_log(NULL, AV_LOG_INFO, "encoder -> type:%s "
+               "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s "
+               "duration:%s duration_time:%s\n",
+               type_desc,
+               av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
+               av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base),
+               av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, &enc->time_base));
+    }
+
+    av_packet_rescale_ts(pkt, enc->time_base, ost->mux_timebase);
+
+    if (debug_ts) {
+        av_log(NULL, AV_LOG_INFO, "encoder -> type:%s "
+               "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s "
+               "duration:%s duration_time:%s\n",
+               type_desc,
+               av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
+               av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base),
+               av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, &enc->time_base));
+    }
+
+    if (enc->codec_type == AVMEDIA_TYPE_VIDEO)
+        update_video_stats(ost, pkt, !!vstats_filename);
+
+    ost->packets_encoded++;
+
+    output_packet(of, pkt, ost, 0);
+}
+
+#if HAVE_THREADS
+static void *encoder_thread(void *arg)
+{
+    OutputStream     *ost = arg;
+    AVCodecContext   *enc = ost->enc_ctx;
+    const char *type_desc = av_get_media_type_string(enc->codec_type);
+    AVFrame *frame;
+    AVPacket *pkt;
+    int ret;
+
+    while (1) {
+        ret = av_thread_message_queue_recv(ost->enc_queue, &frame, 0);
+        if (ret < 0)
+            break;
+
+        ret = avcodec_send_frame(enc, frame);
+        av_frame_free(&frame);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Error submitting %s frame to the encoder\n",
+                   type_desc);
+            break;
+        }
+
+        while (1) {
+            pkt = av_packet_alloc();
+            if (!pkt) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+
+            ret = avcodec_receive_packet(enc, pkt);
+
+            /* if two pass, output log on success */
+            if (ret >= 0 && ost->logfile && enc->stats_out)
+                fprintf(ost->logfile, "%s", enc->stats_out);
+
+            if (ret >= 0)
+                ret = av_thread_message_queue_send(ost->enc_out_queue, &pkt, 0);
+            if (ret < 0) {
+                av_packet_free(&pkt);
+                break;
+            }
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            if (ret != AVERROR_EOF)
+                av_log(NULL, AV_LOG_ERROR, "%s encoding failed\n", type_desc);
+            break;
+        }
+
+        /* a NULL packet ends the output for this frame */
+        ret = av_thread_message_queue_send(ost->enc_out_queue, &pkt, 0);
+        if (ret < 0)
+            break;
+    }
+
+    av_thread_message_queue_set_err_send(ost->enc_queue, ret);
+    av_thread_message_queue_set_err_recv(ost->enc_out_queue, ret);
+
+    return NULL;
+}
+
+/*
+ * Write out the packets of the frames sent to the encoder threads, in the
+ * order the frames were sent, so that the muxers get the same packets in the
+ * same order as if the frames had been encoded in place.
+ * Without wait, stop at the first frame that is still being encoded. With
+ * wait, wait for the frames to be encoded, up to the first frame sent to
+ * until, or all of them if until is NULL.
+ */
+static void enc_threads_drain(int wait, const OutputStream *until)
+{
+    OutputStream *ost;
+
+    if (!enc_jobs)
+        return;
+
+    while (av_fifo_peek(enc_jobs, &ost, 1, 0) >= 0) {
+        OutputFile *of = output_files[ost->file_index];
+        AVPacket *pkt;
+        int ret;
+
+        while ((ret = av_thread_message_queue_recv(ost->enc_out_queue, &pkt,
+                                                   wait ? 0 : AV_THREAD_MESSAGE_NONBLOCK)) >= 0 &&
+               pkt) {
+            output_encoded_packet(of, ost, pkt);
+            av_packet_free(&pkt);
+        }
+        if (ret == AVERROR(EAGAIN))
+            return;
+        if (ret < 0)
+            exit_program(1);
+
+        av_fifo_drain2(enc_jobs, 1);
+        if (ost == until)
+            return;
+    }
+}
+
+static int enc_thread_submit(OutputStream *ost, AVFrame *frame)
+{
+    AVFrame *queue_frame = av_frame_clone(frame);
+    int ret;
+
+    if (!queue_frame)
+        return AVERROR(ENOMEM);
+
+    ret = av_thread_message_queue_send(ost->enc_queue, &queue_frame,
+                                       AV_THREAD_MESSAGE_NONBLOCK);
+    if (ret == AVERROR(EAGAIN)) {
+        /* once the oldest frame queued to this encoder is done, the thread
+         * takes the next one and there is room for this frame */
+        enc_threads_drain(1, ost);
+        ret = av_thread_message_queue_send(ost->enc_queue, &queue_frame, 0);
+    }
+    if (ret < 0) {
+        av_frame_free(&queue_frame);
+        return ret;
+    }
+
+    return av_fifo_write(enc_jobs, &ost, 1);
+}
+
+static void free_queued_frame(void *msg)
+{
+    av_frame_free((AVFrame **)msg);
+}
+
+static void free_queued_packet(void *msg)
+{
+    av_packet_free((AVPacket **)msg);
+}
+
+/*
+ * -fs checks the size of what has been encoded so far and the PSNR is
+ * read from the encoder context while encoding, so those encoders are run
+ * from the main thread.
+ */
+static int enc_thread_possible(const OutputStream *ost)
+{
+    const OutputFile *of = output_files[ost->file_index];
+
+    return ost->encoding_needed &&
+           (ost->enc->type == AVMEDIA_TYPE_VIDEO ||
+            ost->enc->type == AVMEDIA_TYPE_AUDIO) &&
+           of->thread_queue_size && of->limit_filesize == UINT64_MAX &&
+           !(ost->enc_ctx->flags & AV_CODEC_FLAG_PSNR);
+}
+
+static int enc_thread_start(OutputStream *ost)
+{
+    OutputFile *of = output_files[ost->file_index];
+    int queue_size = of->thread_queue_size < 0 ? 8 : of->thread_queue_size;
+    int nb_encoders = 0, ret;
+
+    for (int i = 0; i < nb_output_streams; i++)
+        nb_encoders += enc_thread_possible(output_streams[i]);
+    /* a single encoder has nothing to run in parallel with */
+    if (nb_encoders < 2 || !enc_thread_possible(ost) || do_benchmark_all)
+        return 0;
+
+    if (!enc_jobs) {
+        enc_jobs = av_fifo_alloc2(nb_encoders * queue_size, sizeof(ost),
+                                  AV_FIFO_FLAG_AUTO_GROW);
+        if (!enc_jobs)
+            return AVERROR(ENOMEM);
+    }
+
+    ret = av_thread_message_queue_alloc(&ost->enc_queue, queue_size,
+                                        sizeof(AVFrame *));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(ost->enc_queue, free_queued_frame);
+
+    /* room for one packet and the end marker of each queued frame */
+    ret = av_thread_message_queue_alloc(&ost->enc_out_queue, 2 * queue_size,
+                                        sizeof(AVPacket *));
+    if (ret < 0)
+        goto fail;
+    av_thread_message_queue_set_free_func(ost->enc_out_queue, free_queued_packet);
+
+    if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        ret = AVERROR(ret);
+        goto fail;
+    }
+
+    return 0;
+fail:
+    av_thread_message_queue_free(&ost->enc_queue);
+    av_thread_message_queue_free(&ost->enc_out_queue);
+    return ret;
+}
+
+static void enc_thread_stop(OutputStream *ost)
+{
+    if (!ost->enc_queue)
+        return;
+
+    av_thread_message_queue_set_err_recv(ost->enc_queue, AVERROR_EOF);
+    av_thread_message_queue_set_err_send(ost->enc_out_queue, AVERROR_EOF);
+    pthread_join(ost->enc_thread, NULL);
+
+    av_thread_message_queue_free(&ost->enc_queue);
+    av_thread_message_queue_free(&ost->enc_out_queue);
+}
+
+/* wait for all queued frames to be encoded, the encoders are used from the
+ * main thread afterwards */
+static void enc_threads_stop(void)
+{
+    enc_threads_drain(1, NULL);
+
+    for (int i = 0; i < nb_output_streams; i++)
+        enc_thread_stop(output_streams[i]);
+    av_fifo_freep2(&enc_jobs);
+}
+#endif
+
 static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
 {
     AVCodecContext   *enc = ost->enc_ctx;
@@ -909,6 +1174,15 @@ static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
         }
     }
 
+#if HAVE_THREADS
+    if (ost->enc_queue) {
+        av_assert0(frame); // the threads are stopped before flushing
+        return enc_thread_submit(ost, frame);
+    }
+    /* the frames already sent to the threads are muxed first */
+    enc_threads_drain(1, NULL);
+#endif
+
     update_benchmark(NULL);
 
     ret = avcodec_send_frame(enc, frame);
@@ -938,34 +1212,7 @@ static int encode_frame(OutputFile *of, OutputStream *ost, AVFrame *frame)
             return ret;
         }
 
-        if (debug_ts) {
-            av_log(NULL, AV_LOG_INFO, "encoder -> type:%s "
-                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s "
-                   "duration:%s duration_time:%s\n",
-                   type_desc,
-                   av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
-                   av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base),
-                   av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, &enc->time_base));
-        }
-
-        av_packet_rescale_ts(pkt, enc->time_base, ost->mux_timebase);
-
-        if (debug_ts) {
-            av_log(NULL, AV_LOG_INFO, "encoder -> type:%s "
-                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s "
-                   "duration:%s duration_time:%s\n",
-                   type_desc,
-                   av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &enc->time_base),
-                   av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &enc->time_base),
-                   av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, &enc->time_base));
-        }
-
-        if (enc->codec_type == AVMEDIA_TYPE_VIDEO)
-            update_video_stats(ost, pkt, !!vstats_filename);
-
-        ost->packets_encoded++;
-
-        output_packet(of, pkt, ost, 0);
+        output_encoded_packet(of, ost, pkt);
     }
 
     av_assert0(0);
@@ -1030,6 +1277,9 @@ static void do_subtitle_out(OutputFile *of,
     pts = sub->pts;
     if (output_files[ost->file_index]->start_time != AV_NOPTS_VALUE)
         pts -= output_files[ost->file_index]->start_time;
+#if HAVE_THREADS
+    enc_threads_drain(1, NULL);
+#endif
     for (i = 0; i < nb; i++) {
         unsigned save_num_rects = sub->num_rects;
 
@@ -1361,8 +1611,15 @@ static int reap_filters(int flush)
 
             switch (av_buffersink_get_type(filter)) {
             case AVMEDIA_TYPE_VIDEO:
-                if (!ost->frame_aspect_ratio.num)
+                if (!ost->frame_aspect_ratio.num &&
+                    (enc->sample_aspect_ratio.num != filtered_frame->sample_aspect_ratio.num ||
+                     enc->sample_aspect_ratio.den != filtered_frame->sample_aspect_ratio.den)) {
+#if HAVE_THREADS
+                    /* the encoder may still be busy with earlier frames */
+                    enc_threads_drain(1, NULL);
+#endif
                     enc->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
+                }
 
                 do_video_out(of, ost, filtered_frame);
                 break;
@@ -1508,7 +1765,6 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 {
     AVBPrint buf, buf_script;
     OutputStream *ost;
-    AVFormatContext *oc;
     int64_t total_size;
     AVCodecContext *enc;
     int vid, i;
@@ -1539,11 +1795,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     t = (cur_time-timer_start) / 1000000.0;
 
 
-    oc = output_files[0]->ctx;
-
-    total_size = avio_size(oc->pb);
-    if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
-        total_size = avio_tell(oc->pb);
+    total_size = of_filesize(output_files[0]);
 
     vid = 0;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
@@ -1880,6 +2132,10 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
 
     ost->sync_opts += opkt->duration;
 
+#if HAVE_THREADS
+    /* keep the packets in the order they would be muxed without threads */
+    enc_threads_drain(1, NULL);
+#endif
     output_packet(of, opkt, ost, 0);
 
     ost->streamcopy_started = 1;
@@ -2644,6 +2900,9 @@ static int init_input_stream(int ist_index, char *error, int error_len)
             return ret;
         }
 
+        if (thread_pool && !(ist->dec_ctx->thread_pool = av_buffer_ref(thread_pool)))
+            return AVERROR(ENOMEM);
+
         if ((ret = avcodec_open2(ist->dec_ctx, codec, &ist->decoder_opts)) < 0) {
             if (ret == AVERROR_EXPERIMENTAL)
                 abort_codec_experimental(codec, 0);
@@ -3167,6 +3426,9 @@ static int init_output_stream(OutputStream *ost, AVFrame *frame,
             }
         }
 
+        if (thread_pool && !(ost->enc_ctx->thread_pool = av_buffer_ref(thread_pool)))
+            return AVERROR(ENOMEM);
+
         if ((ret = avcodec_open2(ost->enc_ctx, codec, &ost->encoder_opts)) < 0) {
             if (ret == AVERROR_EXPERIMENTAL)
                 abort_codec_experimental(codec, 1);
@@ -3236,6 +3498,17 @@ static int init_output_stream(OutputStream *ost, AVFrame *frame,
         // copy estimated duration as a hint to the muxer
         if (ost->st->duration <= 0 && ist && ist->st->duration > 0)
             ost->st->duration = av_rescale_q(ist->st->duration, ist->st->time_base, ost->st->time_base);
+
+#if HAVE_THREADS
+        if (codec->type == AVMEDIA_TYPE_VIDEO || codec->type == AVMEDIA_TYPE_AUDIO) {
+            ret = enc_thread_start(ost);
+            if (ret < 0) {
+                snprintf(error, error_len, "Error starting the encoder thread "
+                         "for output stream #%d:%d", ost->file_index, ost->index);
+                return ret;
+            }
+        }
+#endif
     } else if (ost->stream_copy) {
         ret = init_output_stream_streamcopy(ost);
         if (ret < 0)
@@ -3251,6 +3524,10 @@ static int init_output_stream(OutputStream *ost, AVFrame *frame,
 
     ost->initialized = 1;
 
+#if HAVE_THREADS
+    /* the header may be written now, along with the packets queued so far */
+    enc_threads_drain(1, NULL);
+#endif
     ret = of_check_init(output_files[ost->file_index]);
     if (ret < 0)
         return ret;
@@ -3462,11 +3739,14 @@ static int need_output(void)
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost    = output_streams[i];
         OutputFile *of       = output_files[ost->file_index];
-        AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
-        if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+        if (ost->finished)
             continue;
+        if (of->limit_filesize != UINT64_MAX) {
+            int64_t filesize = of_filesize(of);
+            if (filesize >= 0 && filesize >= of->limit_filesize)
+                continue;
+        }
         if (ost->frame_number >= ost->max_frames) {
             int j;
             for (j = 0; j < of->ctx->nb_streams; j++)
@@ -3616,6 +3896,10 @@ static int check_keyboard_interaction(int64_t cur_time)
         for(i=0;i<nb_input_streams;i++) {
             input_streams[i]->dec_ctx->debug = debug;
         }
+#if HAVE_THREADS
+        /* the encoder threads are idle once all their frames are done */
+        enc_threads_drain(1, NULL);
+#endif
         for(i=0;i<nb_output_streams;i++) {
             OutputStream *ost = output_streams[i];
             ost->enc_ctx->debug = debug;
@@ -3718,12 +4002,14 @@ static int init_input_thread(int i)
     InputFile *f = input_files[i];
 
     if (f->thread_queue_size < 0)
-        f->thread_queue_size = (nb_input_files > 1 ? 8 : 0);
+        f->thread_queue_size = 8;
     if (!f->thread_queue_size)
         return 0;
 
-    if (f->ctx->pb ? !f->ctx->pb->seekable :
-        strcmp(f->ctx->iformat->name, "lavfi"))
+    /* with a single input there is nothing else to do while waiting */
+    if (nb_input_files > 1 &&
+        (f->ctx->pb ? !f->ctx->pb->seekable :
+         strcmp(f->ctx->iformat->name, "lavfi")))
         f->non_blocking = 1;
     ret = av_thread_message_queue_alloc(&f->in_thread_queue,
                                         f->thread_queue_size, sizeof(f->pkt));
@@ -4363,6 +4649,10 @@ static int transcode(void)
         }
 
         ret = transcode_step();
+#if HAVE_THREADS
+        /* write what the encoders have finished, without waiting for them */
+        enc_threads_drain(0, NULL);
+#endif
         if (ret < 0 && ret != AVERROR_EOF) {
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
             break;
@@ -4382,6 +4672,9 @@ static int transcode(void)
             process_input_packet(ist, NULL, 0);
         }
     }
+#if HAVE_THREADS
+    enc_threads_stop();
+#endif
     flush_encoders();
 
     term_exit();
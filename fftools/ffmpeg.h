@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
@@ -581,6 +582,12 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *enc_queue;     /* frames sent to the encoder thread */
+    AVThreadMessageQueue *enc_out_queue; /* packets returned by the encoder thread */
+    pthread_t enc_thread;                /* thread running the encoder */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -598,6 +605,14 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *mux_queue;
+    pthread_t mux_thread;       /* thread writing packets to this file */
+    int thread_queue_size;      /* maximum number of queued packets */
+#endif
+    atomic_int_least64_t last_filesize;
+    atomic_int_least64_t queued_size; /* bytes queued to the muxer thread */
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -647,6 +662,9 @@ extern char *filter_nbthreads;
 extern int filter_complex_nbthreads;
 extern int vstats_version;
 extern int auto_conversion_filters;
+extern int multiscale_outputs;
+extern int thread_pool_size;
+extern AVBufferRef *thread_pool;
 
 extern const AVIOInterruptCB int_cb;
 
@@ -676,6 +694,7 @@ void check_filter_outputs(void);
 int filtergraph_is_simple(FilterGraph *fg);
 int init_simple_filtergraph(InputStream *ist, OutputStream *ost);
 int init_complex_filtergraph(FilterGraph *fg);
+int init_multiscale_filtergraphs(void);
 
 void sub2video_update(InputStream *ist, int64_t heartbeat_pts, AVSubtitle *sub);
 
@@ -703,5 +722,6 @@ void of_close(OutputFile **pof);
 
 void of_write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost,
                      int unqueue);
+int64_t of_filesize(OutputFile *of);
 
 #endif /* FFTOOLS_FFMPEG_H */
@@ -350,6 +350,193 @@ fail:
     return ret;
 }
 
+/* Return the input stream if the only filtering ost needs is an automatic
+ * scale to the size set with -s, NULL otherwise. */
+static InputStream *scale_only_source(OutputStream *ost)
+{
+    OutputFilter *ofilter = ost->filter;
+    InputStream *ist;
+
+    if (!ofilter || !filtergraph_is_simple(ofilter->graph) ||
+        ost->st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO ||
+        !ost->avfilter || strcmp(ost->avfilter, "null") ||
+        !ost->autoscale || !ofilter->width || !ofilter->height)
+        return NULL;
+
+    ist = ofilter->graph->inputs[0]->ist;
+    if (ist->st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+        return NULL;
+
+    return ist;
+}
+
+/* Serialize the swscale options of ost so they can be compared and passed
+ * on in a filtergraph description. Return 0 if they cannot be. */
+static int get_sws_opts(OutputStream *ost, AVBPrint *bprint)
+{
+    const AVDictionaryEntry *e = NULL;
+
+    av_bprint_init(bprint, 0, AV_BPRINT_SIZE_UNLIMITED);
+    while ((e = av_dict_get(ost->sws_dict, "", e, AV_DICT_IGNORE_SUFFIX))) {
+        if (strpbrk(e->key, "=:,;[]'\\") || strpbrk(e->value, "=:,;[]'\\")) {
+            av_bprint_finalize(bprint, NULL);
+            return 0;
+        }
+        av_bprintf(bprint, ":%s=%s", e->key, e->value);
+    }
+
+    return av_bprint_is_complete(bprint);
+}
+
+/* multiscale gives all its outputs the same pixel format, so only outputs
+ * whose encoders accept the same pixel formats can share it */
+static int same_pix_fmts(OutputStream *ost, OutputStream *ost2)
+{
+    AVBPrint fmts, fmts2;
+    const char *p, *p2;
+    int same;
+
+    if (ost->keep_pix_fmt || ost2->keep_pix_fmt)
+        return 0;
+
+    av_bprint_init(&fmts,  0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprint_init(&fmts2, 0, AV_BPRINT_SIZE_UNLIMITED);
+    p    = choose_pix_fmts(ost->filter,  &fmts);
+    p2   = choose_pix_fmts(ost2->filter, &fmts2);
+    same = p == p2 || (p && p2 && !strcmp(p, p2));
+    av_bprint_finalize(&fmts,  NULL);
+    av_bprint_finalize(&fmts2, NULL);
+
+    return same;
+}
+
+static void free_simple_filtergraph(FilterGraph *fg)
+{
+    InputFilter  *ifilter = fg->inputs[0];
+    OutputFilter *ofilter = fg->outputs[0];
+    InputStream  *ist     = ifilter->ist;
+    int i;
+
+    for (i = 0; i < ist->nb_filters; i++) {
+        if (ist->filters[i] == ifilter) {
+            memmove(&ist->filters[i], &ist->filters[i + 1],
+                    (ist->nb_filters - i - 1) * sizeof(*ist->filters));
+            ist->nb_filters--;
+            break;
+        }
+    }
+    av_fifo_freep2(&ifilter->frame_queue);
+    av_freep(&fg->inputs[0]);
+    av_freep(&fg->inputs);
+
+    av_channel_layout_uninit(&ofilter->ch_layout);
+    av_freep(&fg->outputs[0]);
+    av_freep(&fg->outputs);
+
+    for (i = fg->index + 1; i < nb_filtergraphs; i++) {
+        filtergraphs[i - 1] = filtergraphs[i];
+        filtergraphs[i - 1]->index = i - 1;
+    }
+    nb_filtergraphs--;
+
+    av_free(fg);
+}
+
+/*
+ * Replace the simple filtergraphs of video outputs that only scale the same
+ * input stream to different sizes, with the same scaler options and pixel
+ * formats, by a single multiscale filter, so that the input frames are read
+ * once and the smaller sizes are scaled down from the larger ones.
+ */
+int init_multiscale_filtergraphs(void)
+{
+    OutputStream **ladder;
+    int i, j, ret = 0;
+
+    if (!avfilter_get_by_name("multiscale"))
+        return 0;
+
+    ladder = av_malloc_array(nb_output_streams, sizeof(*ladder));
+    if (!ladder)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        InputStream  *ist = scale_only_source(ost);
+        AVBPrint opts, desc;
+        FilterGraph *fg;
+        int nb_ladder = 0;
+
+        if (!ist || !get_sws_opts(ost, &opts))
+            continue;
+
+        ladder[nb_ladder++] = ost;
+        for (j = i + 1; j < nb_output_streams; j++) {
+            OutputStream *ost2 = output_streams[j];
+            AVBPrint opts2;
+            int same;
+
+            if (scale_only_source(ost2) != ist || !same_pix_fmts(ost, ost2) ||
+                !get_sws_opts(ost2, &opts2))
+                continue;
+            same = !strcmp(opts.str, opts2.str);
+            av_bprint_finalize(&opts2, NULL);
+            if (same)
+                ladder[nb_ladder++] = ost2;
+        }
+        if (nb_ladder < 2) {
+            av_bprint_finalize(&opts, NULL);
+            continue;
+        }
+
+        av_bprint_init(&desc, 0, AV_BPRINT_SIZE_UNLIMITED);
+        av_bprintf(&desc, "[%d:%d]multiscale=sizes=", ist->file_index, ist->st->index);
+        for (j = 0; j < nb_ladder; j++)
+            av_bprintf(&desc, "%s%dx%d", j ? "|" : "",
+                       ladder[j]->filter->width, ladder[j]->filter->height);
+        av_bprintf(&desc, "%s", opts.str);
+        av_bprint_finalize(&opts, NULL);
+
+        /* filtergraphs is grown by GROW_ARRAY() for simple graphs,
+         * so it cannot be appended to with ALLOC_ARRAY_ELEM() */
+        fg = av_mallocz(sizeof(*fg));
+        if (!fg)
+            exit_program(1);
+        fg->index = nb_filtergraphs;
+        GROW_ARRAY(filtergraphs, nb_filtergraphs);
+        filtergraphs[nb_filtergraphs - 1] = fg;
+
+        ret = av_bprint_finalize(&desc, (char **)&fg->graph_desc);
+        if (ret < 0)
+            break;
+
+        ret = init_complex_filtergraph(fg);
+        if (ret < 0)
+            break;
+        av_assert0(fg->nb_outputs == nb_ladder);
+
+        av_log(NULL, AV_LOG_VERBOSE, "Scaling %d outputs of stream #%d:%d with %s\n",
+               nb_ladder, ist->file_index, ist->st->index, fg->graph_desc);
+
+        for (j = 0; j < nb_ladder; j++) {
+            OutputFilter *old     = ladder[j]->filter;
+            OutputFilter *ofilter = fg->outputs[j];
+
+            ofilter->ost        = ladder[j];
+            ofilter->format     = old->format;
+            ofilter->formats    = old->formats;
+            ofilter->frame_rate = old->frame_rate;
+            avfilter_inout_free(&ofilter->out_tmp);
+
+            ladder[j]->filter = ofilter;
+            free_simple_filtergraph(old->graph);
+        }
+    }
+
+    av_freep(&ladder);
+    return ret;
+}
+
 static int insert_trim(int64_t start_time, int64_t duration,
                        AVFilterContext **last_filter, int *pad_idx,
                        const char *filter_name)
@@ -1000,6 +1187,10 @@ int configure_filtergraph(FilterGraph *fg)
     cleanup_filtergraph(fg);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    if (thread_pool && !(fg->graph->thread_pool = av_buffer_ref(thread_pool))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
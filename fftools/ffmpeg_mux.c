@@ -16,6 +16,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -26,6 +28,8 @@
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/timestamp.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 
 #include "libavcodec/packet.h"
 
@@ -41,6 +45,139 @@ static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream,
     }
 }
 
+static int64_t filesize(AVIOContext *pb)
+{
+    int64_t ret = -1;
+
+    if (pb) {
+        ret = avio_size(pb);
+        if (ret <= 0) // FIXME improve avio_size() so it works with non seekable output too
+            ret = avio_tell(pb);
+    }
+
+    return ret;
+}
+
+static int write_packet(OutputFile *of, AVPacket *pkt)
+{
+    int ret;
+
+    ret = av_interleaved_write_frame(of->ctx, pkt);
+    if (ret < 0)
+        print_error("av_interleaved_write_frame()", ret);
+
+#if HAVE_THREADS
+    if (of->mux_queue)
+        atomic_store(&of->last_filesize, filesize(of->ctx->pb));
+#endif
+
+    return ret;
+}
+
+#if HAVE_THREADS
+static void *muxer_thread(void *arg)
+{
+    OutputFile *of = arg;
+    AVPacket *pkt;
+    int ret;
+
+    while (1) {
+        int size;
+
+        ret = av_thread_message_queue_recv(of->mux_queue, &pkt, 0);
+        if (ret < 0)
+            break;
+
+        size = pkt->size;
+        ret  = write_packet(of, pkt);
+        av_packet_free(&pkt);
+        atomic_fetch_sub(&of->queued_size, size);
+        if (ret < 0) {
+            /* make the main thread notice the failure on its next packet */
+            av_thread_message_queue_set_err_send(of->mux_queue, ret);
+            break;
+        }
+    }
+
+    return (void*)(intptr_t)ret;
+}
+
+static int submit_packet(OutputFile *of, AVPacket *pkt)
+{
+    AVPacket *queue_pkt;
+    int size, ret;
+
+    ret = av_packet_make_refcounted(pkt);
+    if (ret < 0)
+        return ret;
+
+    queue_pkt = av_packet_alloc();
+    if (!queue_pkt) {
+        av_packet_unref(pkt);
+        return AVERROR(ENOMEM);
+    }
+    av_packet_move_ref(queue_pkt, pkt);
+
+    /* counted before sending, the thread may write the packet right away */
+    size = queue_pkt->size;
+    atomic_fetch_add(&of->queued_size, size);
+    ret = av_thread_message_queue_send(of->mux_queue, &queue_pkt, 0);
+    if (ret < 0) {
+        atomic_fetch_sub(&of->queued_size, size);
+        av_packet_free(&queue_pkt);
+    }
+
+    return ret;
+}
+
+static void free_queued_packet(void *msg)
+{
+    av_packet_free((AVPacket **)msg);
+}
+
+static int thread_start(OutputFile *of)
+{
+    int ret;
+
+    if (of->thread_queue_size < 0)
+        of->thread_queue_size = 8;
+    if (!of->thread_queue_size)
+        return 0;
+
+    ret = av_thread_message_queue_alloc(&of->mux_queue, of->thread_queue_size,
+                                        sizeof(AVPacket *));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(of->mux_queue, free_queued_packet);
+
+    atomic_init(&of->last_filesize, filesize(of->ctx->pb));
+    atomic_init(&of->queued_size, 0);
+
+    if ((ret = pthread_create(&of->mux_thread, NULL, muxer_thread, of))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&of->mux_queue);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+
+/* let the muxer thread write out all queued packets and wait for it to exit */
+static int thread_stop(OutputFile *of)
+{
+    void *thread_ret;
+
+    if (!of->mux_queue)
+        return 0;
+
+    av_thread_message_queue_set_err_recv(of->mux_queue, AVERROR_EOF);
+    pthread_join(of->mux_thread, &thread_ret);
+    av_thread_message_queue_free(&of->mux_queue);
+
+    return (intptr_t)thread_ret == AVERROR_EOF ? 0 : (intptr_t)thread_ret;
+}
+#endif
+
 void of_write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost,
                      int unqueue)
 {
@@ -165,9 +302,13 @@ void of_write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost,
               );
     }
 
-    ret = av_interleaved_write_frame(s, pkt);
+#if HAVE_THREADS
+    if (of->mux_queue)
+        ret = submit_packet(of, pkt);
+    else
+#endif
+    ret = write_packet(of, pkt);
     if (ret < 0) {
-        print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
         close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
     }
@@ -248,6 +389,12 @@ int of_check_init(OutputFile *of)
     //assert_avoptions(of->opts);
     of->header_written = 1;
 
+#if HAVE_THREADS
+    ret = thread_start(of);
+    if (ret < 0)
+        return ret;
+#endif
+
     av_dump_format(of->ctx, of->index, of->ctx->url, 1);
     nb_output_dumped++;
 
@@ -290,6 +437,12 @@ int of_write_trailer(OutputFile *of)
         return AVERROR(EINVAL);
     }
 
+#if HAVE_THREADS
+    ret = thread_stop(of);
+    if (ret < 0)
+        main_return_code = 1;
+#endif
+
     ret = av_write_trailer(of->ctx);
     if (ret < 0) {
         av_log(NULL, AV_LOG_ERROR, "Error writing trailer of %s: %s\n", of->ctx->url, av_err2str(ret));
@@ -299,6 +452,17 @@ int of_write_trailer(OutputFile *of)
     return 0;
 }
 
+int64_t of_filesize(OutputFile *of)
+{
+#if HAVE_THREADS
+    /* the packets still queued to the muxer thread are counted too, so that
+     * -fs does not overshoot by the size of the queue */
+    if (of->mux_queue)
+        return atomic_load(&of->last_filesize) + atomic_load(&of->queued_size);
+#endif
+    return filesize(of->ctx->pb);
+}
+
 void of_close(OutputFile **pof)
 {
     OutputFile *of = *pof;
@@ -307,6 +471,10 @@ void of_close(OutputFile **pof)
     if (!of)
         return;
 
+#if HAVE_THREADS
+    thread_stop(of);
+#endif
+
     s = of->ctx;
     if (s && s->oformat && !(s->oformat->flags & AVFMT_NOFILE))
         avio_closep(&s->pb);
@@ -52,6 +52,7 @@
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/threadpool.h"
 
 #define DEFAULT_PASS_LOGFILENAME_PREFIX "ffmpeg2pass"
 
@@ -178,6 +179,9 @@ char *filter_nbthreads;
 int filter_complex_nbthreads = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
+int multiscale_outputs = 0;
+int thread_pool_size = -1;
+AVBufferRef *thread_pool;
 int64_t stats_period = 500000;
 
 
@@ -2442,6 +2446,9 @@ static int open_output_file(OptionsContext *o, const char *filename)
     of->start_time     = o->start_time;
     of->limit_filesize = o->limit_filesize;
     of->shortest       = o->shortest;
+#if HAVE_THREADS
+    of->thread_queue_size = o->thread_queue_size;
+#endif
     av_dict_copy(&of->opts, o->g->format_opts, 0);
 
     if (!strcmp(filename, "-"))
@@ -3570,6 +3577,14 @@ int ffmpeg_parse_options(int argc, char **argv)
         goto fail;
     }
 
+    if (thread_pool_size >= 0) {
+        ret = av_thread_pool_create(&thread_pool, thread_pool_size);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Error creating the thread pool: ");
+            goto fail;
+        }
+    }
+
     /* configure terminal and setup signal handlers */
     term_init();
 
@@ -3596,6 +3611,14 @@ int ffmpeg_parse_options(int argc, char **argv)
         goto fail;
     }
 
+    if (multiscale_outputs) {
+        ret = init_multiscale_filtergraphs();
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_FATAL, "Error initializing multiscale filtergraphs: ");
+            goto fail;
+        }
+    }
+
     check_filter_outputs();
 
 fail:
@@ -3798,12 +3821,16 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_threads", HAS_ARG | OPT_INT,                   { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "thread_pool",    HAS_ARG | OPT_INT | OPT_EXPERT,              { &thread_pool_size },
+        "run the slice threads of all codecs and filters on one shared pool of threads", "nb_threads" },
     { "lavfi",          HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
         "read complex filtergraph description from a file", "filename" },
     { "auto_conversion_filters", OPT_BOOL | OPT_EXPERT,              { &auto_conversion_filters },
         "enable automatic conversion filters globally" },
+    { "multiscale",     OPT_BOOL | OPT_EXPERT,                       { &multiscale_outputs },
+        "scale outputs fed from the same stream in a single multiscale filter" },
     { "stats",          OPT_BOOL,                                    { &print_stats },
         "print progress report during encoding", },
     { "stats_period",    HAS_ARG | OPT_EXPERT,                       { .func_arg = opt_stats_period },
@@ -3826,9 +3853,9 @@ const OptionDef options[] = {
     { "disposition",    OPT_STRING | HAS_ARG | OPT_SPEC |
                         OPT_OUTPUT,                                  { .off = OFFSET(disposition) },
         "disposition", "" },
-    { "thread_queue_size", HAS_ARG | OPT_INT | OPT_OFFSET | OPT_EXPERT | OPT_INPUT,
+    { "thread_queue_size", HAS_ARG | OPT_INT | OPT_OFFSET | OPT_EXPERT | OPT_INPUT | OPT_OUTPUT,
                                                                      { .off = OFFSET(thread_queue_size) },
-        "set the maximum number of queued packets from the demuxer" },
+        "set the maximum number of queued packets from the demuxer or to the muxer" },
     { "find_stream_info", OPT_BOOL | OPT_PERFILE | OPT_INPUT | OPT_EXPERT, { &find_stream_info },
         "read and decode the streams to fill missing information with heuristics" },
     { "bits_per_raw_sample", OPT_INT | HAS_ARG | OPT_EXPERT | OPT_SPEC | OPT_OUTPUT,
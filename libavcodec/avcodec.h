@@ -314,6 +314,12 @@ typedef struct RcOverride{
  * Discard cropping information from SPS.
  */
 #define AV_CODEC_FLAG2_IGNORE_CROP    (1 << 16)
+/**
+ * With frame threading, return each frame as soon as it and all frames
+ * before it in decoding order are decoded, instead of first filling every
+ * thread with a packet.
+ */
+#define AV_CODEC_FLAG2_THREAD_LOW_DELAY (1 << 17)
 
 /**
  * Show all frames before the first keyframe
@@ -2054,6 +2060,21 @@ typedef struct AVCodecContext {
      *             The decoder can then override during decoding as needed.
      */
     AVChannelLayout ch_layout;
+
+    /**
+     * A reference to a shared thread pool created with
+     * av_thread_pool_create(). When set, slice threading runs on the pool
+     * workers instead of on threads private to this context, thread_count
+     * then only limits how many of them work for this context at once.
+     * Frame threading is not affected.
+     *
+     * The reference is owned and freed by libavcodec; it should be set by
+     * the caller before avcodec_open2() and never changed afterwards.
+     *
+     * - encoding: May be set by the caller.
+     * - decoding: May be set by the caller.
+     */
+    AVBufferRef *thread_pool;
 } AVCodecContext;
 
 /**
@@ -2617,6 +2638,44 @@ int avcodec_send_packet(AVCodecContext *avctx, const AVPacket *avpkt);
  */
 int avcodec_receive_frame(AVCodecContext *avctx, AVFrame *frame);
 
+/**
+ * Decode several packets and return several frames in a single call.
+ *
+ * This behaves like alternating avcodec_receive_frame() and
+ * avcodec_send_packet(): frames are returned while the decoder has output
+ * available, and the next packet is sent whenever it needs more input. It
+ * stops once all the packets have been consumed and no more output is
+ * available, or once all the frames have been filled. The context is only
+ * validated once, and frames are decoded directly into the provided array
+ * instead of being buffered internally first, which makes it cheaper than
+ * the single packet API for small packets. It can be freely mixed with
+ * avcodec_send_packet() and avcodec_receive_frame().
+ *
+ * Frames dropped with AV_CODEC_FLAG_DROPCHANGED are skipped.
+ *
+ * @param avctx     codec context
+ * @param pkts      packets to decode, see avcodec_send_packet(); only the last
+ *                  one may be a flush packet
+ * @param nb_pkts   on input, the number of packets in pkts; on output, the
+ *                  number of packets which have been consumed
+ * @param frames    allocated frames which receive the decoded output, see
+ *                  avcodec_receive_frame()
+ * @param nb_frames on input, the number of frames in frames; on output, the
+ *                  number of frames which have been returned
+ *
+ * @return
+ *      0:                 success; the packets which were not consumed must be
+ *                         sent again once the returned frames are processed
+ *      AVERROR_EOF:       the decoder has been fully flushed, and there will be
+ *                         no more output frames
+ *      AVERROR(EINVAL):   codec not opened, or it is an encoder
+ *      other negative values: legitimate decoding errors
+ *
+ * The packets and frames counts are valid even when an error is returned.
+ */
+int avcodec_decode_packets(AVCodecContext *avctx, const AVPacket * const *pkts,
+                           int *nb_pkts, AVFrame **frames, int *nb_frames);
+
 /**
  * Supply a raw video or audio frame to the encoder. Use avcodec_receive_packet()
  * to retrieve buffered output packets.
@@ -38,9 +38,6 @@
 #include "thread.h"
 #include "cfhd.h"
 
-#define ALPHA_COMPAND_DC_OFFSET 256
-#define ALPHA_COMPAND_GAIN 9400
-
 static av_cold int cfhd_init(AVCodecContext *avctx)
 {
     CFHDContext *s = avctx->priv_data;
@@ -115,82 +112,21 @@ static inline int dequant_and_decompand(CFHDContext *s, int level, int quantisat
         return level * quantisation;
 }
 
-static inline void difference_coding(int16_t *band, int width, int height)
-{
-
-    int i,j;
-    for (i = 0; i < height; i++) {
-        for (j = 1; j < width; j++) {
-          band[j] += band[j-1];
-        }
-        band += width;
-    }
-}
-
-static inline void peak_table(int16_t *band, Peak *peak, int length)
+static void peak_table(CFHDDSPContext *dsp, int16_t *band, Peak *peak, int length)
 {
-    int i;
-    for (i = 0; i < length; i++)
-        if (abs(band[i]) > peak->level)
-            band[i] = bytestream2_get_le16(&peak->base);
-}
-
-static inline void process_alpha(int16_t *alpha, int width)
-{
-    int i, channel;
-    for (i = 0; i < width; i++) {
-        channel   = alpha[i];
-        channel  -= ALPHA_COMPAND_DC_OFFSET;
-        channel <<= 3;
-        channel  *= ALPHA_COMPAND_GAIN;
-        channel >>= 16;
-        channel   = av_clip_uintp2(channel, 12);
-        alpha[i]  = channel;
-    }
-}
-
-static inline void process_bayer(AVFrame *frame, int bpc)
-{
-    const int linesize = frame->linesize[0];
-    uint16_t *r = (uint16_t *)frame->data[0];
-    uint16_t *g1 = (uint16_t *)(frame->data[0] + 2);
-    uint16_t *g2 = (uint16_t *)(frame->data[0] + frame->linesize[0]);
-    uint16_t *b = (uint16_t *)(frame->data[0] + frame->linesize[0] + 2);
-    const int mid = 1 << (bpc - 1);
-    const int factor = 1 << (16 - bpc);
-
-    for (int y = 0; y < frame->height >> 1; y++) {
-        for (int x = 0; x < frame->width; x += 2) {
-            int R, G1, G2, B;
-            int g, rg, bg, gd;
-
-            g  = r[x];
-            rg = g1[x];
-            bg = g2[x];
-            gd = b[x];
-            gd -= mid;
-
-            R  = (rg - mid) * 2 + g;
-            G1 = g + gd;
-            G2 = g - gd;
-            B  = (bg - mid) * 2 + g;
-
-            R  = av_clip_uintp2(R  * factor, 16);
-            G1 = av_clip_uintp2(G1 * factor, 16);
-            G2 = av_clip_uintp2(G2 * factor, 16);
-            B  = av_clip_uintp2(B  * factor, 16);
-
-            r[x]  = R;
-            g1[x] = G1;
-            g2[x] = G2;
-            b[x]  = B;
-        }
-
-        r  += linesize;
-        g1 += linesize;
-        g2 += linesize;
-        b  += linesize;
-    }
+    int left = bytestream2_get_bytes_left(&peak->base);
+    int n;
+
+    /* no coefficient magnitude exceeds 32768 */
+    if (peak->level > INT16_MAX)
+        return;
+
+    n = dsp->peak_table(band, length, peak->level + 1,
+                        peak->base.buffer, left >> 1);
+    if (2 * n <= left)
+        bytestream2_skip(&peak->base, 2 * n);
+    else
+        bytestream2_seek(&peak->base, 0, SEEK_END);
 }
 
 static inline void interlaced_vertical_filter(int16_t *output, int16_t *low, int16_t *high,
@@ -254,8 +190,10 @@ static int alloc_buffers(AVCodecContext *avctx)
     if ((ret = ff_set_dimensions(avctx, s->coded_width, s->coded_height)) < 0)
         return ret;
     avctx->pix_fmt = s->coded_format;
+    if (s->coded_format == AV_PIX_FMT_BAYER_RGGB16 && s->demosaic)
+        avctx->pix_fmt = AV_PIX_FMT_GBRP16;
 
-    ff_cfhddsp_init(&s->dsp, s->bpc, avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16);
+    ff_cfhddsp_init(&s->dsp, s->bpc, s->coded_format == AV_PIX_FMT_BAYER_RGGB16);
 
     if ((ret = av_pix_fmt_get_chroma_sub_sample(s->coded_format,
                                                 &chroma_x_shift,
@@ -373,11 +311,600 @@ static int alloc_buffers(AVCodecContext *avctx)
     return 0;
 }
 
+static int check_plane_dimensions(AVCodecContext *avctx, const Plane *p, int level,
+                                  int lowpass_width, int lowpass_height)
+{
+    if (lowpass_height > p->band[level][1].a_height || lowpass_width > p->band[level][1].a_width ||
+        !p->band[level][1].stride || p->band[level][1].width > p->band[level][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static int check_bayer_dimensions(AVCodecContext *avctx, int lowpass_width, int lowpass_height)
+{
+    CFHDContext *s = avctx->priv_data;
+
+    if (s->a_format == AV_PIX_FMT_BAYER_RGGB16 &&
+        (lowpass_height * 2 > avctx->coded_height / 2 ||
+         lowpass_width  * 2 > avctx->coded_width  / 2    )
+        )
+        return AVERROR_INVALIDDATA;
+    return 0;
+}
+
+static void set_plane_output(Plane *p, int16_t *low, int16_t *high,
+                             int lowpass_width, int output_stride)
+{
+    p->out_low    = low;
+    p->out_high   = high;
+    p->out_width  = lowpass_width;
+    p->out_stride = output_stride;
+}
+
+/* lowres decoding stops early and copies a lowpass image to the frame */
+static void set_plane_lowres_output(Plane *p, int16_t *image, int width,
+                                    int height, int stride)
+{
+    p->out_low    = image;
+    p->out_high   = NULL;
+    p->out_width  = width;
+    p->out_height = height;
+    p->out_stride = stride;
+}
+
+static int reconstruct_plane_2d(AVCodecContext *avctx, CFHDContext *s, int plane)
+{
+    CFHDDSPContext *dsp = &s->dsp;
+    Plane *p = &s->plane[plane];
+    /* level 1 */
+    int lowpass_height  = p->band[0][0].height;
+    int output_stride   = p->band[0][0].a_width;
+    int lowpass_width   = p->band[0][0].width;
+    int highpass_stride = p->band[0][1].stride;
+    int16_t *low, *high, *output;
+    int i, j, ret;
+
+    if (lowpass_height > p->band[0][0].a_height || lowpass_width > p->band[0][0].a_width ||
+        !highpass_stride || p->band[0][1].width > p->band[0][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (avctx->lowres == 3) {
+        set_plane_lowres_output(p, p->subband[0], lowpass_width, lowpass_height, lowpass_width);
+        return 0;
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = p->subband[0];
+    high   = p->subband[2];
+    output = p->l_h[0];
+    dsp->vert_filter(output, output_stride, low, lowpass_width, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->subband[1];
+    high   = p->subband[3];
+    output = p->l_h[1];
+
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->l_h[0];
+    high   = p->l_h[1];
+    output = p->subband[0];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+    if (s->bpc == 12) {
+        output = p->subband[0];
+        for (i = 0; i < lowpass_height * 2; i++) {
+            for (j = 0; j < lowpass_width * 2; j++)
+                output[j] *= 4;
+
+            output += output_stride * 2;
+        }
+    }
+
+    if (avctx->lowres == 2) {
+        set_plane_lowres_output(p, p->subband[0], lowpass_width * 2,
+                                lowpass_height * 2, output_stride * 2);
+        return 0;
+    }
+
+    /* level 2 */
+    lowpass_height  = p->band[1][1].height;
+    output_stride   = p->band[1][1].a_width;
+    lowpass_width   = p->band[1][1].width;
+    highpass_stride = p->band[1][1].stride;
+
+    if ((ret = check_plane_dimensions(avctx, p, 1, lowpass_width, lowpass_height)) < 0)
+        return ret;
+
+    av_log(avctx, AV_LOG_DEBUG, "Level 2 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = p->subband[0];
+    high   = p->subband[5];
+    output = p->l_h[3];
+    dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->subband[4];
+    high   = p->subband[6];
+    output = p->l_h[4];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->l_h[3];
+    high   = p->l_h[4];
+    output = p->subband[0];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+
+    output = p->subband[0];
+    for (i = 0; i < lowpass_height * 2; i++) {
+        for (j = 0; j < lowpass_width * 2; j++)
+            output[j] *= 4;
+
+        output += output_stride * 2;
+    }
+
+    if (avctx->lowres == 1) {
+        set_plane_lowres_output(p, p->subband[0], lowpass_width * 2,
+                                lowpass_height * 2, output_stride * 2);
+        return 0;
+    }
+
+    /* level 3 */
+    lowpass_height  = p->band[2][1].height;
+    output_stride   = p->band[2][1].a_width;
+    lowpass_width   = p->band[2][1].width;
+    highpass_stride = p->band[2][1].stride;
+
+    if ((ret = check_plane_dimensions(avctx, p, 2, lowpass_width, lowpass_height)) < 0)
+        return ret;
+    if (lowpass_width * 2 > p->width) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Level 3 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+    if (s->progressive) {
+        low    = p->subband[0];
+        high   = p->subband[8];
+        output = p->l_h[6];
+        dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = p->subband[7];
+        high   = p->subband[9];
+        output = p->l_h[7];
+        dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        if ((ret = check_bayer_dimensions(avctx, lowpass_width, lowpass_height)) < 0)
+            return ret;
+    } else {
+        low    = p->subband[0];
+        high   = p->subband[7];
+        output = p->l_h[6];
+        dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = p->subband[8];
+        high   = p->subband[9];
+        output = p->l_h[7];
+        dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+    }
+
+    set_plane_output(p, p->l_h[6], p->l_h[7], lowpass_width, output_stride);
+
+    return 0;
+}
+
+static int reconstruct_plane_3d(AVCodecContext *avctx, CFHDContext *s, int plane)
+{
+    CFHDDSPContext *dsp = &s->dsp;
+    Plane *p = &s->plane[plane];
+    int lowpass_height  = p->band[0][0].height;
+    int output_stride   = p->band[0][0].a_width;
+    int lowpass_width   = p->band[0][0].width;
+    int highpass_stride = p->band[0][1].stride;
+    int16_t *low, *high, *output;
+    int i, j, ret;
+
+    if (lowpass_height > p->band[0][0].a_height || lowpass_width > p->band[0][0].a_width ||
+        !highpass_stride || p->band[0][1].width > p->band[0][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = p->subband[0];
+    high   = p->subband[2];
+    output = p->l_h[0];
+    dsp->vert_filter(output, output_stride, low, lowpass_width, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->subband[1];
+    high   = p->subband[3];
+    output = p->l_h[1];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->l_h[0];
+    high   = p->l_h[1];
+    output = p->l_h[7];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+    if (s->bpc == 12) {
+        output = p->l_h[7];
+        for (i = 0; i < lowpass_height * 2; i++) {
+            for (j = 0; j < lowpass_width * 2; j++)
+                output[j] *= 4;
+
+            output += output_stride * 2;
+        }
+    }
+
+    lowpass_height  = p->band[1][1].height;
+    output_stride   = p->band[1][1].a_width;
+    lowpass_width   = p->band[1][1].width;
+    highpass_stride = p->band[1][1].stride;
+
+    if ((ret = check_plane_dimensions(avctx, p, 1, lowpass_width, lowpass_height)) < 0)
+        return ret;
+
+    av_log(avctx, AV_LOG_DEBUG, "Level 2 lowpass plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = p->l_h[7];
+    high   = p->subband[5];
+    output = p->l_h[3];
+    dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->subband[4];
+    high   = p->subband[6];
+    output = p->l_h[4];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->l_h[3];
+    high   = p->l_h[4];
+    output = p->l_h[7];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+
+    output = p->l_h[7];
+    for (i = 0; i < lowpass_height * 2; i++) {
+        for (j = 0; j < lowpass_width * 2; j++)
+            output[j] *= 4;
+        output += output_stride * 2;
+    }
+
+    low    = p->subband[7];
+    high   = p->subband[9];
+    output = p->l_h[3];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->subband[8];
+    high   = p->subband[10];
+    output = p->l_h[4];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = p->l_h[3];
+    high   = p->l_h[4];
+    output = p->l_h[9];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+
+    lowpass_height  = p->band[4][1].height;
+    output_stride   = p->band[4][1].a_width;
+    lowpass_width   = p->band[4][1].width;
+    highpass_stride = p->band[4][1].stride;
+    av_log(avctx, AV_LOG_DEBUG, "temporal level %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    if ((ret = check_plane_dimensions(avctx, p, 4, lowpass_width, lowpass_height)) < 0)
+        return ret;
+
+    low    = p->l_h[7];
+    high   = p->l_h[9];
+    output = p->l_h[7];
+    for (i = 0; i < lowpass_height; i++) {
+        inverse_temporal_filter(low, high, lowpass_width);
+        low    += output_stride;
+        high   += output_stride;
+    }
+    if (s->progressive) {
+        low    = p->l_h[7];
+        high   = p->subband[15];
+        output = p->l_h[6];
+        dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = p->subband[14];
+        high   = p->subband[16];
+        output = p->l_h[7];
+        dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = p->l_h[9];
+        high   = p->subband[12];
+        output = p->l_h[8];
+        dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = p->subband[11];
+        high   = p->subband[13];
+        output = p->l_h[9];
+        dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        if (s->sample_type == 1)
+            return 0;
+
+        if ((ret = check_bayer_dimensions(avctx, lowpass_width, lowpass_height)) < 0)
+            return ret;
+    } else {
+        low    = p->l_h[7];
+        high   = p->subband[14];
+        output = p->l_h[6];
+        dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = p->subband[15];
+        high   = p->subband[16];
+        output = p->l_h[7];
+        dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = p->l_h[9];
+        high   = p->subband[11];
+        output = p->l_h[8];
+        dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = p->subband[12];
+        high   = p->subband[13];
+        output = p->l_h[9];
+        dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        if (s->sample_type == 1)
+            return 0;
+    }
+
+    set_plane_output(p, p->l_h[6], p->l_h[7], lowpass_width, output_stride);
+
+    return 0;
+}
+
+static int reconstruct_plane(AVCodecContext *avctx, void *arg, int plane, int threadnr)
+{
+    CFHDContext *s = avctx->priv_data;
+
+    if (s->transform_type == 0)
+        return reconstruct_plane_2d(avctx, s, plane);
+    else
+        return reconstruct_plane_3d(avctx, s, plane);
+}
+
+/**
+ * Run the final inverse transform of row y of the four Bayer components
+ * and convert it to the two RGGB lines at line and line + stride.
+ * The lines are extended by one mirrored sample on each side.
+ */
+static void reconstruct_bayer_row(AVCodecContext *avctx, uint16_t *line, int width, int y)
+{
+    CFHDContext *s = avctx->priv_data;
+    const ptrdiff_t stride = s->demosaic_stride;
+
+    for (int plane = 0; plane < 4; plane++) {
+        const Plane *p = &s->plane[plane];
+        int16_t *dst = (int16_t *)line + (plane & 1) + (plane > 1) * stride;
+
+        if (!p->out_low)
+            continue;
+
+        if (avctx->lowres) {
+            const int shift = avctx->lowres == 3 && s->bpc == 10 ? 4 : 2;
+            const int cols  = FFMIN(p->out_width,
+                                    AV_CEIL_RSHIFT(s->plane[0].width, avctx->lowres));
+            const int16_t *low = p->out_low + y * p->out_stride;
+
+            for (int x = 0; x < cols; x++)
+                dst[x * 2] = av_clip_uintp2((low[x] + (1 << (shift - 1))) >> shift, s->bpc);
+        } else {
+            s->dsp.horiz_filter_clip(dst, p->out_low  + y * p->out_stride,
+                                     p->out_high + y * p->out_stride,
+                                     p->out_width, s->bpc);
+        }
+    }
+
+    s->dsp.process_bayer(line, stride * sizeof(*line), width, 1, s->bpc);
+
+    for (int i = 0; i < 2; i++, line += stride) {
+        line[-1]    = line[1];
+        line[width] = line[width - 2];
+    }
+}
+
+/**
+ * Bilinear demosaic of one RGGB line c, with a and b the lines above and
+ * below it, into one row of a GBRP16 frame.
+ */
+static void demosaic_line(uint16_t *g, uint16_t *b, uint16_t *r,
+                          const uint16_t *a, const uint16_t *c, const uint16_t *d,
+                          int width, int odd)
+{
+    if (!odd) {
+        for (int x = 0; x < width; x += 2) {
+            r[x]     = c[x];
+            g[x]     = (a[x] + c[x - 1] + c[x + 1] + d[x]) >> 2;
+            b[x]     = (a[x - 1] + a[x + 1] + d[x - 1] + d[x + 1]) >> 2;
+            r[x + 1] = (c[x] + c[x + 2]) >> 1;
+            g[x + 1] = c[x + 1];
+            b[x + 1] = (a[x + 1] + d[x + 1]) >> 1;
+        }
+    } else {
+        for (int x = 0; x < width; x += 2) {
+            r[x]     = (a[x] + d[x]) >> 1;
+            g[x]     = c[x];
+            b[x]     = (c[x - 1] + c[x + 1]) >> 1;
+            r[x + 1] = (a[x] + a[x + 2] + d[x] + d[x + 2]) >> 2;
+            g[x + 1] = (a[x + 1] + c[x] + c[x + 2] + d[x + 1]) >> 2;
+            b[x + 1] = c[x + 1];
+        }
+    }
+}
+
+/**
+ * Reconstruct and demosaic one slice of Bayer rows directly into the
+ * GBRP16 output frame. Only the three component rows needed by the
+ * current row pair are kept, in a ring of mosaic lines private to the job;
+ * the rows bordering the slice are reconstructed by both neighbouring jobs.
+ */
+static int output_demosaic_slice(AVCodecContext *avctx, AVFrame *pic, int jobnr)
+{
+    CFHDContext *s = avctx->priv_data;
+    const ptrdiff_t stride = s->demosaic_stride;
+    uint16_t *buf = s->demosaic_buf + 6 * stride * jobnr + 16;
+    int rows, start, end;
+
+    if (avctx->lowres)
+        rows = FFMIN(s->plane[0].height >> avctx->lowres, s->plane[0].out_height);
+    else
+        rows = s->plane[0].height;
+    rows  = FFMIN(rows, pic->height >> 1);
+    start = (rows *  jobnr     ) / s->nb_slices;
+    end   = (rows * (jobnr + 1)) / s->nb_slices;
+
+#define LINES(y) (buf + ((y) - start + 1) % 3 * 2 * stride)
+    if (start > 0)
+        reconstruct_bayer_row(avctx, LINES(start - 1), pic->width, start - 1);
+    if (start < end)
+        reconstruct_bayer_row(avctx, LINES(start), pic->width, start);
+
+    for (int y = start; y < end; y++) {
+        const uint16_t *cur   = LINES(y);
+        const uint16_t *above = y > 0 ? LINES(y - 1) + stride : cur + stride;
+        const uint16_t *below = cur;
+        uint16_t *dst[3];
+
+        if (y + 1 < rows) {
+            reconstruct_bayer_row(avctx, LINES(y + 1), pic->width, y + 1);
+            below = LINES(y + 1);
+        }
+
+        for (int i = 0; i < 2; i++) {
+            for (int plane = 0; plane < 3; plane++)
+                dst[plane] = (uint16_t *)(pic->data[plane] + (2 * y + i) * pic->linesize[plane]);
+            if (!i)
+                demosaic_line(dst[0], dst[1], dst[2], above, cur, cur + stride, pic->width, 0);
+            else
+                demosaic_line(dst[0], dst[1], dst[2], cur, cur + stride, below, pic->width, 1);
+        }
+    }
+#undef LINES
+
+    return 0;
+}
+
+static int output_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    CFHDContext *s = avctx->priv_data;
+    CFHDDSPContext *dsp = &s->dsp;
+    AVFrame *pic = arg;
+    const int bayer = avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16;
+    int plane, i;
+
+    if (avctx->pix_fmt == AV_PIX_FMT_GBRP16)
+        return output_demosaic_slice(avctx, pic, jobnr);
+
+    for (plane = 0; plane < s->planes; plane++) {
+        const Plane *p = &s->plane[plane];
+        int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
+        int rows, start, end;
+        ptrdiff_t dst_linesize;
+        int16_t *low, *high, *dst;
+
+        if (!p->out_low)
+            continue;
+
+        if (bayer) {
+            act_plane = 0;
+            dst_linesize = pic->linesize[act_plane];
+        } else {
+            dst_linesize = pic->linesize[act_plane] / 2;
+        }
+
+        if (avctx->lowres) {
+            rows = bayer ? s->plane[act_plane].height >> avctx->lowres
+                         : AV_CEIL_RSHIFT(s->plane[act_plane].height, avctx->lowres);
+            rows = FFMIN(rows, p->out_height);
+        } else {
+            rows = s->plane[act_plane].height >> !s->progressive;
+        }
+        start = (rows *  jobnr     ) / s->nb_slices;
+        end   = (rows * (jobnr + 1)) / s->nb_slices;
+
+        dst = (int16_t *)pic->data[act_plane];
+        if (avctx->lowres) {
+            /* the lowpass bands carry 2 extra bits, 4 for the 10-bit lowpass band */
+            const int shift = avctx->lowres == 3 && s->bpc == 10 ? 4 : 2;
+            const int step  = bayer ? 2 : 1;
+            const int cols  = FFMIN(p->out_width,
+                                    AV_CEIL_RSHIFT(s->plane[act_plane].width, avctx->lowres));
+
+            if (bayer) {
+                if (plane & 1)
+                    dst++;
+                if (plane > 1)
+                    dst += pic->linesize[act_plane] >> 1;
+            }
+            low  = p->out_low + start * p->out_stride;
+            dst += start * dst_linesize;
+
+            for (i = start; i < end; i++) {
+                for (int x = 0; x < cols; x++)
+                    dst[x * step] = av_clip_uintp2((low[x] + (1 << (shift - 1))) >> shift, s->bpc);
+                if (avctx->pix_fmt == AV_PIX_FMT_GBRAP12 && act_plane == 3)
+                    dsp->process_alpha(dst, cols);
+                low += p->out_stride;
+                dst += dst_linesize;
+            }
+        } else if (s->progressive) {
+            if (bayer) {
+                if (plane & 1)
+                    dst++;
+                if (plane > 1)
+                    dst += pic->linesize[act_plane] >> 1;
+            }
+            low  = p->out_low  + start * p->out_stride;
+            high = p->out_high + start * p->out_stride;
+            dst += start * dst_linesize;
+
+            for (i = start; i < end; i++) {
+                dsp->horiz_filter_clip(dst, low, high, p->out_width, s->bpc);
+                if (s->transform_type == 0 && avctx->pix_fmt == AV_PIX_FMT_GBRAP12 && act_plane == 3)
+                    dsp->process_alpha(dst, p->out_width * 2);
+                low  += p->out_stride;
+                high += p->out_stride;
+                dst  += dst_linesize;
+            }
+        } else {
+            low  = p->out_low  + start * p->out_stride * 2;
+            high = p->out_high + start * p->out_stride * 2;
+            dst += start * pic->linesize[act_plane];
+
+            for (i = start; i < end; i++) {
+                interlaced_vertical_filter(dst, low, high, p->out_width * 2,  pic->linesize[act_plane]/2, act_plane);
+                low  += p->out_stride * 2;
+                high += p->out_stride * 2;
+                dst  += pic->linesize[act_plane];
+            }
+        }
+    }
+
+    /* all Bayer planes share one height, so these rows were written above */
+    if (bayer) {
+        int rows  = s->plane[0].height;
+        int start = (rows *  jobnr     ) / s->nb_slices;
+        int end   = FFMIN((rows * (jobnr + 1)) / s->nb_slices, pic->height >> 1);
+
+        if (end > start)
+            dsp->process_bayer((uint16_t *)(pic->data[0] + 2 * start * pic->linesize[0]),
+                               pic->linesize[0], pic->width, end - start, s->bpc);
+    }
+
+    return 0;
+}
+
 static int cfhd_decode(AVCodecContext *avctx, AVFrame *pic,
                        int *got_frame, AVPacket *avpkt)
 {
     CFHDContext *s = avctx->priv_data;
-    CFHDDSPContext *dsp = &s->dsp;
     GetByteContext gb;
     int ret = 0, i, j, plane, got_buffer = 0;
     int16_t *coeff_data;
@@ -675,10 +1202,10 @@ static int cfhd_decode(AVCodecContext *avctx, AVFrame *pic,
             if (ret < 0)
                 return ret;
             if (s->cropped_height) {
-                unsigned height = s->cropped_height << (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16);
-                if (avctx->height < height)
+                unsigned height = s->cropped_height << (s->a_format == AV_PIX_FMT_BAYER_RGGB16);
+                if (avctx->coded_height < height)
                     return AVERROR_INVALIDDATA;
-                avctx->height = height;
+                avctx->height = AV_CEIL_RSHIFT(height, avctx->lowres);
             }
             pic->width = pic->height = 0;
 
@@ -774,6 +1301,9 @@ static int cfhd_decode(AVCodecContext *avctx, AVFrame *pic,
             int expected;
             int level, run, coeff;
             int count = 0, bytes;
+            /* bands above the requested lowres level are parsed but not stored */
+            const int skip = avctx->lowres && s->transform_type == 0 &&
+                             s->level >= DWT_LEVELS - avctx->lowres && !s->peak.level;
 
             if (!s->a_width || !s->a_height) {
                 ret = AVERROR_INVALIDDATA;
@@ -827,6 +1357,9 @@ static int cfhd_decode(AVCodecContext *avctx, AVFrame *pic,
                         if (count > expected)
                             break;
 
+                        if (skip)
+                            continue;
+
                         if (!lossless)
                             coeff = dequant_and_decompand(s, level, s->quantisation, 0);
                         else
@@ -858,6 +1391,9 @@ static int cfhd_decode(AVCodecContext *avctx, AVFrame *pic,
                         if (count > expected)
                             break;
 
+                        if (skip)
+                            continue;
+
                         if (!lossless)
                             coeff = dequant_and_decompand(s, level, s->quantisation, s->codebook);
                         else
@@ -884,9 +1420,10 @@ static int cfhd_decode(AVCodecContext *avctx, AVFrame *pic,
                 goto end;
             }
             if (s->peak.level)
-                peak_table(coeff_data - count, &s->peak, count);
-            if (s->difference_coding)
-                difference_coding(s->plane[s->channel_num].subband[s->subband_num_actual], highpass_width, highpass_height);
+                peak_table(&s->dsp, coeff_data - count, &s->peak, count);
+            if (s->difference_coding && !skip)
+                s->dsp.difference_coding(s->plane[s->channel_num].subband[s->subband_num_actual],
+                                         highpass_width, highpass_height);
 
             bytes = FFALIGN(AV_CEIL_RSHIFT(get_bits_count(&s->gb), 3), 4);
             if (bytes > bytestream2_get_bytes_left(&gb)) {
@@ -904,8 +1441,9 @@ finish:
         }
     }
 
-    s->planes = av_pix_fmt_count_planes(avctx->pix_fmt);
-    if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+    /* avctx->pix_fmt is GBRP16 for Bayer streams when demosaicing */
+    s->planes = av_pix_fmt_count_planes(s->a_format);
+    if (s->a_format == AV_PIX_FMT_BAYER_RGGB16) {
         s->progressive = 1;
         s->planes = 4;
     }
@@ -942,454 +1480,71 @@ finish:
         }
     }
 
-    if (s->transform_type == 0 && s->sample_type != 1) {
-        for (plane = 0; plane < s->planes && !ret; plane++) {
-            /* level 1 */
-            int lowpass_height  = s->plane[plane].band[0][0].height;
-            int output_stride   = s->plane[plane].band[0][0].a_width;
-            int lowpass_width   = s->plane[plane].band[0][0].width;
-            int highpass_stride = s->plane[plane].band[0][1].stride;
-            int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
-            ptrdiff_t dst_linesize;
-            int16_t *low, *high, *output, *dst;
-
-            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                act_plane = 0;
-                dst_linesize = pic->linesize[act_plane];
-            } else {
-                dst_linesize = pic->linesize[act_plane] / 2;
-            }
-
-            if (lowpass_height > s->plane[plane].band[0][0].a_height || lowpass_width > s->plane[plane].band[0][0].a_width ||
-                !highpass_stride || s->plane[plane].band[0][1].width > s->plane[plane].band[0][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            low    = s->plane[plane].subband[0];
-            high   = s->plane[plane].subband[2];
-            output = s->plane[plane].l_h[0];
-            dsp->vert_filter(output, output_stride, low, lowpass_width, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[1];
-            high   = s->plane[plane].subband[3];
-            output = s->plane[plane].l_h[1];
-
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[0];
-            high   = s->plane[plane].l_h[1];
-            output = s->plane[plane].subband[0];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-            if (s->bpc == 12) {
-                output = s->plane[plane].subband[0];
-                for (i = 0; i < lowpass_height * 2; i++) {
-                    for (j = 0; j < lowpass_width * 2; j++)
-                        output[j] *= 4;
-
-                    output += output_stride * 2;
-                }
-            }
-
-            /* level 2 */
-            lowpass_height  = s->plane[plane].band[1][1].height;
-            output_stride   = s->plane[plane].band[1][1].a_width;
-            lowpass_width   = s->plane[plane].band[1][1].width;
-            highpass_stride = s->plane[plane].band[1][1].stride;
-
-            if (lowpass_height > s->plane[plane].band[1][1].a_height || lowpass_width > s->plane[plane].band[1][1].a_width ||
-                !highpass_stride || s->plane[plane].band[1][1].width > s->plane[plane].band[1][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Level 2 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            low    = s->plane[plane].subband[0];
-            high   = s->plane[plane].subband[5];
-            output = s->plane[plane].l_h[3];
-            dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[4];
-            high   = s->plane[plane].subband[6];
-            output = s->plane[plane].l_h[4];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[3];
-            high   = s->plane[plane].l_h[4];
-            output = s->plane[plane].subband[0];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-
-            output = s->plane[plane].subband[0];
-            for (i = 0; i < lowpass_height * 2; i++) {
-                for (j = 0; j < lowpass_width * 2; j++)
-                    output[j] *= 4;
-
-                output += output_stride * 2;
-            }
-
-            /* level 3 */
-            lowpass_height  = s->plane[plane].band[2][1].height;
-            output_stride   = s->plane[plane].band[2][1].a_width;
-            lowpass_width   = s->plane[plane].band[2][1].width;
-            highpass_stride = s->plane[plane].band[2][1].stride;
-
-            if (lowpass_height > s->plane[plane].band[2][1].a_height || lowpass_width > s->plane[plane].band[2][1].a_width ||
-                !highpass_stride || s->plane[plane].band[2][1].width > s->plane[plane].band[2][1].a_width ||
-                lowpass_height < 3 || lowpass_width < 3 || lowpass_width * 2 > s->plane[plane].width) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Level 3 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-            if (s->progressive) {
-                low    = s->plane[plane].subband[0];
-                high   = s->plane[plane].subband[8];
-                output = s->plane[plane].l_h[6];
-                dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[7];
-                high   = s->plane[plane].subband[9];
-                output = s->plane[plane].l_h[7];
-                dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                dst = (int16_t *)pic->data[act_plane];
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                    if (plane & 1)
-                        dst++;
-                    if (plane > 1)
-                        dst += pic->linesize[act_plane] >> 1;
-                }
-                low  = s->plane[plane].l_h[6];
-                high = s->plane[plane].l_h[7];
-
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
-                    (lowpass_height * 2 > avctx->coded_height / 2 ||
-                     lowpass_width  * 2 > avctx->coded_width  / 2    )
-                    ) {
-                    ret = AVERROR_INVALIDDATA;
-                    goto end;
-                }
-
-                for (i = 0; i < s->plane[act_plane].height; i++) {
-                    dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
-                    if (avctx->pix_fmt == AV_PIX_FMT_GBRAP12 && act_plane == 3)
-                        process_alpha(dst, lowpass_width * 2);
-                    low  += output_stride;
-                    high += output_stride;
-                    dst  += dst_linesize;
-                }
-            } else {
-                av_log(avctx, AV_LOG_DEBUG, "interlaced frame ? %d", pic->interlaced_frame);
-                pic->interlaced_frame = 1;
-                low    = s->plane[plane].subband[0];
-                high   = s->plane[plane].subband[7];
-                output = s->plane[plane].l_h[6];
-                dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[8];
-                high   = s->plane[plane].subband[9];
-                output = s->plane[plane].l_h[7];
-                dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                dst  = (int16_t *)pic->data[act_plane];
-                low  = s->plane[plane].l_h[6];
-                high = s->plane[plane].l_h[7];
-                for (i = 0; i < s->plane[act_plane].height / 2; i++) {
-                    interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
-                    low  += output_stride * 2;
-                    high += output_stride * 2;
-                    dst  += pic->linesize[act_plane];
-                }
-            }
-        }
-    } else if (s->transform_type == 2 && (avctx->internal->is_copy || s->frame_index == 1 || s->sample_type != 1)) {
-        for (plane = 0; plane < s->planes && !ret; plane++) {
-            int lowpass_height  = s->plane[plane].band[0][0].height;
-            int output_stride   = s->plane[plane].band[0][0].a_width;
-            int lowpass_width   = s->plane[plane].band[0][0].width;
-            int highpass_stride = s->plane[plane].band[0][1].stride;
-            int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
-            int16_t *low, *high, *output, *dst;
-            ptrdiff_t dst_linesize;
-
-            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                act_plane = 0;
-                dst_linesize = pic->linesize[act_plane];
-            } else {
-                dst_linesize = pic->linesize[act_plane] / 2;
-            }
-
-            if (lowpass_height > s->plane[plane].band[0][0].a_height || lowpass_width > s->plane[plane].band[0][0].a_width ||
-                !highpass_stride || s->plane[plane].band[0][1].width > s->plane[plane].band[0][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            low    = s->plane[plane].subband[0];
-            high   = s->plane[plane].subband[2];
-            output = s->plane[plane].l_h[0];
-            dsp->vert_filter(output, output_stride, low, lowpass_width, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[1];
-            high   = s->plane[plane].subband[3];
-            output = s->plane[plane].l_h[1];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[0];
-            high   = s->plane[plane].l_h[1];
-            output = s->plane[plane].l_h[7];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-            if (s->bpc == 12) {
-                output = s->plane[plane].l_h[7];
-                for (i = 0; i < lowpass_height * 2; i++) {
-                    for (j = 0; j < lowpass_width * 2; j++)
-                        output[j] *= 4;
-
-                    output += output_stride * 2;
-                }
-            }
-
-            lowpass_height  = s->plane[plane].band[1][1].height;
-            output_stride   = s->plane[plane].band[1][1].a_width;
-            lowpass_width   = s->plane[plane].band[1][1].width;
-            highpass_stride = s->plane[plane].band[1][1].stride;
-
-            if (lowpass_height > s->plane[plane].band[1][1].a_height || lowpass_width > s->plane[plane].band[1][1].a_width ||
-                !highpass_stride || s->plane[plane].band[1][1].width > s->plane[plane].band[1][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Level 2 lowpass plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            low    = s->plane[plane].l_h[7];
-            high   = s->plane[plane].subband[5];
-            output = s->plane[plane].l_h[3];
-            dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+    if (avctx->lowres && s->transform_type != 0) {
+        avpriv_report_missing_feature(avctx, "Lowres decoding of 3D transform");
+        ret = AVERROR_PATCHWELCOME;
+        goto end;
+    }
 
-            low    = s->plane[plane].subband[4];
-            high   = s->plane[plane].subband[6];
-            output = s->plane[plane].l_h[4];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+    for (plane = 0; plane < s->planes; plane++)
+        s->plane[plane].out_low = s->plane[plane].out_high = NULL;
 
-            low    = s->plane[plane].l_h[3];
-            high   = s->plane[plane].l_h[4];
-            output = s->plane[plane].l_h[7];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+    if ((s->transform_type == 0 && s->sample_type != 1) ||
+        (s->transform_type == 2 && (avctx->internal->is_copy || s->frame_index == 1 || s->sample_type != 1))) {
+        int plane_ret[4] = { 0 };
 
-            output = s->plane[plane].l_h[7];
-            for (i = 0; i < lowpass_height * 2; i++) {
-                for (j = 0; j < lowpass_width * 2; j++)
-                    output[j] *= 4;
-                output += output_stride * 2;
-            }
+        if (!s->progressive && !avctx->lowres)
+            pic->interlaced_frame = 1;
 
-            low    = s->plane[plane].subband[7];
-            high   = s->plane[plane].subband[9];
-            output = s->plane[plane].l_h[3];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[8];
-            high   = s->plane[plane].subband[10];
-            output = s->plane[plane].l_h[4];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[3];
-            high   = s->plane[plane].l_h[4];
-            output = s->plane[plane].l_h[9];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-
-            lowpass_height  = s->plane[plane].band[4][1].height;
-            output_stride   = s->plane[plane].band[4][1].a_width;
-            lowpass_width   = s->plane[plane].band[4][1].width;
-            highpass_stride = s->plane[plane].band[4][1].stride;
-            av_log(avctx, AV_LOG_DEBUG, "temporal level %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            if (lowpass_height > s->plane[plane].band[4][1].a_height || lowpass_width > s->plane[plane].band[4][1].a_width ||
-                !highpass_stride || s->plane[plane].band[4][1].width > s->plane[plane].band[4][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
+        avctx->execute2(avctx, reconstruct_plane, NULL, plane_ret, s->planes);
+        for (plane = 0; plane < s->planes; plane++) {
+            if (plane_ret[plane] < 0) {
+                ret = plane_ret[plane];
                 goto end;
             }
-
-            low    = s->plane[plane].l_h[7];
-            high   = s->plane[plane].l_h[9];
-            output = s->plane[plane].l_h[7];
-            for (i = 0; i < lowpass_height; i++) {
-                inverse_temporal_filter(low, high, lowpass_width);
-                low    += output_stride;
-                high   += output_stride;
-            }
-            if (s->progressive) {
-                low    = s->plane[plane].l_h[7];
-                high   = s->plane[plane].subband[15];
-                output = s->plane[plane].l_h[6];
-                dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[14];
-                high   = s->plane[plane].subband[16];
-                output = s->plane[plane].l_h[7];
-                dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].l_h[9];
-                high   = s->plane[plane].subband[12];
-                output = s->plane[plane].l_h[8];
-                dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[11];
-                high   = s->plane[plane].subband[13];
-                output = s->plane[plane].l_h[9];
-                dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                if (s->sample_type == 1)
-                    continue;
-
-                dst = (int16_t *)pic->data[act_plane];
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                    if (plane & 1)
-                        dst++;
-                    if (plane > 1)
-                        dst += pic->linesize[act_plane] >> 1;
-                }
-
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
-                    (lowpass_height * 2 > avctx->coded_height / 2 ||
-                     lowpass_width  * 2 > avctx->coded_width  / 2    )
-                    ) {
-                    ret = AVERROR_INVALIDDATA;
-                    goto end;
-                }
-
-                low  = s->plane[plane].l_h[6];
-                high = s->plane[plane].l_h[7];
-                for (i = 0; i < s->plane[act_plane].height; i++) {
-                    dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
-                    low  += output_stride;
-                    high += output_stride;
-                    dst  += dst_linesize;
-                }
-            } else {
-                pic->interlaced_frame = 1;
-                low    = s->plane[plane].l_h[7];
-                high   = s->plane[plane].subband[14];
-                output = s->plane[plane].l_h[6];
-                dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[15];
-                high   = s->plane[plane].subband[16];
-                output = s->plane[plane].l_h[7];
-                dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].l_h[9];
-                high   = s->plane[plane].subband[11];
-                output = s->plane[plane].l_h[8];
-                dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[12];
-                high   = s->plane[plane].subband[13];
-                output = s->plane[plane].l_h[9];
-                dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                if (s->sample_type == 1)
-                    continue;
-
-                dst  = (int16_t *)pic->data[act_plane];
-                low  = s->plane[plane].l_h[6];
-                high = s->plane[plane].l_h[7];
-                for (i = 0; i < s->plane[act_plane].height / 2; i++) {
-                    interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
-                    low  += output_stride * 2;
-                    high += output_stride * 2;
-                    dst  += pic->linesize[act_plane];
-                }
-            }
         }
     }
 
     if (s->transform_type == 2 && s->sample_type == 1) {
-        int16_t *low, *high, *dst;
-        int output_stride, lowpass_height, lowpass_width;
-        ptrdiff_t dst_linesize;
-
         for (plane = 0; plane < s->planes; plane++) {
-            int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
+            Plane *p = &s->plane[plane];
+            int lowpass_height = p->band[4][1].height;
+            int output_stride  = p->band[4][1].a_width;
+            int lowpass_width  = p->band[4][1].width;
 
-            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                act_plane = 0;
-                dst_linesize = pic->linesize[act_plane];
-            } else {
-                dst_linesize = pic->linesize[act_plane] / 2;
-            }
-
-            lowpass_height  = s->plane[plane].band[4][1].height;
-            output_stride   = s->plane[plane].band[4][1].a_width;
-            lowpass_width   = s->plane[plane].band[4][1].width;
-
-            if (lowpass_height > s->plane[plane].band[4][1].a_height || lowpass_width > s->plane[plane].band[4][1].a_width ||
-                s->plane[plane].band[4][1].width > s->plane[plane].band[4][1].a_width ||
+            if (lowpass_height > p->band[4][1].a_height || lowpass_width > p->band[4][1].a_width ||
+                p->band[4][1].width > p->band[4][1].a_width ||
                 lowpass_width < 3 || lowpass_height < 3) {
                 av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
                 ret = AVERROR(EINVAL);
                 goto end;
             }
 
-            if (s->progressive) {
-                dst = (int16_t *)pic->data[act_plane];
-                low  = s->plane[plane].l_h[8];
-                high = s->plane[plane].l_h[9];
-
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                    if (plane & 1)
-                        dst++;
-                    if (plane > 1)
-                        dst += pic->linesize[act_plane] >> 1;
-                }
+            if (s->progressive &&
+                (ret = check_bayer_dimensions(avctx, lowpass_width, lowpass_height)) < 0)
+                goto end;
 
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
-                    (lowpass_height * 2 > avctx->coded_height / 2 ||
-                     lowpass_width  * 2 > avctx->coded_width  / 2    )
-                    ) {
-                    ret = AVERROR_INVALIDDATA;
-                    goto end;
-                }
+            set_plane_output(p, p->l_h[8], p->l_h[9], lowpass_width, output_stride);
+        }
+    }
 
-                for (i = 0; i < s->plane[act_plane].height; i++) {
-                    dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
-                    low  += output_stride;
-                    high += output_stride;
-                    dst  += dst_linesize;
-                }
-            } else {
-                dst  = (int16_t *)pic->data[act_plane];
-                low  = s->plane[plane].l_h[8];
-                high = s->plane[plane].l_h[9];
-                for (i = 0; i < s->plane[act_plane].height / 2; i++) {
-                    interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
-                    low  += output_stride * 2;
-                    high += output_stride * 2;
-                    dst  += pic->linesize[act_plane];
-                }
-            }
+    s->nb_slices = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        s->nb_slices = av_clip(avctx->thread_count, 1, s->plane[0].height >> 3);
+
+    if (avctx->pix_fmt == AV_PIX_FMT_GBRP16) {
+        /* six lines per slice, each padded for the mirrored edges and SIMD overwrite */
+        s->demosaic_stride = FFALIGN(avctx->coded_width, 32) + 64;
+        av_fast_mallocz(&s->demosaic_buf, &s->demosaic_buf_size,
+                       s->nb_slices * 6 * s->demosaic_stride * sizeof(*s->demosaic_buf));
+        if (!s->demosaic_buf) {
+            s->demosaic_buf_size = 0;
+            ret = AVERROR(ENOMEM);
+            goto end;
         }
     }
 
-    if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16)
-        process_bayer(pic, s->bpc);
+    avctx->execute2(avctx, output_slice, pic, NULL, s->nb_slices);
 end:
     if (ret < 0)
         return ret;
@@ -1403,6 +1558,7 @@ static av_cold int cfhd_close(AVCodecContext *avctx)
     CFHDContext *s = avctx->priv_data;
 
     free_buffers(s);
+    av_freep(&s->demosaic_buf);
 
     ff_free_vlc(&s->vlc_9);
     ff_free_vlc(&s->vlc_18);
@@ -1455,16 +1611,34 @@ static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
 }
 #endif
 
+#define OFFSET(x) offsetof(CFHDContext, x)
+#define VD AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_DECODING_PARAM
+static const AVOption options[] = {
+    { "demosaic", "Output demosaiced RGB instead of Bayer samples for RAW streams", OFFSET(demosaic),
+        AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, VD },
+    { NULL },
+};
+
+static const AVClass cfhd_class = {
+    .class_name = "CFHD",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 const FFCodec ff_cfhd_decoder = {
     .p.name           = "cfhd",
     .p.long_name      = NULL_IF_CONFIG_SMALL("GoPro CineForm HD"),
     .p.type           = AVMEDIA_TYPE_VIDEO,
     .p.id             = AV_CODEC_ID_CFHD,
+    .p.priv_class     = &cfhd_class,
     .priv_data_size   = sizeof(CFHDContext),
     .init             = cfhd_init,
     .close            = cfhd_close,
     FF_CODEC_DECODE_CB(cfhd_decode),
+    .p.max_lowres     = 3,
     .update_thread_context = ONLY_IF_THREADS_ENABLED(update_thread_context),
-    .p.capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
+    .p.capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                        AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal    = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_INIT_CLEANUP,
 };
@@ -129,6 +129,13 @@ typedef struct Plane {
     int16_t *l_h[10];
 
     SubBand band[DWT_LEVELS_3D][4];
+
+    /* inputs of the final inverse transform, written to the output frame */
+    int16_t *out_low;
+    int16_t *out_high;
+    int      out_width;
+    int      out_height;
+    int      out_stride;
 } Plane;
 
 typedef struct Peak {
@@ -138,6 +145,7 @@ typedef struct Peak {
 } Peak;
 
 typedef struct CFHDContext {
+    const AVClass *class;
     AVCodecContext *avctx;
 
     CFHD_RL_VLC_ELEM table_9_rl_vlc[2088];
@@ -151,6 +159,7 @@ typedef struct CFHDContext {
     GetBitContext gb;
 
     int planes;
+    int nb_slices;
     int frame_type;
     int frame_index;
     int sample_type;
@@ -185,6 +194,11 @@ typedef struct CFHDContext {
     Peak peak;
 
     CFHDDSPContext dsp;
+
+    int demosaic;            ///< output demosaiced GBRP16 for Bayer streams
+    uint16_t *demosaic_buf;  ///< per-slice mosaic lines, see output_demosaic_slice()
+    unsigned demosaic_buf_size;
+    ptrdiff_t demosaic_stride;
 } CFHDContext;
 
 int ff_cfhd_init_vlcs(CFHDContext *s);
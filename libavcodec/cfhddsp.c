@@ -20,9 +20,13 @@
 
 #include "libavutil/attributes.h"
 #include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
 
 #include "cfhddsp.h"
 
+#define ALPHA_COMPAND_DC_OFFSET 256
+#define ALPHA_COMPAND_GAIN 9400
+
 static av_always_inline void filter(int16_t *output, ptrdiff_t out_stride,
                           const int16_t *low, ptrdiff_t low_stride,
                           const int16_t *high, ptrdiff_t high_stride,
@@ -102,6 +106,82 @@ static void horiz_filter_clip_bayer(int16_t *output, const int16_t *low, const i
     filter(output, 2, low, 1, high, 1, width, clip);
 }
 
+static void difference_coding(int16_t *band, int width, int height)
+{
+    for (int i = 0; i < height; i++) {
+        for (int j = 1; j < width; j++)
+            band[j] += band[j - 1];
+        band += width;
+    }
+}
+
+static int peak_table(int16_t *band, int length, int threshold,
+                      const uint8_t *peaks, int nb_peaks)
+{
+    int n = 0;
+
+    for (int i = 0; i < length; i++) {
+        if (abs(band[i]) >= threshold) {
+            band[i] = n < nb_peaks ? AV_RL16(peaks + 2 * n) : 0;
+            n++;
+        }
+    }
+
+    return n;
+}
+
+static void process_alpha(int16_t *alpha, int width)
+{
+    for (int i = 0; i < width; i++) {
+        int channel = alpha[i];
+
+        channel  -= ALPHA_COMPAND_DC_OFFSET;
+        channel <<= 3;
+        channel  *= ALPHA_COMPAND_GAIN;
+        channel >>= 16;
+        alpha[i]  = av_clip_uintp2(channel, 12);
+    }
+}
+
+static void process_bayer(uint16_t *dst, ptrdiff_t linesize,
+                          int width, int height, int bpc)
+{
+    uint16_t *r  = dst;
+    uint16_t *g1 = dst + 1;
+    uint16_t *g2 = dst + linesize / 2;
+    uint16_t *b  = dst + linesize / 2 + 1;
+    const int mid = 1 << (bpc - 1);
+    const int factor = 1 << (16 - bpc);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x += 2) {
+            int R, G1, G2, B;
+            int g, rg, bg, gd;
+
+            g  = r[x];
+            rg = g1[x];
+            bg = g2[x];
+            gd = b[x];
+            gd -= mid;
+
+            R  = (rg - mid) * 2 + g;
+            G1 = g + gd;
+            G2 = g - gd;
+            B  = (bg - mid) * 2 + g;
+
+            r[x]  = av_clip_uintp2(R  * factor, 16);
+            g1[x] = av_clip_uintp2(G1 * factor, 16);
+            g2[x] = av_clip_uintp2(G2 * factor, 16);
+            b[x]  = av_clip_uintp2(B  * factor, 16);
+        }
+
+        r  += linesize;
+        g1 += linesize;
+        g2 += linesize;
+        b  += linesize;
+    }
+}
+
 av_cold void ff_cfhddsp_init(CFHDDSPContext *c, int depth, int bayer)
 {
     c->horiz_filter = horiz_filter;
@@ -112,6 +192,11 @@ av_cold void ff_cfhddsp_init(CFHDDSPContext *c, int depth, int bayer)
     else
         c->horiz_filter_clip = horiz_filter_clip;
 
+    c->difference_coding = difference_coding;
+    c->peak_table        = peak_table;
+    c->process_alpha     = process_alpha;
+    c->process_bayer     = process_bayer;
+
 #if ARCH_X86
     ff_cfhddsp_init_x86(c, depth, bayer);
 #endif
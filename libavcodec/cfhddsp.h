@@ -35,6 +35,36 @@ typedef struct CFHDDSPContext {
 
     void (*horiz_filter_clip)(int16_t *output, const int16_t *low, const int16_t *high,
                               int width, int bpc);
+
+    /**
+     * Undo the horizontal difference coding of a band, i.e. replace each
+     * row with its running sum. Rows are width coefficients apart.
+     */
+    void (*difference_coding)(int16_t *band, int width, int height);
+
+    /**
+     * Replace every coefficient whose magnitude is at least threshold with
+     * the next little-endian value from peaks. Values past the nb_peaks
+     * available ones are replaced with 0.
+     * threshold must be in the range [1, 32768].
+     *
+     * @return the number of replaced coefficients
+     */
+    int (*peak_table)(int16_t *band, int length, int threshold,
+                      const uint8_t *peaks, int nb_peaks);
+
+    /**
+     * Decompand a row of 12-bit alpha samples in place.
+     * Input samples must be in the range [0, 4095].
+     */
+    void (*process_alpha)(int16_t *alpha, int width);
+
+    /**
+     * Convert height pairs of rows from the coded (G, R-G, B-G, G difference)
+     * representation to RGGB Bayer samples scaled to 16 bits, in place.
+     */
+    void (*process_bayer)(uint16_t *dst, ptrdiff_t linesize,
+                          int width, int height, int bpc);
 } CFHDDSPContext;
 
 void ff_cfhddsp_init(CFHDDSPContext *c, int format, int bayer);
@@ -219,6 +219,9 @@ typedef struct PlaneEnc {
 
     unsigned quantization[SUBBAND_COUNT];
     int16_t *subband[SUBBAND_COUNT];
+    uint8_t *band_buf[SUBBAND_COUNT];
+    unsigned band_buf_size[SUBBAND_COUNT];
+    int      band_size[SUBBAND_COUNT];
     int16_t *l_h[8];
 
     SubBand band[DWT_LEVELS][4];
@@ -227,7 +230,6 @@ typedef struct PlaneEnc {
 typedef struct CFHDEncContext {
     const AVClass *class;
 
-    PutBitContext       pb;
     PutByteContext      pby;
 
     int quality;
@@ -239,6 +241,8 @@ typedef struct CFHDEncContext {
     uint16_t lut[1024];
     Runbook  rb[321];
     Codebook cb[513];
+    int max_bits;     ///< longest value or run codeword
+    int max_run_bits; ///< longest code for a run of less than 320 zeros
     int16_t *alpha;
 
     CFHDEncDSPContext dsp;
@@ -350,6 +354,35 @@ static av_cold int cfhd_encode_init(AVCodecContext *avctx)
     s->rb[320].size = runbook[17][0];
     s->rb[320].run = 320;
 
+    /* Every codeword covers at least one coefficient, a value or a part of
+     * a run of zeros, so the longest codeword bounds the size of a row. */
+    for (int i = 0; i < 512; i++)
+        s->max_bits = FFMAX(s->max_bits, s->cb[i].size);
+    for (int i = 1; i <= 320; i++) {
+        int bits = 0;
+
+        for (int count = i; count > 0; count -= s->rb[FFMIN(320, count)].run)
+            bits += s->rb[FFMIN(320, count)].size;
+        if (i < 320)
+            s->max_run_bits = FFMAX(s->max_run_bits, bits);
+        s->max_bits = FFMAX(s->max_bits, s->rb[i].size);
+    }
+
+    /* Highpass bands are entropy coded in parallel into these buffers. They
+     * start at the 16 bits per coefficient the packet used to be allocated
+     * with and grow in encode_band() if a band needs more. */
+    for (int i = 0; i < s->planes; i++) {
+        for (int j = 1; j < SUBBAND_COUNT; j++) {
+            const SubBand *band = &s->plane[i].band[(j - 1) / 3][0];
+            int size = 2 * FFALIGN(band->width, 8) * band->height + 64;
+
+            s->plane[i].band_buf[j] = av_malloc(size);
+            if (!s->plane[i].band_buf[j])
+                return AVERROR(ENOMEM);
+            s->plane[i].band_buf_size[j] = size;
+        }
+    }
+
     for (int i = 0; i < 256; i++) {
         int idx = i + ((768LL * i * i * i) / (256 * 256 * 256));
 
@@ -419,135 +452,241 @@ static void process_alpha(const int16_t *src, int width, int height, ptrdiff_t s
     }
 }
 
-static int cfhd_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
-                             const AVFrame *frame, int *got_packet)
+static int forward_transform(AVCodecContext *avctx, void *arg, int plane, int threadnr)
 {
     CFHDEncContext *s = avctx->priv_data;
     CFHDEncDSPContext *dsp = &s->dsp;
-    PutByteContext *pby = &s->pby;
-    PutBitContext *pb = &s->pb;
-    const Codebook *const cb = s->cb;
-    const Runbook *const rb = s->rb;
-    const uint16_t *lut = s->lut;
-    unsigned pos;
-    int ret;
-
-    for (int plane = 0; plane < s->planes; plane++) {
-        int width = s->plane[plane].band[2][0].width;
-        int a_width = s->plane[plane].band[2][0].a_width;
-        int height = s->plane[plane].band[2][0].height;
-        int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
-        int16_t *input = (int16_t *)frame->data[act_plane];
-        int16_t *low = s->plane[plane].l_h[6];
-        int16_t *high = s->plane[plane].l_h[7];
-        ptrdiff_t in_stride = frame->linesize[act_plane] / 2;
-        int low_stride, high_stride;
-
-        if (plane == 3) {
-            process_alpha(input, avctx->width, avctx->height,
-                          in_stride, s->alpha);
-            input = s->alpha;
-            in_stride = avctx->width;
-        }
+    const AVFrame *frame = arg;
+    int width = s->plane[plane].band[2][0].width;
+    int a_width = s->plane[plane].band[2][0].a_width;
+    int height = s->plane[plane].band[2][0].height;
+    int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
+    int16_t *input = (int16_t *)frame->data[act_plane];
+    int16_t *low = s->plane[plane].l_h[6];
+    int16_t *high = s->plane[plane].l_h[7];
+    ptrdiff_t in_stride = frame->linesize[act_plane] / 2;
+    int low_stride, high_stride;
+
+    if (plane == 3) {
+        process_alpha(input, avctx->width, avctx->height,
+                      in_stride, s->alpha);
+        input = s->alpha;
+        in_stride = avctx->width;
+    }
 
-        dsp->horiz_filter(input, low, high,
-                          in_stride, a_width, a_width,
-                          width * 2, height * 2);
-
-        input = s->plane[plane].l_h[7];
-        low = s->plane[plane].subband[7];
-        low_stride = s->plane[plane].band[2][0].a_width;
-        high = s->plane[plane].subband[9];
-        high_stride = s->plane[plane].band[2][0].a_width;
-
-        dsp->vert_filter(input, low, high,
-                         a_width, low_stride, high_stride,
-                         width, height * 2);
-
-        input = s->plane[plane].l_h[6];
-        low = s->plane[plane].l_h[7];
-        high = s->plane[plane].subband[8];
-
-        dsp->vert_filter(input, low, high,
-                         a_width, low_stride, high_stride,
-                         width, height * 2);
-
-        a_width = s->plane[plane].band[1][0].a_width;
-        width = s->plane[plane].band[1][0].width;
-        height = s->plane[plane].band[1][0].height;
-        input = s->plane[plane].l_h[7];
-        low = s->plane[plane].l_h[3];
-        low_stride = s->plane[plane].band[1][0].a_width;
-        high = s->plane[plane].l_h[4];
-        high_stride = s->plane[plane].band[1][0].a_width;
+    dsp->horiz_filter(input, low, high,
+                      in_stride, a_width, a_width,
+                      width * 2, height * 2);
+
+    input = s->plane[plane].l_h[7];
+    low = s->plane[plane].subband[7];
+    low_stride = s->plane[plane].band[2][0].a_width;
+    high = s->plane[plane].subband[9];
+    high_stride = s->plane[plane].band[2][0].a_width;
+
+    dsp->vert_filter(input, low, high,
+                     a_width, low_stride, high_stride,
+                     width, height * 2);
+
+    input = s->plane[plane].l_h[6];
+    low = s->plane[plane].l_h[7];
+    high = s->plane[plane].subband[8];
+
+    dsp->vert_filter(input, low, high,
+                     a_width, low_stride, high_stride,
+                     width, height * 2);
+
+    a_width = s->plane[plane].band[1][0].a_width;
+    width = s->plane[plane].band[1][0].width;
+    height = s->plane[plane].band[1][0].height;
+    input = s->plane[plane].l_h[7];
+    low = s->plane[plane].l_h[3];
+    low_stride = s->plane[plane].band[1][0].a_width;
+    high = s->plane[plane].l_h[4];
+    high_stride = s->plane[plane].band[1][0].a_width;
+
+    for (int i = 0; i < height * 2; i++) {
+        for (int j = 0; j < width * 2; j++)
+            input[j] /= 4;
+        input += a_width * 2;
+    }
 
+    input = s->plane[plane].l_h[7];
+    dsp->horiz_filter(input, low, high,
+                      a_width * 2, low_stride, high_stride,
+                      width * 2, height * 2);
+
+    input = s->plane[plane].l_h[4];
+    low = s->plane[plane].subband[4];
+    high = s->plane[plane].subband[6];
+
+    dsp->vert_filter(input, low, high,
+                     a_width, low_stride, high_stride,
+                     width, height * 2);
+
+    input = s->plane[plane].l_h[3];
+    low = s->plane[plane].l_h[4];
+    high = s->plane[plane].subband[5];
+
+    dsp->vert_filter(input, low, high,
+                     a_width, low_stride, high_stride,
+                     width, height * 2);
+
+    a_width = s->plane[plane].band[0][0].a_width;
+    width = s->plane[plane].band[0][0].width;
+    height = s->plane[plane].band[0][0].height;
+    input = s->plane[plane].l_h[4];
+    low = s->plane[plane].l_h[0];
+    low_stride = s->plane[plane].band[0][0].a_width;
+    high = s->plane[plane].l_h[1];
+    high_stride = s->plane[plane].band[0][0].a_width;
+
+    if (avctx->pix_fmt != AV_PIX_FMT_YUV422P10) {
         for (int i = 0; i < height * 2; i++) {
             for (int j = 0; j < width * 2; j++)
                 input[j] /= 4;
             input += a_width * 2;
         }
+    }
+
+    input = s->plane[plane].l_h[4];
+    dsp->horiz_filter(input, low, high,
+                      a_width * 2, low_stride, high_stride,
+                      width * 2, height * 2);
+
+    low = s->plane[plane].subband[1];
+    high = s->plane[plane].subband[3];
+    input = s->plane[plane].l_h[1];
 
-        input = s->plane[plane].l_h[7];
-        dsp->horiz_filter(input, low, high,
-                          a_width * 2, low_stride, high_stride,
-                          width * 2, height * 2);
-
-        input = s->plane[plane].l_h[4];
-        low = s->plane[plane].subband[4];
-        high = s->plane[plane].subband[6];
-
-        dsp->vert_filter(input, low, high,
-                         a_width, low_stride, high_stride,
-                         width, height * 2);
-
-        input = s->plane[plane].l_h[3];
-        low = s->plane[plane].l_h[4];
-        high = s->plane[plane].subband[5];
-
-        dsp->vert_filter(input, low, high,
-                         a_width, low_stride, high_stride,
-                         width, height * 2);
-
-        a_width = s->plane[plane].band[0][0].a_width;
-        width = s->plane[plane].band[0][0].width;
-        height = s->plane[plane].band[0][0].height;
-        input = s->plane[plane].l_h[4];
-        low = s->plane[plane].l_h[0];
-        low_stride = s->plane[plane].band[0][0].a_width;
-        high = s->plane[plane].l_h[1];
-        high_stride = s->plane[plane].band[0][0].a_width;
-
-        if (avctx->pix_fmt != AV_PIX_FMT_YUV422P10) {
-            for (int i = 0; i < height * 2; i++) {
-                for (int j = 0; j < width * 2; j++)
-                    input[j] /= 4;
-                input += a_width * 2;
+    dsp->vert_filter(input, low, high,
+                     a_width, low_stride, high_stride,
+                     width, height * 2);
+
+    low = s->plane[plane].subband[0];
+    high = s->plane[plane].subband[2];
+    input = s->plane[plane].l_h[0];
+
+    dsp->vert_filter(input, low, high,
+                     a_width, low_stride, high_stride,
+                     width, height * 2);
+
+    return 0;
+}
+
+/* Make room for at least min_size more bytes in the buffer of band b. */
+static int grow_band_buf(PlaneEnc *plane, int b, PutBitContext *pb, int64_t min_size)
+{
+    uint8_t *buf;
+
+    min_size = FFMAX(min_size + put_bytes_output(pb), plane->band_buf_size[b] * 3LL / 2);
+    if (min_size > INT_MAX / 2)
+        return AVERROR(ENOMEM);
+
+    buf = av_fast_realloc(plane->band_buf[b], &plane->band_buf_size[b], min_size);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    plane->band_buf[b] = buf;
+    rebase_put_bits(pb, buf, plane->band_buf_size[b]);
+
+    return 0;
+}
+
+static int encode_band(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    CFHDEncContext *s = avctx->priv_data;
+    const Codebook *const cb = s->cb;
+    const Runbook *const rb = s->rb;
+    const uint16_t *lut = s->lut;
+    const int p = jobnr / (SUBBAND_COUNT - 1);
+    const int b = jobnr % (SUBBAND_COUNT - 1) + 1;
+    PlaneEnc *plane = &s->plane[p];
+    const SubBand *band = &plane->band[(b - 1) / 3][0];
+    int a_width = band->a_width;
+    int width = band->width;
+    int stride = FFALIGN(width, 8);
+    int height = band->height;
+    int16_t *data = plane->subband[b];
+    int count = 0, ret;
+    PutBitContext pb;
+
+    quantize_band(data, width, a_width, height, plane->quantization[b]);
+
+    init_put_bits(&pb, plane->band_buf[b], plane->band_buf_size[b]);
+
+    for (int m = 0; m < height; m++) {
+        /* worst case for this row: the pending run continued by the whole
+         * row, one codeword per coefficient and the band end code */
+        int64_t row_bits = ((count + stride) / 320 + 1LL) * rb[320].size + s->max_run_bits +
+                           (int64_t)stride * s->max_bits + cb[512].size;
+
+        if (put_bits_left(&pb) < row_bits &&
+            (ret = grow_band_buf(plane, b, &pb, (row_bits + 7) / 8 + 8)) < 0)
+            return ret;
+
+        for (int j = 0; j < stride; j++) {
+            int16_t index = j >= width ? 0 : FFSIGN(data[j]) * lut[FFABS(data[j])];
+
+            if (index < 0)
+                index += 512;
+            if (index == 0) {
+                count++;
+                continue;
+            } else if (count > 0) {
+                count = put_runcode(&pb, count, rb);
             }
+
+            put_bits(&pb, cb[index].size, cb[index].bits);
         }
 
-        input = s->plane[plane].l_h[4];
-        dsp->horiz_filter(input, low, high,
-                          a_width * 2, low_stride, high_stride,
-                          width * 2, height * 2);
+        data += a_width;
+    }
+
+    if (count > 0) {
+        count = put_runcode(&pb, count, rb);
+    }
 
-        low = s->plane[plane].subband[1];
-        high = s->plane[plane].subband[3];
-        input = s->plane[plane].l_h[1];
+    put_bits(&pb, cb[512].size, cb[512].bits);
 
-        dsp->vert_filter(input, low, high,
-                         a_width, low_stride, high_stride,
-                         width, height * 2);
+    flush_put_bits(&pb);
+    plane->band_size[b] = put_bytes_output(&pb);
 
-        low = s->plane[plane].subband[0];
-        high = s->plane[plane].subband[2];
-        input = s->plane[plane].l_h[0];
+    return 0;
+}
 
-        dsp->vert_filter(input, low, high,
-                         a_width, low_stride, high_stride,
-                         width, height * 2);
+static int cfhd_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
+                             const AVFrame *frame, int *got_packet)
+{
+    CFHDEncContext *s = avctx->priv_data;
+    PutByteContext *pby = &s->pby;
+    unsigned pos;
+    int band_ret[4 * (SUBBAND_COUNT - 1)];
+    int64_t size = 64;
+    int ret;
+
+    avctx->execute2(avctx, forward_transform, (void *)frame, NULL, s->planes);
+
+    for (int p = 0; p < s->planes; p++) {
+        for (int l = 0; l < 3; l++) {
+            for (int i = 0; i < 3; i++) {
+                s->plane[p].quantization[1 + l * 3 + i] = quantization_per_subband[avctx->pix_fmt != AV_PIX_FMT_YUV422P10][p >= 3 ? 0 : p][s->quality][l * 3 + i];
+            }
+        }
     }
 
-    ret = ff_alloc_packet(avctx, pkt, 64LL + s->planes * (2LL * avctx->width * avctx->height + 1000LL));
+    avctx->execute2(avctx, encode_band, NULL, band_ret, s->planes * (SUBBAND_COUNT - 1));
+    for (int i = 0; i < s->planes * (SUBBAND_COUNT - 1); i++) {
+        if (band_ret[i] < 0)
+            return band_ret[i];
+    }
+
+    /* headers, 16-bit lowpass coefficients and the padded highpass bands */
+    for (int p = 0; p < s->planes; p++) {
+        size += 1000 + 2LL * s->plane[p].band[0][0].width * s->plane[p].band[0][0].height;
+        for (int b = 1; b < SUBBAND_COUNT; b++)
+            size += s->plane[p].band_size[b] + 3;
+    }
+
+    ret = ff_alloc_packet(avctx, pkt, size);
     if (ret < 0)
         return ret;
 
@@ -657,15 +796,7 @@ static int cfhd_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         bytestream2_put_be16(pby, 0x1b4b);
 
         for (int l = 0; l < 3; l++) {
-            for (int i = 0; i < 3; i++) {
-                s->plane[p].quantization[1 + l * 3 + i] = quantization_per_subband[avctx->pix_fmt != AV_PIX_FMT_YUV422P10][p >= 3 ? 0 : p][s->quality][l * 3 + i];
-            }
-        }
-
-        for (int l = 0; l < 3; l++) {
-            int a_width = s->plane[p].band[l][0].a_width;
             int width = s->plane[p].band[l][0].width;
-            int stride = FFALIGN(width, 8);
             int height = s->plane[p].band[l][0].height;
 
             bytestream2_put_be16(pby, BitstreamMarker);
@@ -702,8 +833,7 @@ static int cfhd_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             bytestream2_put_be16(pby, 1);
 
             for (int i = 0; i < 3; i++) {
-                int16_t *data = s->plane[p].subband[1 + l * 3 + i];
-                int count = 0, padd = 0;
+                int padd = 0;
 
                 bytestream2_put_be16(pby, BitstreamMarker);
                 bytestream2_put_be16(pby, 0x0e0e);
@@ -735,38 +865,8 @@ static int cfhd_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                 bytestream2_put_be16(pby, BandHeader);
                 bytestream2_put_be16(pby, 0);
 
-                quantize_band(data, width, a_width, height,
-                              s->plane[p].quantization[1 + l * 3 + i]);
-
-                init_put_bits(pb, pkt->data + bytestream2_tell_p(pby), bytestream2_get_bytes_left_p(pby));
-
-                for (int m = 0; m < height; m++) {
-                    for (int j = 0; j < stride; j++) {
-                        int16_t index = j >= width ? 0 : FFSIGN(data[j]) * lut[FFABS(data[j])];
-
-                        if (index < 0)
-                            index += 512;
-                        if (index == 0) {
-                            count++;
-                            continue;
-                        } else if (count > 0) {
-                            count = put_runcode(pb, count, rb);
-                        }
-
-                        put_bits(pb, cb[index].size, cb[index].bits);
-                    }
-
-                    data += a_width;
-                }
-
-                if (count > 0) {
-                    count = put_runcode(pb, count, rb);
-                }
-
-                put_bits(pb, cb[512].size, cb[512].bits);
-
-                flush_put_bits(pb);
-                bytestream2_skip_p(pby, put_bytes_output(pb));
+                bytestream2_put_buffer(pby, s->plane[p].band_buf[1 + l * 3 + i],
+                                       s->plane[p].band_size[1 + l * 3 + i]);
                 padd = (4 - (bytestream2_tell_p(pby) & 3)) & 3;
                 while (padd--)
                     bytestream2_put_byte(pby, 0);
@@ -806,8 +906,10 @@ static av_cold int cfhd_encode_close(AVCodecContext *avctx)
         av_freep(&s->plane[i].dwt_buf);
         av_freep(&s->plane[i].dwt_tmp);
 
-        for (int j = 0; j < SUBBAND_COUNT; j++)
+        for (int j = 0; j < SUBBAND_COUNT; j++) {
             s->plane[i].subband[j] = NULL;
+            av_freep(&s->plane[i].band_buf[j]);
+        }
 
         for (int j = 0; j < 8; j++)
             s->plane[i].l_h[j] = NULL;
@@ -855,7 +957,7 @@ const FFCodec ff_cfhd_encoder = {
     .init             = cfhd_encode_init,
     .close            = cfhd_encode_close,
     FF_CODEC_ENCODE_CB(cfhd_encode_frame),
-    .p.capabilities   = AV_CODEC_CAP_FRAME_THREADS,
+    .p.capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS,
     .p.pix_fmts       = (const enum AVPixelFormat[]) {
                           AV_PIX_FMT_YUV422P10,
                           AV_PIX_FMT_GBRP12,
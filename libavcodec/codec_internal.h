@@ -73,6 +73,12 @@
  * internal logic derive them from AVCodecInternal.last_pkt_props.
  */
 #define FF_CODEC_CAP_SETS_FRAME_PROPS       (1 << 8)
+/**
+ * The jobs the codec submits with execute()/execute2() wait for each other,
+ * so they need one dedicated thread each and cannot run on a shared
+ * AVCodecContext.thread_pool.
+ */
+#define FF_CODEC_CAP_SLICE_THREAD_SYNC      (1 << 9)
 
 /**
  * FFCodec.codec_tags termination value
@@ -573,14 +573,14 @@ static int decode_receive_frame_internal(AVCodecContext *avctx, AVFrame *frame)
     return ret;
 }
 
-int attribute_align_arg avcodec_send_packet(AVCodecContext *avctx, const AVPacket *avpkt)
+/**
+ * Queue a packet for decoding, without decoding anything yet.
+ */
+static int send_packet(AVCodecContext *avctx, const AVPacket *avpkt)
 {
     AVCodecInternal *avci = avctx->internal;
     int ret;
 
-    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(avctx->codec))
-        return AVERROR(EINVAL);
-
     if (avctx->internal->draining)
         return AVERROR_EOF;
 
@@ -600,6 +600,21 @@ int attribute_align_arg avcodec_send_packet(AVCodecContext *avctx, const AVPacke
         return ret;
     }
 
+    return 0;
+}
+
+int attribute_align_arg avcodec_send_packet(AVCodecContext *avctx, const AVPacket *avpkt)
+{
+    AVCodecInternal *avci = avctx->internal;
+    int ret;
+
+    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(avctx->codec))
+        return AVERROR(EINVAL);
+
+    ret = send_packet(avctx, avpkt);
+    if (ret < 0)
+        return ret;
+
     if (!avci->buffer_frame->buf[0]) {
         ret = decode_receive_frame_internal(avctx, avci->buffer_frame);
         if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
@@ -636,16 +651,13 @@ static int apply_cropping(AVCodecContext *avctx, AVFrame *frame)
                                           AV_FRAME_CROP_UNALIGNED : 0);
 }
 
-int attribute_align_arg avcodec_receive_frame(AVCodecContext *avctx, AVFrame *frame)
+static int receive_frame(AVCodecContext *avctx, AVFrame *frame)
 {
     AVCodecInternal *avci = avctx->internal;
     int ret, changed;
 
     av_frame_unref(frame);
 
-    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(avctx->codec))
-        return AVERROR(EINVAL);
-
     if (avci->buffer_frame->buf[0]) {
         av_frame_move_ref(frame, avci->buffer_frame);
     } else {
@@ -726,6 +738,53 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return 0;
 }
 
+int attribute_align_arg avcodec_receive_frame(AVCodecContext *avctx, AVFrame *frame)
+{
+    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(avctx->codec)) {
+        av_frame_unref(frame);
+        return AVERROR(EINVAL);
+    }
+
+    return receive_frame(avctx, frame);
+}
+
+int avcodec_decode_packets(AVCodecContext *avctx, const AVPacket * const *pkts,
+                           int *nb_pkts, AVFrame **frames, int *nb_frames)
+{
+    int max_pkts   = *nb_pkts;
+    int max_frames = *nb_frames;
+    int ret = 0;
+
+    *nb_pkts   = 0;
+    *nb_frames = 0;
+
+    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(avctx->codec) ||
+        max_pkts < 0 || max_frames < 0)
+        return AVERROR(EINVAL);
+
+    /* Only queue a packet once the decoder asks for one, so that frames are
+     * decoded straight into the caller's array rather than into buffer_frame
+     * first, as avcodec_send_packet() does. */
+    while (*nb_frames < max_frames) {
+        ret = receive_frame(avctx, frames[*nb_frames]);
+        if (ret >= 0) {
+            (*nb_frames)++;
+            continue;
+        }
+        if (ret == AVERROR_INPUT_CHANGED)
+            continue;
+        if (ret != AVERROR(EAGAIN) || *nb_pkts == max_pkts)
+            break;
+
+        ret = send_packet(avctx, pkts[*nb_pkts]);
+        if (ret < 0)
+            break;
+        (*nb_pkts)++;
+    }
+
+    return ret == AVERROR(EAGAIN) ? 0 : FFMIN(ret, 0);
+}
+
 static void get_subtitle_defaults(AVSubtitle *sub)
 {
     memset(sub, 0, sizeof(*sub));
@@ -1262,6 +1321,7 @@ int ff_decode_frame_props(AVCodecContext *avctx, AVFrame *frame)
         { AV_PKT_DATA_ICC_PROFILE,                AV_FRAME_DATA_ICC_PROFILE },
         { AV_PKT_DATA_S12M_TIMECODE,              AV_FRAME_DATA_S12M_TIMECODE },
         { AV_PKT_DATA_DYNAMIC_HDR10_PLUS,         AV_FRAME_DATA_DYNAMIC_HDR_PLUS },
+        { AV_PKT_DATA_TELEMETRY,                  AV_FRAME_DATA_TELEMETRY },
     };
 
     if (!(ffcodec(avctx->codec)->caps_internal & FF_CODEC_CAP_SETS_FRAME_PROPS)) {
@@ -720,17 +720,82 @@ static int boundary_strength(const HEVCContext *s, const MvField *curr, const Mv
     return 1;
 }
 
+static void upper_boundary_strengths(HEVCContext *s, int x0, int y0, int len,
+                                     const RefPicList *rpl_top)
+{
+    MvField *tab_mvf     = s->ref->tab_mvf;
+    int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
+    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
+    int min_pu_width     = s->ps.sps->min_pu_width;
+    int min_tu_width     = s->ps.sps->min_tb_width;
+    int yp_pu = (y0 - 1) >> log2_min_pu_size;
+    int yq_pu =  y0      >> log2_min_pu_size;
+    int yp_tu = (y0 - 1) >> log2_min_tu_size;
+    int yq_tu =  y0      >> log2_min_tu_size;
+    int i, bs;
+
+    for (i = 0; i < len; i += 4) {
+        int x_pu = (x0 + i) >> log2_min_pu_size;
+        int x_tu = (x0 + i) >> log2_min_tu_size;
+        MvField *top  = &tab_mvf[yp_pu * min_pu_width + x_pu];
+        MvField *curr = &tab_mvf[yq_pu * min_pu_width + x_pu];
+        uint8_t top_cbf_luma  = s->cbf_luma[yp_tu * min_tu_width + x_tu];
+        uint8_t curr_cbf_luma = s->cbf_luma[yq_tu * min_tu_width + x_tu];
+
+        if (curr->pred_flag == PF_INTRA || top->pred_flag == PF_INTRA)
+            bs = 2;
+        else if (curr_cbf_luma || top_cbf_luma)
+            bs = 1;
+        else
+            bs = boundary_strength(s, curr, top, rpl_top);
+        s->horizontal_bs[((x0 + i) + y0 * s->bs_width) >> 2] = bs;
+    }
+}
+
+static void left_boundary_strengths(HEVCContext *s, int x0, int y0, int len,
+                                    const RefPicList *rpl_left)
+{
+    MvField *tab_mvf     = s->ref->tab_mvf;
+    int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
+    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
+    int min_pu_width     = s->ps.sps->min_pu_width;
+    int min_tu_width     = s->ps.sps->min_tb_width;
+    int xp_pu = (x0 - 1) >> log2_min_pu_size;
+    int xq_pu =  x0      >> log2_min_pu_size;
+    int xp_tu = (x0 - 1) >> log2_min_tu_size;
+    int xq_tu =  x0      >> log2_min_tu_size;
+    int i, bs;
+
+    for (i = 0; i < len; i += 4) {
+        int y_pu      = (y0 + i) >> log2_min_pu_size;
+        int y_tu      = (y0 + i) >> log2_min_tu_size;
+        MvField *left = &tab_mvf[y_pu * min_pu_width + xp_pu];
+        MvField *curr = &tab_mvf[y_pu * min_pu_width + xq_pu];
+        uint8_t left_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xp_tu];
+        uint8_t curr_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xq_tu];
+
+        if (curr->pred_flag == PF_INTRA || left->pred_flag == PF_INTRA)
+            bs = 2;
+        else if (curr_cbf_luma || left_cbf_luma)
+            bs = 1;
+        else
+            bs = boundary_strength(s, curr, left, rpl_left);
+        s->vertical_bs[(x0 + (y0 + i) * s->bs_width) >> 2] = bs;
+    }
+}
+
 void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
                                            int log2_trafo_size)
 {
     HEVCLocalContext *lc = s->HEVClc;
     MvField *tab_mvf     = s->ref->tab_mvf;
     int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
-    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
     int min_pu_width     = s->ps.sps->min_pu_width;
-    int min_tu_width     = s->ps.sps->min_tb_width;
     int is_intra = tab_mvf[(y0 >> log2_min_pu_size) * min_pu_width +
                            (x0 >> log2_min_pu_size)].pred_flag == PF_INTRA;
+    /* with parallel tiles, the tile edges are done once both sides are decoded */
+    int skip_tile_edges = !s->ps.pps->loop_filter_across_tiles_enabled_flag ||
+                          s->enable_parallel_tiles;
     int boundary_upper, boundary_left;
     int i, j, bs;
 
@@ -739,7 +804,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
         ((!s->sh.slice_loop_filter_across_slices_enabled_flag &&
           lc->boundary_flags & BOUNDARY_UPPER_SLICE &&
           (y0 % (1 << s->ps.sps->log2_ctb_size)) == 0) ||
-         (!s->ps.pps->loop_filter_across_tiles_enabled_flag &&
+         (skip_tile_edges &&
           lc->boundary_flags & BOUNDARY_UPPER_TILE &&
           (y0 % (1 << s->ps.sps->log2_ctb_size)) == 0)))
         boundary_upper = 0;
@@ -748,27 +813,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
         const RefPicList *rpl_top = (lc->boundary_flags & BOUNDARY_UPPER_SLICE) ?
                                     ff_hevc_get_ref_list(s, s->ref, x0, y0 - 1) :
                                     s->ref->refPicList;
-        int yp_pu = (y0 - 1) >> log2_min_pu_size;
-        int yq_pu =  y0      >> log2_min_pu_size;
-        int yp_tu = (y0 - 1) >> log2_min_tu_size;
-        int yq_tu =  y0      >> log2_min_tu_size;
-
-            for (i = 0; i < (1 << log2_trafo_size); i += 4) {
-                int x_pu = (x0 + i) >> log2_min_pu_size;
-                int x_tu = (x0 + i) >> log2_min_tu_size;
-                MvField *top  = &tab_mvf[yp_pu * min_pu_width + x_pu];
-                MvField *curr = &tab_mvf[yq_pu * min_pu_width + x_pu];
-                uint8_t top_cbf_luma  = s->cbf_luma[yp_tu * min_tu_width + x_tu];
-                uint8_t curr_cbf_luma = s->cbf_luma[yq_tu * min_tu_width + x_tu];
-
-                if (curr->pred_flag == PF_INTRA || top->pred_flag == PF_INTRA)
-                    bs = 2;
-                else if (curr_cbf_luma || top_cbf_luma)
-                    bs = 1;
-                else
-                    bs = boundary_strength(s, curr, top, rpl_top);
-                s->horizontal_bs[((x0 + i) + y0 * s->bs_width) >> 2] = bs;
-            }
+        upper_boundary_strengths(s, x0, y0, 1 << log2_trafo_size, rpl_top);
     }
 
     // bs for vertical TU boundaries
@@ -777,7 +822,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
         ((!s->sh.slice_loop_filter_across_slices_enabled_flag &&
           lc->boundary_flags & BOUNDARY_LEFT_SLICE &&
           (x0 % (1 << s->ps.sps->log2_ctb_size)) == 0) ||
-         (!s->ps.pps->loop_filter_across_tiles_enabled_flag &&
+         (skip_tile_edges &&
           lc->boundary_flags & BOUNDARY_LEFT_TILE &&
           (x0 % (1 << s->ps.sps->log2_ctb_size)) == 0)))
         boundary_left = 0;
@@ -786,27 +831,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
         const RefPicList *rpl_left = (lc->boundary_flags & BOUNDARY_LEFT_SLICE) ?
                                      ff_hevc_get_ref_list(s, s->ref, x0 - 1, y0) :
                                      s->ref->refPicList;
-        int xp_pu = (x0 - 1) >> log2_min_pu_size;
-        int xq_pu =  x0      >> log2_min_pu_size;
-        int xp_tu = (x0 - 1) >> log2_min_tu_size;
-        int xq_tu =  x0      >> log2_min_tu_size;
-
-            for (i = 0; i < (1 << log2_trafo_size); i += 4) {
-                int y_pu      = (y0 + i) >> log2_min_pu_size;
-                int y_tu      = (y0 + i) >> log2_min_tu_size;
-                MvField *left = &tab_mvf[y_pu * min_pu_width + xp_pu];
-                MvField *curr = &tab_mvf[y_pu * min_pu_width + xq_pu];
-                uint8_t left_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xp_tu];
-                uint8_t curr_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xq_tu];
-
-                if (curr->pred_flag == PF_INTRA || left->pred_flag == PF_INTRA)
-                    bs = 2;
-                else if (curr_cbf_luma || left_cbf_luma)
-                    bs = 1;
-                else
-                    bs = boundary_strength(s, curr, left, rpl_left);
-                s->vertical_bs[(x0 + (y0 + i) * s->bs_width) >> 2] = bs;
-            }
+        left_boundary_strengths(s, x0, y0, 1 << log2_trafo_size, rpl_left);
     }
 
     if (log2_trafo_size > log2_min_pu_size && !is_intra) {
@@ -851,15 +876,27 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
 void ff_hevc_hls_filter(HEVCContext *s, int x, int y, int ctb_size)
 {
     int x_end = x >= s->ps.sps->width  - ctb_size;
+    int slice_type    = s->sh.slice_type;
+    int nal_unit_type = s->nal_unit_type;
     int skip = 0;
+
+    /* the picture filter runs once all the slices are decoded */
+    if (s->enable_parallel_tiles) {
+        int ctb_addr_rs = (y >> s->ps.sps->log2_ctb_size) * s->ps.sps->ctb_width +
+                          (x >> s->ps.sps->log2_ctb_size);
+        slice_type    = s->deblock[ctb_addr_rs].slice_type;
+        nal_unit_type = s->first_nal_type;
+    }
+
     if (s->avctx->skip_loop_filter >= AVDISCARD_ALL ||
-        (s->avctx->skip_loop_filter >= AVDISCARD_NONKEY && !IS_IDR(s)) ||
+        (s->avctx->skip_loop_filter >= AVDISCARD_NONKEY &&
+         nal_unit_type != HEVC_NAL_IDR_W_RADL && nal_unit_type != HEVC_NAL_IDR_N_LP) ||
         (s->avctx->skip_loop_filter >= AVDISCARD_NONINTRA &&
-         s->sh.slice_type != HEVC_SLICE_I) ||
+         slice_type != HEVC_SLICE_I) ||
         (s->avctx->skip_loop_filter >= AVDISCARD_BIDIR &&
-         s->sh.slice_type == HEVC_SLICE_B) ||
+         slice_type == HEVC_SLICE_B) ||
         (s->avctx->skip_loop_filter >= AVDISCARD_NONREF &&
-        ff_hevc_nal_is_nonref(s->nal_unit_type)))
+        ff_hevc_nal_is_nonref(nal_unit_type)))
         skip = 1;
 
     if (!skip)
@@ -895,3 +932,51 @@ void ff_hevc_hls_filters(HEVCContext *s, int x_ctb, int y_ctb, int ctb_size)
     if (x_ctb && y_end)
         ff_hevc_hls_filter(s, x_ctb - ctb_size, y_ctb, ctb_size);
 }
+
+/**
+ * Compute the boundary strengths of the tile edges skipped while the tiles
+ * were decoded in parallel, then filter the whole picture in raster order.
+ */
+void ff_hevc_hls_filter_picture(HEVCContext *s)
+{
+    const HEVCSPS *sps = s->ps.sps;
+    const HEVCPPS *pps = s->ps.pps;
+    RefPicList *rpl    = s->ref->refPicList;
+    int ctb_size       = 1 << sps->log2_ctb_size;
+    int x_ctb, y_ctb;
+
+    for (y_ctb = 0; y_ctb < sps->height && pps->loop_filter_across_tiles_enabled_flag; y_ctb += ctb_size) {
+        for (x_ctb = 0; x_ctb < sps->width; x_ctb += ctb_size) {
+            int rs   = (y_ctb >> sps->log2_ctb_size) * sps->ctb_width + (x_ctb >> sps->log2_ctb_size);
+            int tile = pps->tile_id[pps->ctb_addr_rs_to_ts[rs]];
+            int slice_addr = s->tab_slice_address[rs];
+
+            if (slice_addr < 0 || s->deblock[rs].disable_dbf)
+                continue;
+
+            /* boundary_strength() compares against the lists of the current slice */
+            s->ref->refPicList = (RefPicList *)ff_hevc_get_ref_list(s, s->ref, x_ctb, y_ctb);
+
+            if (y_ctb > 0 &&
+                tile != pps->tile_id[pps->ctb_addr_rs_to_ts[rs - sps->ctb_width]] &&
+                s->tab_slice_address[rs - sps->ctb_width] >= 0 &&
+                (s->filter_slice_edges[rs] || s->tab_slice_address[rs - sps->ctb_width] == slice_addr))
+                upper_boundary_strengths(s, x_ctb, y_ctb, FFMIN(ctb_size, sps->width - x_ctb),
+                                         ff_hevc_get_ref_list(s, s->ref, x_ctb, y_ctb - 1));
+
+            if (x_ctb > 0 &&
+                tile != pps->tile_id[pps->ctb_addr_rs_to_ts[rs - 1]] &&
+                s->tab_slice_address[rs - 1] >= 0 &&
+                (s->filter_slice_edges[rs] || s->tab_slice_address[rs - 1] == slice_addr))
+                left_boundary_strengths(s, x_ctb, y_ctb, FFMIN(ctb_size, sps->height - y_ctb),
+                                        ff_hevc_get_ref_list(s, s->ref, x_ctb - 1, y_ctb));
+        }
+    }
+    s->ref->refPicList = rpl;
+
+    for (y_ctb = 0; y_ctb < sps->height; y_ctb += ctb_size)
+        for (x_ctb = 0; x_ctb < sps->width; x_ctb += ctb_size)
+            ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
+    ff_hevc_hls_filter(s, (sps->ctb_width  - 1) << sps->log2_ctb_size,
+                          (sps->ctb_height - 1) << sps->log2_ctb_size, ctb_size);
+}
@@ -935,13 +935,11 @@ static int hls_slice_header(HEVCContext *s)
                 unsigned val = get_bits_long(gb, offset_len);
                 sh->entry_point_offset[i] = val + 1; // +1; // +1 to get the size
             }
-            if (s->threads_number > 1 && (s->ps.pps->num_tile_rows > 1 || s->ps.pps->num_tile_columns > 1)) {
-                s->enable_parallel_tiles = 0; // TODO: you can enable tiles in parallel here
+            /* tiles are decoded in parallel on their own, not combined with WPP */
+            if (s->threads_number > 1 && s->ps.pps->entropy_coding_sync_enabled_flag &&
+                (s->ps.pps->num_tile_rows > 1 || s->ps.pps->num_tile_columns > 1))
                 s->threads_number = 1;
-            } else
-                s->enable_parallel_tiles = 0;
-        } else
-            s->enable_parallel_tiles = 0;
+        }
     }
 
     if (s->ps.pps->slice_header_extension_present_flag) {
@@ -2448,13 +2446,23 @@ static void hls_decode_neighbour(HEVCContext *s, int x_ctb, int y_ctb,
 
     lc->boundary_flags = 0;
     if (s->ps.pps->tiles_enabled_flag) {
-        if (x_ctb > 0 && s->ps.pps->tile_id[ctb_addr_ts] != s->ps.pps->tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs - 1]])
+        /* With parallel tiles, the neighbouring tiles may still be decoded by
+         * other jobs, and their edges are only filtered once the picture is
+         * complete, so the slice addresses are not compared across them. */
+        int left_tile  = 0;
+        int upper_tile = 0;
+
+        if (x_ctb > 0 && s->ps.pps->tile_id[ctb_addr_ts] != s->ps.pps->tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs - 1]]) {
             lc->boundary_flags |= BOUNDARY_LEFT_TILE;
-        if (x_ctb > 0 && s->tab_slice_address[ctb_addr_rs] != s->tab_slice_address[ctb_addr_rs - 1])
+            left_tile = s->enable_parallel_tiles;
+        }
+        if (x_ctb > 0 && !left_tile && s->tab_slice_address[ctb_addr_rs] != s->tab_slice_address[ctb_addr_rs - 1])
             lc->boundary_flags |= BOUNDARY_LEFT_SLICE;
-        if (y_ctb > 0 && s->ps.pps->tile_id[ctb_addr_ts] != s->ps.pps->tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs - s->ps.sps->ctb_width]])
+        if (y_ctb > 0 && s->ps.pps->tile_id[ctb_addr_ts] != s->ps.pps->tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs - s->ps.sps->ctb_width]]) {
             lc->boundary_flags |= BOUNDARY_UPPER_TILE;
-        if (y_ctb > 0 && s->tab_slice_address[ctb_addr_rs] != s->tab_slice_address[ctb_addr_rs - s->ps.sps->ctb_width])
+            upper_tile = s->enable_parallel_tiles;
+        }
+        if (y_ctb > 0 && !upper_tile && s->tab_slice_address[ctb_addr_rs] != s->tab_slice_address[ctb_addr_rs - s->ps.sps->ctb_width])
             lc->boundary_flags |= BOUNDARY_UPPER_SLICE;
     } else {
         if (ctb_addr_in_slice <= 0)
@@ -2509,6 +2517,8 @@ static int hls_decode_entry(AVCodecContext *avctxt, void *isFilterThread)
 
         s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
         s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        s->deblock[ctb_addr_rs].disable_dbf = s->sh.disable_deblocking_filter_flag;
+        s->deblock[ctb_addr_rs].slice_type  = s->sh.slice_type;
         s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
 
         more_data = hls_coding_quadtree(s, x_ctb, y_ctb, s->ps.sps->log2_ctb_size, 0);
@@ -2520,11 +2530,12 @@ static int hls_decode_entry(AVCodecContext *avctxt, void *isFilterThread)
 
         ctb_addr_ts++;
         ff_hevc_save_states(s, ctb_addr_ts);
-        ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
+        if (!s->enable_parallel_tiles)
+            ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
     }
 
     if (x_ctb + ctb_size >= s->ps.sps->width &&
-        y_ctb + ctb_size >= s->ps.sps->height)
+        y_ctb + ctb_size >= s->ps.sps->height && !s->enable_parallel_tiles)
         ff_hevc_hls_filter(s, x_ctb, y_ctb, ctb_size);
 
     return ctb_addr_ts;
@@ -2622,6 +2633,89 @@ error:
     return ret;
 }
 
+/**
+ * Decode the tile starting substream job of the current slice. The loop
+ * filters are left to ff_hevc_hls_filter_picture().
+ */
+static int hls_decode_entry_tile(AVCodecContext *avctxt, void *arg, int job, int self_id)
+{
+    HEVCContext *s1      = avctxt->priv_data;
+    HEVCContext *s       = s1->sList[self_id];
+    HEVCLocalContext *lc = s->HEVClc;
+    const HEVCSPS *sps   = s->ps.sps;
+    const HEVCPPS *pps   = s->ps.pps;
+    int more_data        = 1;
+    int tile             = pps->tile_id[pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs]] + job;
+    int ctb_addr_rs      = job ? pps->tile_pos_rs[tile] : s->sh.slice_ctb_addr_rs;
+    int ctb_addr_ts      = pps->ctb_addr_rs_to_ts[ctb_addr_rs];
+    int ret;
+
+    if (s->sh.dependent_slice_segment_flag) {
+        int slice_ctb_addr_ts = pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+        int prev_rs;
+
+        if (!slice_ctb_addr_ts) {
+            av_log(s->avctx, AV_LOG_ERROR, "Impossible initial tile.\n");
+            return AVERROR_INVALIDDATA;
+        }
+        prev_rs = pps->ctb_addr_ts_to_rs[slice_ctb_addr_ts - 1];
+        if (s->tab_slice_address[prev_rs] != s->sh.slice_addr) {
+            av_log(s->avctx, AV_LOG_ERROR, "Previous slice segment missing\n");
+            return AVERROR_INVALIDDATA;
+        }
+    }
+
+    if (job) {
+        ret = init_get_bits8(&lc->gb, s->data + s->sh.offset[job - 1], s->sh.size[job - 1]);
+    } else {
+        /* the first tile follows the slice header */
+        ret = init_get_bits8(&lc->gb, s->data, s->sh.offset[0]);
+        if (ret >= 0)
+            skip_bits_long(&lc->gb, s->sh.data_offset);
+    }
+    if (ret < 0)
+        goto error;
+    lc->first_qp_group = 1;
+    lc->qp_y           = s->sh.slice_qp;
+    lc->end_of_tiles_x = FFMIN((pps->col_bd[pps->col_idxX[ctb_addr_rs % sps->ctb_width] + 1])
+                               << sps->log2_ctb_size, sps->width);
+
+    while (more_data && ctb_addr_ts < sps->ctb_size && pps->tile_id[ctb_addr_ts] == tile) {
+        int x_ctb;
+        int y_ctb;
+
+        ctb_addr_rs = pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+        x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+        y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+        hls_decode_neighbour(s, x_ctb, y_ctb, ctb_addr_ts);
+
+        ret = ff_hevc_cabac_init(s, ctb_addr_ts, 0);
+        if (ret < 0)
+            goto error;
+
+        hls_sao_param(s, x_ctb >> sps->log2_ctb_size, y_ctb >> sps->log2_ctb_size);
+
+        s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+        s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        s->deblock[ctb_addr_rs].disable_dbf = s->sh.disable_deblocking_filter_flag;
+        s->deblock[ctb_addr_rs].slice_type  = s->sh.slice_type;
+        s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
+        more_data = hls_coding_quadtree(s, x_ctb, y_ctb, sps->log2_ctb_size, 0);
+        if (more_data < 0) {
+            ret = more_data;
+            goto error;
+        }
+
+        ctb_addr_ts++;
+    }
+
+    return ctb_addr_ts >= sps->ctb_size ? ctb_addr_ts : 0;
+error:
+    s->tab_slice_address[ctb_addr_rs] = -1;
+    return ret;
+}
+
 static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
 {
     const uint8_t *data = nal->data;
@@ -2639,7 +2733,8 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         return AVERROR(ENOMEM);
     }
 
-    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * s->ps.sps->ctb_width >= s->ps.sps->ctb_width * s->ps.sps->ctb_height) {
+    if (s->ps.pps->entropy_coding_sync_enabled_flag &&
+        s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * s->ps.sps->ctb_width >= s->ps.sps->ctb_width * s->ps.sps->ctb_height) {
         av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
             s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
             s->ps.sps->ctb_width, s->ps.sps->ctb_height
@@ -2647,6 +2742,14 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         res = AVERROR_INVALIDDATA;
         goto error;
     }
+    if (!s->ps.pps->entropy_coding_sync_enabled_flag &&
+        s->ps.pps->tile_id[s->ps.pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs]] + s->sh.num_entry_point_offsets >=
+        s->ps.pps->num_tile_columns * s->ps.pps->num_tile_rows) {
+        av_log(s->avctx, AV_LOG_ERROR, "Tile entry points are wrong (%d %d)\n",
+               s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets);
+        res = AVERROR_INVALIDDATA;
+        goto error;
+    }
 
     ff_alloc_entries(s->avctx, s->sh.num_entry_point_offsets + 1);
 
@@ -2666,6 +2769,7 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     }
 
     offset = (lc->gb.index >> 3);
+    s->sh.data_offset = lc->gb.index;
 
     for (j = 0, cmpt = 0, startheader = offset + s->sh.entry_point_offset[0]; j < nal->skipped_bytes; j++) {
         if (nal->skipped_bytes_pos[j] >= offset && nal->skipped_bytes_pos[j] < startheader) {
@@ -2717,6 +2821,8 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
 
     if (s->ps.pps->entropy_coding_sync_enabled_flag)
         s->avctx->execute2(s->avctx, hls_decode_entry_wpp, arg, ret, s->sh.num_entry_point_offsets + 1);
+    else
+        s->avctx->execute2(s->avctx, hls_decode_entry_tile, arg, ret, s->sh.num_entry_point_offsets + 1);
 
     for (i = 0; i <= s->sh.num_entry_point_offsets; i++)
         res += ret[i];
@@ -3022,6 +3128,12 @@ static int hevc_frame_start(HEVCContext *s)
     if (s->ps.pps->tiles_enabled_flag)
         lc->end_of_tiles_x = s->ps.pps->column_width[0] << s->ps.sps->log2_ctb_size;
 
+    s->enable_parallel_tiles = s->threads_number > 1 && !s->avctx->hwaccel &&
+                               s->ps.pps->tiles_enabled_flag &&
+                               !s->ps.pps->entropy_coding_sync_enabled_flag &&
+                               (s->ps.pps->num_tile_rows > 1 || s->ps.pps->num_tile_columns > 1);
+    s->filter_pending        = s->enable_parallel_tiles;
+
     ret = ff_hevc_set_new_ref(s, &s->frame, s->poc);
     if (ret < 0)
         goto fail;
@@ -3072,6 +3184,18 @@ fail:
     return ret;
 }
 
+/**
+ * Apply the loop filters deferred by parallel tile decoding to the current
+ * picture, also when some of its slices were lost.
+ */
+static void hevc_filter_picture(HEVCContext *s)
+{
+    if (s->filter_pending && s->ref) {
+        ff_hevc_hls_filter_picture(s);
+        s->filter_pending = 0;
+    }
+}
+
 static int hevc_frame_end(HEVCContext *s)
 {
     HEVCFrame *out = s->ref;
@@ -3192,6 +3316,9 @@ static int decode_nal_unit(HEVCContext *s, const H2645NAL *nal)
         }
 
         if (s->sh.first_slice_in_pic_flag) {
+            /* the previous picture may have lost its last slices */
+            hevc_filter_picture(s);
+
             if (s->max_ra == INT_MAX) {
                 if (s->nal_unit_type == HEVC_NAL_CRA_NUT || IS_BLA(s)) {
                     s->max_ra = s->poc;
@@ -3252,6 +3379,7 @@ static int decode_nal_unit(HEVCContext *s, const H2645NAL *nal)
             else
                 ctb_addr_ts = hls_slice_data(s);
             if (ctb_addr_ts >= (s->ps.sps->ctb_width * s->ps.sps->ctb_height)) {
+                hevc_filter_picture(s);
                 ret = hevc_frame_end(s);
                 if (ret < 0)
                     goto fail;
@@ -3368,6 +3496,7 @@ static int decode_nal_units(HEVCContext *s, const uint8_t *buf, int length)
     }
 
 fail:
+    hevc_filter_picture(s);
     if (s->ref && s->threads_type == FF_THREAD_FRAME)
         ff_thread_report_progress(&s->ref->tf, INT_MAX, 0);
 
@@ -3821,6 +3950,7 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
         return ret;
 
     s->enable_parallel_tiles = 0;
+    s->filter_pending        = 0;
     s->sei.picture_timing.picture_struct = 0;
     s->eos = 1;
 
@@ -3882,7 +4012,8 @@ const FFCodec ff_hevc_decoder = {
     .p.capabilities        = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
                              AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal         = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_EXPORTS_CROPPING |
-                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP,
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP |
+                             FF_CODEC_CAP_SLICE_THREAD_SYNC,
     .p.profiles            = NULL_IF_CONFIG_SMALL(ff_hevc_profiles),
     .hw_configs            = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_HEVC_DXVA2_HWACCEL
@@ -301,6 +301,7 @@ typedef struct SliceHeader {
     int * offset;
     int * size;
     int num_entry_point_offsets;
+    int data_offset;    ///< bit position of the first substream in the NAL
 
     int8_t slice_qp;
 
@@ -383,6 +384,8 @@ typedef struct TransformUnit {
 typedef struct DBParams {
     int beta_offset;
     int tc_offset;
+    int disable_dbf;
+    int slice_type;
 } DBParams;
 
 #define HEVC_FRAME_FLAG_OUTPUT    (1 << 0)
@@ -554,7 +557,13 @@ typedef struct HEVCContext {
     uint16_t seq_decode;
     uint16_t seq_output;
 
+    /**
+     * Tiles of a slice are decoded concurrently and the loop filters are
+     * applied by ff_hevc_hls_filter_picture() once the picture is decoded.
+     */
     int enable_parallel_tiles;
+    /* the deferred loop filters of the current picture are not applied yet */
+    int filter_pending;
     atomic_int wpp_err;
 
     const uint8_t *data;
@@ -683,6 +692,7 @@ int ff_hevc_cu_chroma_qp_offset_flag(HEVCContext *s);
 int ff_hevc_cu_chroma_qp_offset_idx(HEVCContext *s);
 void ff_hevc_hls_filter(HEVCContext *s, int x, int y, int ctb_size);
 void ff_hevc_hls_filters(HEVCContext *s, int x_ctb, int y_ctb, int ctb_size);
+void ff_hevc_hls_filter_picture(HEVCContext *s);
 void ff_hevc_hls_residual_coding(HEVCContext *s, int x0, int y0,
                                  int log2_trafo_size, enum ScanType scan_idx,
                                  int c_idx);
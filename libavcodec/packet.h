@@ -299,6 +299,13 @@ enum AVPacketSideDataType {
      */
     AV_PKT_DATA_DYNAMIC_HDR10_PLUS,
 
+    /**
+     * Sensor telemetry (gyroscope, accelerometer, GPS) sampled at the
+     * presentation time of the packet, in the form of the AVTelemetry
+     * struct defined in libavutil/telemetry.h.
+     */
+    AV_PKT_DATA_TELEMETRY,
+
     /**
      * The number of side data types.
      * This is not part of the public API/ABI in the sense that it may
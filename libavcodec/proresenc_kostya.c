@@ -34,6 +34,7 @@
 #include "profiles.h"
 #include "bytestream.h"
 #include "proresdata.h"
+#include "proresencdsp.h"
 
 #define CFACTOR_Y422 2
 #define CFACTOR_Y444 3
@@ -223,19 +224,28 @@ struct TrellisNode {
 typedef struct ProresThreadData {
     DECLARE_ALIGNED(16, int16_t, blocks)[MAX_PLANES][64 * 4 * MAX_MBS_PER_SLICE];
     DECLARE_ALIGNED(16, uint16_t, emu_buf)[16 * 16];
+    DECLARE_ALIGNED(32, int16_t, levels)[64 * 4 * MAX_MBS_PER_SLICE];
     int16_t custom_q[64];
     int16_t custom_chroma_q[64];
     struct TrellisNode *nodes;
 } ProresThreadData;
 
+/**
+ * Slices of one macroblock row, encoded into a scratch buffer before being
+ * copied into the packet.
+ */
+typedef struct ProresRowData {
+    uint8_t *buf;
+    unsigned buf_size;
+    int size;
+    int max_slice_size;
+    int error;
+} ProresRowData;
+
 typedef struct ProresContext {
     AVClass *class;
-    DECLARE_ALIGNED(16, int16_t, blocks)[MAX_PLANES][64 * 4 * MAX_MBS_PER_SLICE];
-    DECLARE_ALIGNED(16, uint16_t, emu_buf)[16*16];
     int16_t quants[MAX_STORED_Q][64];
     int16_t quants_chroma[MAX_STORED_Q][64];
-    int16_t custom_q[64];
-    int16_t custom_chroma_q[64];
     const uint8_t *quant_mat;
     const uint8_t *quant_chroma_mat;
     const uint8_t *scantable;
@@ -243,6 +253,7 @@ typedef struct ProresContext {
     void (*fdct)(FDCTDSPContext *fdsp, const uint16_t *src,
                  ptrdiff_t linesize, int16_t *block);
     FDCTDSPContext fdsp;
+    ProresEncDSPContext dsp;
 
     const AVFrame *pic;
     int mb_width, mb_height;
@@ -262,13 +273,16 @@ typedef struct ProresContext {
     int quant_sel;
 
     int frame_size_upper_bound;
+    int max_slice_size;
 
     int profile;
     const struct prores_profile *profile_info;
 
     int *slice_q;
+    int *slice_size;
 
     ProresThreadData *tdata;
+    ProresRowData *rows;
 } ProresContext;
 
 static void get_slice_data(ProresContext *ctx, const uint16_t *src,
@@ -431,10 +445,10 @@ static void encode_dcs(PutBitContext *pb, int16_t *blocks,
     }
 }
 
-static void encode_acs(PutBitContext *pb, int16_t *blocks,
+static void encode_acs(PutBitContext *pb, const int16_t *levels,
                        int blocks_per_slice,
                        int plane_size_factor,
-                       const uint8_t *scan, const int16_t *qmat)
+                       const uint8_t *scan)
 {
     int idx, i;
     int run, level, run_cb, lev_cb;
@@ -447,7 +461,7 @@ static void encode_acs(PutBitContext *pb, int16_t *blocks,
 
     for (i = 1; i < 64; i++) {
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level = blocks[idx] / qmat[scan[i]];
+            level = levels[idx];
             if (level) {
                 abs_level = FFABS(level);
                 encode_vlc_codeword(pb, ff_prores_ac_codebook[run_cb], run);
@@ -469,13 +483,14 @@ static void encode_slice_plane(ProresContext *ctx, PutBitContext *pb,
                               const uint16_t *src, ptrdiff_t linesize,
                               int mbs_per_slice, int16_t *blocks,
                               int blocks_per_mb, int plane_size_factor,
-                              const int16_t *qmat)
+                              const int16_t *qmat, int16_t *levels)
 {
     int blocks_per_slice = mbs_per_slice * blocks_per_mb;
 
     encode_dcs(pb, blocks, blocks_per_slice, qmat[0]);
-    encode_acs(pb, blocks, blocks_per_slice, plane_size_factor,
-               ctx->scantable, qmat);
+    ctx->dsp.quantize(levels, blocks, qmat, blocks_per_slice);
+    encode_acs(pb, levels, blocks_per_slice, plane_size_factor,
+               ctx->scantable);
 }
 
 static void put_alpha_diff(PutBitContext *pb, int cur, int prev, int abits)
@@ -543,7 +558,7 @@ static void encode_alpha_plane(ProresContext *ctx, PutBitContext *pb,
 static int encode_slice(AVCodecContext *avctx, const AVFrame *pic,
                         PutBitContext *pb,
                         int sizes[4], int x, int y, int quant,
-                        int mbs_per_slice)
+                        int mbs_per_slice, ProresThreadData *td)
 {
     ProresContext *ctx = avctx->priv_data;
     int i, xp, yp;
@@ -568,8 +583,8 @@ static int encode_slice(AVCodecContext *avctx, const AVFrame *pic,
         qmat = ctx->quants[quant];
         qmat_chroma = ctx->quants_chroma[quant];
     } else {
-        qmat = ctx->custom_q;
-        qmat_chroma = ctx->custom_chroma_q;
+        qmat = td->custom_q;
+        qmat_chroma = td->custom_chroma_q;
         for (i = 0; i < 64; i++) {
             qmat[i] = ctx->quant_mat[i] * quant;
             qmat_chroma[i] = ctx->quant_chroma_mat[i] * quant;
@@ -600,22 +615,24 @@ static int encode_slice(AVCodecContext *avctx, const AVFrame *pic,
         if (i < 3) {
             get_slice_data(ctx, src, linesize, xp, yp,
                            pwidth, avctx->height / ctx->pictures_per_frame,
-                           ctx->blocks[0], ctx->emu_buf,
+                           td->blocks[0], td->emu_buf,
                            mbs_per_slice, num_cblocks, is_chroma);
             if (!is_chroma) {/* luma quant */
                 encode_slice_plane(ctx, pb, src, linesize,
-                                   mbs_per_slice, ctx->blocks[0],
-                                   num_cblocks, plane_factor, qmat);
+                                   mbs_per_slice, td->blocks[0],
+                                   num_cblocks, plane_factor, qmat,
+                                   td->levels);
             } else { /* chroma plane */
                 encode_slice_plane(ctx, pb, src, linesize,
-                                   mbs_per_slice, ctx->blocks[0],
-                                   num_cblocks, plane_factor, qmat_chroma);
+                                   mbs_per_slice, td->blocks[0],
+                                   num_cblocks, plane_factor, qmat_chroma,
+                                   td->levels);
             }
         } else {
             get_alpha_data(ctx, src, linesize, xp, yp,
                            pwidth, avctx->height / ctx->pictures_per_frame,
-                           ctx->blocks[0], mbs_per_slice, ctx->alpha_bits);
-            encode_alpha_plane(ctx, pb, mbs_per_slice, ctx->blocks[0], quant);
+                           td->blocks[0], mbs_per_slice, ctx->alpha_bits);
+            encode_alpha_plane(ctx, pb, mbs_per_slice, td->blocks[0], quant);
         }
         flush_put_bits(pb);
         sizes[i]   = put_bytes_output(pb) - total_size;
@@ -677,9 +694,8 @@ static int estimate_dcs(int *error, int16_t *blocks, int blocks_per_slice,
     return bits;
 }
 
-static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
-                        int plane_size_factor,
-                        const uint8_t *scan, const int16_t *qmat)
+static int estimate_acs(const int16_t *levels, int blocks_per_slice,
+                        int plane_size_factor, const uint8_t *scan)
 {
     int idx, i;
     int run, level, run_cb, lev_cb;
@@ -693,8 +709,7 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
 
     for (i = 1; i < 64; i++) {
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level   = blocks[idx] / qmat[scan[i]];
-            *error += FFABS(blocks[idx]) % qmat[scan[i]];
+            level = levels[idx];
             if (level) {
                 abs_level = FFABS(level);
                 bits += estimate_vlc(ff_prores_ac_codebook[run_cb], run);
@@ -719,14 +734,20 @@ static int estimate_slice_plane(ProresContext *ctx, int *error, int plane,
                                 int blocks_per_mb, int plane_size_factor,
                                 const int16_t *qmat, ProresThreadData *td)
 {
+    int16_t *blocks = td->blocks[plane];
     int blocks_per_slice;
-    int bits;
+    int bits, i;
 
     blocks_per_slice = mbs_per_slice * blocks_per_mb;
 
-    bits  = estimate_dcs(error, td->blocks[plane], blocks_per_slice, qmat[0]);
-    bits += estimate_acs(error, td->blocks[plane], blocks_per_slice,
-                         plane_size_factor, ctx->scantable, qmat);
+    bits  = estimate_dcs(error, blocks, blocks_per_slice, qmat[0]);
+    /* the DC coefficients are quantized too, but their error is not
+     * accounted here */
+    *error += ctx->dsp.quantize(td->levels, blocks, qmat, blocks_per_slice);
+    for (i = 0; i < blocks_per_slice; i++)
+        *error -= FFABS(blocks[i * 64]) % qmat[0];
+    bits += estimate_acs(td->levels, blocks_per_slice,
+                         plane_size_factor, ctx->scantable);
 
     return FFALIGN(bits, 8);
 }
@@ -981,17 +1002,72 @@ static int find_quant_thread(AVCodecContext *avctx, void *arg,
     return 0;
 }
 
+static int encode_row_thread(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    ProresContext *ctx = avctx->priv_data;
+    ProresThreadData *td = ctx->tdata + threadnr;
+    ProresRowData *row = ctx->rows + jobnr;
+    const AVFrame *pic = arg;
+    PutBitContext pb;
+    uint8_t *buf, *slice_hdr;
+    int mbs_per_slice = ctx->mbs_per_slice;
+    int slice_hdr_size = 2 + 2 * (ctx->num_planes - 1);
+    int sizes[4] = { 0 };
+    int x, y = jobnr, i, mb, q, slice_size;
+
+    row->size           = 0;
+    row->max_slice_size = ctx->max_slice_size;
+    row->error          = 0;
+
+    for (x = mb = 0; x < ctx->mb_width; x += mbs_per_slice, mb++) {
+        unsigned min_size = row->size + slice_hdr_size + 2 * row->max_slice_size;
+
+        q = ctx->force_quant ? ctx->force_quant
+                             : ctx->slice_q[mb + y * ctx->slices_width];
+
+        while (ctx->mb_width - x < mbs_per_slice)
+            mbs_per_slice >>= 1;
+
+        if (row->buf_size < min_size) {
+            uint8_t *tmp = av_fast_realloc(row->buf, &row->buf_size, min_size);
+            if (!tmp) {
+                row->error = AVERROR(ENOMEM);
+                return row->error;
+            }
+            row->buf = tmp;
+        }
+
+        buf = row->buf + row->size;
+        bytestream_put_byte(&buf, slice_hdr_size << 3);
+        slice_hdr = buf;
+        buf += slice_hdr_size - 1;
+        init_put_bits(&pb, buf, row->buf_size - (buf - row->buf));
+        encode_slice(avctx, pic, &pb, sizes, x, y, q, mbs_per_slice, td);
+
+        bytestream_put_byte(&slice_hdr, q);
+        slice_size = slice_hdr_size + sizes[ctx->num_planes - 1];
+        for (i = 0; i < ctx->num_planes - 1; i++) {
+            bytestream_put_be16(&slice_hdr, sizes[i]);
+            slice_size += sizes[i];
+        }
+        ctx->slice_size[mb + y * ctx->slices_width] = slice_size;
+        row->size += slice_size;
+        if (row->max_slice_size < slice_size)
+            row->max_slice_size = slice_size;
+    }
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pic, int *got_packet)
 {
     ProresContext *ctx = avctx->priv_data;
-    uint8_t *orig_buf, *buf, *slice_hdr, *slice_sizes, *tmp;
+    uint8_t *orig_buf, *buf, *slice_sizes, *tmp;
     uint8_t *picture_size_pos;
-    PutBitContext pb;
-    int x, y, i, mb, q = 0;
-    int sizes[4] = { 0 };
-    int slice_hdr_size = 2 + 2 * (ctx->num_planes - 1);
-    int frame_size, picture_size, slice_size;
+    int y, i;
+    int frame_size, picture_size, data_size;
     int pkt_size, ret;
     int max_slice_size = (ctx->frame_size_upper_bound - 200) / (ctx->pictures_per_frame * ctx->slices_per_picture + 1);
     uint8_t frame_flags;
@@ -1063,69 +1139,59 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                 return ret;
         }
 
+        // Slices are encoded one macroblock row per job into scratch buffers,
+        // then copied into the packet in order.
+        ctx->max_slice_size = max_slice_size;
+        avctx->execute2(avctx, encode_row_thread, (void*)pic, NULL,
+                        ctx->mb_height);
+
+        data_size = 0;
         for (y = 0; y < ctx->mb_height; y++) {
-            int mbs_per_slice = ctx->mbs_per_slice;
-            for (x = mb = 0; x < ctx->mb_width; x += mbs_per_slice, mb++) {
-                q = ctx->force_quant ? ctx->force_quant
-                                     : ctx->slice_q[mb + y * ctx->slices_width];
-
-                while (ctx->mb_width - x < mbs_per_slice)
-                    mbs_per_slice >>= 1;
-
-                bytestream_put_byte(&buf, slice_hdr_size << 3);
-                slice_hdr = buf;
-                buf += slice_hdr_size - 1;
-                if (pkt_size <= buf - orig_buf + 2 * max_slice_size) {
-                    uint8_t *start = pkt->data;
-                    // Recompute new size according to max_slice_size
-                    // and deduce delta
-                    int delta = 200 + (ctx->pictures_per_frame *
-                                ctx->slices_per_picture + 1) *
-                                max_slice_size - pkt_size;
-
-                    delta = FFMAX(delta, 2 * max_slice_size);
-                    ctx->frame_size_upper_bound += delta;
-
-                    if (!ctx->warn) {
-                        avpriv_request_sample(avctx,
-                                              "Packet too small: is %i,"
-                                              " needs %i (slice: %i). "
-                                              "Correct allocation",
-                                              pkt_size, delta, max_slice_size);
-                        ctx->warn = 1;
-                    }
-
-                    ret = av_grow_packet(pkt, delta);
-                    if (ret < 0)
-                        return ret;
-
-                    pkt_size += delta;
-                    // restore pointers
-                    orig_buf         = pkt->data + (orig_buf         - start);
-                    buf              = pkt->data + (buf              - start);
-                    picture_size_pos = pkt->data + (picture_size_pos - start);
-                    slice_sizes      = pkt->data + (slice_sizes      - start);
-                    slice_hdr        = pkt->data + (slice_hdr        - start);
-                    tmp              = pkt->data + (tmp              - start);
-                }
-                init_put_bits(&pb, buf, (pkt_size - (buf - orig_buf)));
-                ret = encode_slice(avctx, pic, &pb, sizes, x, y, q,
-                                   mbs_per_slice);
-                if (ret < 0)
-                    return ret;
-
-                bytestream_put_byte(&slice_hdr, q);
-                slice_size = slice_hdr_size + sizes[ctx->num_planes - 1];
-                for (i = 0; i < ctx->num_planes - 1; i++) {
-                    bytestream_put_be16(&slice_hdr, sizes[i]);
-                    slice_size += sizes[i];
-                }
-                bytestream_put_be16(&slice_sizes, slice_size);
-                buf += slice_size - slice_hdr_size;
-                if (max_slice_size < slice_size)
-                    max_slice_size = slice_size;
+            if (ctx->rows[y].error)
+                return ctx->rows[y].error;
+            data_size += ctx->rows[y].size;
+            if (max_slice_size < ctx->rows[y].max_slice_size)
+                max_slice_size = ctx->rows[y].max_slice_size;
+        }
+
+        if (pkt_size < buf - orig_buf + data_size) {
+            uint8_t *start = pkt->data;
+            // Recompute new size according to max_slice_size
+            // and deduce delta
+            int delta = 200 + (ctx->pictures_per_frame *
+                        ctx->slices_per_picture + 1) *
+                        max_slice_size - pkt_size;
+
+            delta = FFMAX(delta, buf - orig_buf + data_size - pkt_size);
+            ctx->frame_size_upper_bound += delta;
+
+            if (!ctx->warn) {
+                avpriv_request_sample(avctx,
+                                      "Packet too small: is %i,"
+                                      " needs %i (slice: %i). "
+                                      "Correct allocation",
+                                      pkt_size, delta, max_slice_size);
+                ctx->warn = 1;
             }
+
+            ret = av_grow_packet(pkt, delta);
+            if (ret < 0)
+                return ret;
+
+            pkt_size += delta;
+            // restore pointers
+            orig_buf         = pkt->data + (orig_buf         - start);
+            buf              = pkt->data + (buf              - start);
+            picture_size_pos = pkt->data + (picture_size_pos - start);
+            slice_sizes      = pkt->data + (slice_sizes      - start);
+        }
+
+        for (y = 0; y < ctx->mb_height; y++) {
+            memcpy(buf, ctx->rows[y].buf, ctx->rows[y].size);
+            buf += ctx->rows[y].size;
         }
+        for (i = 0; i < ctx->slices_per_picture; i++)
+            bytestream_put_be16(&slice_sizes, ctx->slice_size[i]);
 
         picture_size = buf - (picture_size_pos - 1);
         bytestream_put_be32(&picture_size_pos, picture_size);
@@ -1151,7 +1217,13 @@ static av_cold int encode_close(AVCodecContext *avctx)
             av_freep(&ctx->tdata[i].nodes);
     }
     av_freep(&ctx->tdata);
+    if (ctx->rows) {
+        for (i = 0; i < ctx->mb_height; i++)
+            av_freep(&ctx->rows[i].buf);
+    }
+    av_freep(&ctx->rows);
     av_freep(&ctx->slice_q);
+    av_freep(&ctx->slice_size);
 
     return 0;
 }
@@ -1184,6 +1256,7 @@ static av_cold int encode_init(AVCodecContext *avctx)
     ctx->scantable = interlaced ? ff_prores_interlaced_scan
                                 : ff_prores_progressive_scan;
     ff_fdctdsp_init(&ctx->fdsp, avctx);
+    ff_proresencdsp_init(&ctx->dsp);
 
     mps = ctx->mbs_per_slice;
     if (mps & (mps - 1)) {
@@ -1249,6 +1322,12 @@ static av_cold int encode_init(AVCodecContext *avctx)
         return AVERROR_INVALIDDATA;
     }
 
+    ctx->slice_size = av_malloc_array(ctx->slices_per_picture, sizeof(*ctx->slice_size));
+    ctx->rows       = av_calloc(ctx->mb_height, sizeof(*ctx->rows));
+    ctx->tdata      = av_calloc(avctx->thread_count, sizeof(*ctx->tdata));
+    if (!ctx->slice_size || !ctx->rows || !ctx->tdata)
+        return AVERROR(ENOMEM);
+
     ctx->force_quant = avctx->global_quality / FF_QP2LAMBDA;
     if (!ctx->force_quant) {
         if (!ctx->bits_per_mb) {
@@ -1277,10 +1356,6 @@ static av_cold int encode_init(AVCodecContext *avctx)
         if (!ctx->slice_q)
             return AVERROR(ENOMEM);
 
-        ctx->tdata = av_calloc(avctx->thread_count, sizeof(*ctx->tdata));
-        if (!ctx->tdata)
-            return AVERROR(ENOMEM);
-
         for (j = 0; j < avctx->thread_count; j++) {
             ctx->tdata[j].nodes = av_malloc_array(ctx->slices_width + 1,
                                                   TRELLIS_WIDTH
@@ -0,0 +1,39 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_PRORESENCDSP_H
+#define AVCODEC_PRORESENCDSP_H
+
+#include <stdint.h>
+
+typedef struct ProresEncDSPContext {
+    /**
+     * Quantize nb_blocks consecutive 8x8 blocks of DCT coefficients.
+     *
+     * @param levels output, blocks[i] / qmat[i % 64] truncated towards zero
+     * @param blocks coefficients, in natural order
+     * @param qmat   quantization matrix, all entries must be positive
+     * @return sum of FFABS(blocks[i]) % qmat[i % 64] over all coefficients
+     */
+    int (*quantize)(int16_t *levels, const int16_t *blocks,
+                    const int16_t *qmat, int nb_blocks);
+} ProresEncDSPContext;
+
+void ff_proresencdsp_init(ProresEncDSPContext *c);
+
+#endif /* AVCODEC_PRORESENCDSP_H */
@@ -147,6 +147,21 @@ typedef struct FrameThreadContext {
                                     * Set for the first N packets, where N is the number of threads.
                                     * While it is set, ff_thread_en/decode_frame won't return any results.
                                     */
+    int nb_pending;                ///< Number of submitted packets whose output has not been returned yet.
+
+    int intra_only;                ///< Set for intra-only codecs, whose frames do not depend on each other.
+    /**
+     * Set for intra-only codecs and with AV_CODEC_FLAG2_THREAD_LOW_DELAY.
+     * Frames are returned as soon as the oldest one is decoded instead of
+     * after the first thread_count packets, and delaying is not used.
+     */
+    int output_on_ready;
+    /**
+     * Copy of the user context at init, if the threads beyond the first one
+     * are only started when they get their first packet. Only used for
+     * intra-only codecs with a thread-safe init.
+     */
+    AVCodecContext *init_avctx;
 
     /* hwaccel state is temporarily stored here in order to transfer its ownership
      * to the next decoding thread without the need for extra synchronization */
@@ -418,17 +433,32 @@ static void release_delayed_buffers(PerThreadContext *p)
 }
 #endif
 
+static int init_thread(PerThreadContext *p, int *threads_to_free,
+                       FrameThreadContext *fctx, AVCodecContext *avctx,
+                       const FFCodec *codec, int first);
+
 static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
                          AVPacket *avpkt)
 {
-    FrameThreadContext *fctx = p->parent;
+    FrameThreadContext *fctx = user_avctx->internal->thread_ctx;
     PerThreadContext *prev_thread = fctx->prev_thread;
-    const AVCodec *codec = p->avctx->codec;
+    const AVCodec *codec = user_avctx->codec;
     int ret;
 
     if (!avpkt->size && !(codec->capabilities & AV_CODEC_CAP_DELAY))
         return 0;
 
+    if (p->thread_init != INITIALIZED) {
+        int unused = 0;
+
+        /* a thread which failed to start is not tried again */
+        if (p->avctx)
+            return AVERROR(EINVAL);
+        ret = init_thread(p, &unused, fctx, fctx->init_avctx, ffcodec(codec), 0);
+        if (ret < 0)
+            return ret;
+    }
+
     pthread_mutex_lock(&p->mutex);
 
     ret = update_context_from_user(p->avctx, user_avctx);
@@ -518,6 +548,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     fctx->prev_thread = p;
     fctx->next_decoding++;
+    fctx->nb_pending++;
 
     return 0;
 }
@@ -546,9 +577,22 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
 
     /*
      * If we're still receiving the initial packets, don't return a frame.
+     * In output-on-ready mode, only wait while the oldest frame is being
+     * decoded and there is an idle thread to give the next packet to.
+     * Frames are still returned in decoding order.
      */
 
-    if (fctx->next_decoding > (avctx->thread_count-1-(avctx->codec_id == AV_CODEC_ID_FFV1)))
+    if (fctx->output_on_ready) {
+        p = &fctx->threads[finished];
+        if (avpkt->size && fctx->nb_pending < avctx->thread_count &&
+            atomic_load(&p->state) != STATE_INPUT_READY) {
+            *got_picture_ptr = 0;
+            if (fctx->next_decoding >= avctx->thread_count)
+                fctx->next_decoding = 0;
+            err = avpkt->size;
+            goto finish;
+        }
+    } else if (fctx->next_decoding > (avctx->thread_count-1-(avctx->codec_id == AV_CODEC_ID_FFV1)))
         fctx->delaying = 0;
 
     if (fctx->delaying) {
@@ -559,6 +603,13 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
         }
     }
 
+    /* nothing left to drain */
+    if (!fctx->nb_pending) {
+        *got_picture_ptr = 0;
+        err = 0;
+        goto finish;
+    }
+
     /*
      * Return the next available frame from the oldest thread.
      * If we're at the end of the stream, then we have to skip threads that
@@ -582,16 +633,16 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
         err = p->result;
 
         /*
-         * A later call with avkpt->size == 0 may loop over all threads,
-         * including this one, searching for a frame/error to return before being
-         * stopped by the "finished != fctx->next_finished" condition.
+         * A later call with avkpt->size == 0 loops over the threads with
+         * pending packets, searching for a frame/error to return.
          * Make sure we don't mistakenly return the same frame/error again.
          */
         p->got_frame = 0;
         p->result = 0;
+        fctx->nb_pending--;
 
         if (finished >= avctx->thread_count) finished = 0;
-    } while (!avpkt->size && !*got_picture_ptr && err >= 0 && finished != fctx->next_finished);
+    } while (!avpkt->size && !*got_picture_ptr && err >= 0 && fctx->nb_pending);
 
     update_context_from_thread(avctx, p->avctx, 1);
 
@@ -734,7 +785,7 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
         PerThreadContext *p = &fctx->threads[i];
         AVCodecContext *ctx = p->avctx;
 
-        if (ctx->internal) {
+        if (ctx && ctx->internal) {
             if (p->thread_init == INITIALIZED) {
                 pthread_mutex_lock(&p->mutex);
                 p->die = 1;
@@ -774,6 +825,7 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
     }
 
     av_freep(&fctx->threads);
+    av_freep(&fctx->init_avctx);
     ff_pthread_free(fctx, thread_ctx_offsets);
 
     /* if we have stashed hwaccel state, move it to the user-facing context,
@@ -895,8 +947,13 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     }
 
     fctx->async_lock = 1;
-    fctx->delaying = 1;
+    fctx->intra_only = codec->p.type == AVMEDIA_TYPE_VIDEO && avctx->codec_descriptor &&
+                       (avctx->codec_descriptor->props & AV_CODEC_PROP_INTRA_ONLY);
+    fctx->output_on_ready = fctx->intra_only ||
+                            (avctx->flags2 & AV_CODEC_FLAG2_THREAD_LOW_DELAY);
+    fctx->delaying = !fctx->output_on_ready;
 
+    /* this is an upper bound in output-on-ready mode */
     if (codec->p.type == AVMEDIA_TYPE_VIDEO)
         avctx->delay = avctx->thread_count - 1;
 
@@ -906,6 +963,15 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         goto error;
     }
 
+    /* Packets are still handed to the threads round-robin, so all of them
+     * end up being used once enough packets come in. For intra-only codecs
+     * a thread is only started when it gets its first packet, so a short
+     * decode does not initialize thread_count codec instances. This
+     * requires that the codec can be initialized outside of the global
+     * codec lock. */
+    if (fctx->intra_only && (codec->caps_internal & FF_CODEC_CAP_INIT_THREADSAFE))
+        thread_count = 1;
+
     for (; i < thread_count; ) {
         PerThreadContext *p  = &fctx->threads[i];
         int first = !i;
@@ -915,6 +981,14 @@ int ff_frame_thread_init(AVCodecContext *avctx)
             goto error;
     }
 
+    if (thread_count < avctx->thread_count) {
+        fctx->init_avctx = av_memdup(avctx, sizeof(*avctx));
+        if (!fctx->init_avctx) {
+            err = AVERROR(ENOMEM);
+            goto error;
+        }
+    }
+
     return 0;
 
 error:
@@ -936,10 +1010,14 @@ void ff_thread_flush(AVCodecContext *avctx)
     }
 
     fctx->next_decoding = fctx->next_finished = 0;
-    fctx->delaying = 1;
+    fctx->nb_pending = 0;
+    fctx->delaying = !fctx->output_on_ready;
     fctx->prev_thread = NULL;
     for (i = 0; i < avctx->thread_count; i++) {
         PerThreadContext *p = &fctx->threads[i];
+
+        if (p->thread_init != INITIALIZED)
+            continue;
         // Make sure decode flush calls with size=0 won't return old frames
         p->got_frame = 0;
         av_frame_unref(p->frame);
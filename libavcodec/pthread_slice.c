@@ -136,6 +136,8 @@ int ff_slice_thread_init(AVCodecContext *avctx)
     SliceThreadContext *c;
     int thread_count = avctx->thread_count;
     void (*mainfunc)(void *);
+    AVBufferRef *pool;
+    unsigned caps_internal;
 
     // We cannot do this in the encoder init as the threads are created before
     if (av_codec_is_encoder(avctx->codec) &&
@@ -160,8 +162,11 @@ int ff_slice_thread_init(AVCodecContext *avctx)
     }
 
     avctx->internal->thread_ctx = c = av_mallocz(sizeof(*c));
-    mainfunc = ffcodec(avctx->codec)->caps_internal & FF_CODEC_CAP_SLICE_THREAD_HAS_MF ? &main_function : NULL;
-    if (!c || (thread_count = avpriv_slicethread_create(&c->thread, avctx, worker_func, mainfunc, thread_count)) <= 1) {
+    caps_internal = ffcodec(avctx->codec)->caps_internal;
+    mainfunc = caps_internal & FF_CODEC_CAP_SLICE_THREAD_HAS_MF ? &main_function : NULL;
+    pool     = caps_internal & FF_CODEC_CAP_SLICE_THREAD_SYNC ? NULL : avctx->thread_pool;
+    if (!c || (thread_count = avpriv_slicethread_create_pool(&c->thread, avctx, worker_func, mainfunc,
+                                                             thread_count, pool)) <= 1) {
         if (c)
             avpriv_slicethread_free(&c->thread);
         av_freep(&avctx->internal->thread_ctx);
@@ -0,0 +1,140 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/error.h"
+#include "libavutil/intreadwrite.h"
+
+#define NB_PKTS     8
+#define NB_FRAMES   8
+#define PKT_SAMPLES 16
+
+static AVPacket *pkts[NB_PKTS + 1];
+static AVFrame  *frames[NB_FRAMES];
+
+/* Decode pkts[first .. first + nb_pkts - 1] into up to nb_frames frames and
+ * check the return value, the consumed and returned counts and that frame i
+ * holds the samples of packet first_frame + i. */
+static int check(AVCodecContext *avctx, const char *name, int first,
+                 int nb_pkts, int nb_frames, int exp_ret, int exp_pkts,
+                 int exp_frames, int first_frame)
+{
+    int ret = avcodec_decode_packets(avctx, (const AVPacket * const *)pkts + first,
+                                     &nb_pkts, frames, &nb_frames);
+
+    if (ret != exp_ret || nb_pkts != exp_pkts || nb_frames != exp_frames) {
+        fprintf(stderr, "%s: got ret %d (%s), %d packets, %d frames, "
+                "expected ret %d, %d packets, %d frames\n", name,
+                ret, av_err2str(ret), nb_pkts, nb_frames,
+                exp_ret, exp_pkts, exp_frames);
+        return 1;
+    }
+
+    for (int i = 0; i < nb_frames; i++) {
+        const AVFrame *frame = frames[i];
+        int idx = first_frame + i;
+
+        if (frame->nb_samples != PKT_SAMPLES ||
+            AV_RN16(frame->data[0]) != idx * 100) {
+            fprintf(stderr, "%s: frame %d has %d samples starting with %d, "
+                    "expected %d samples of packet %d\n", name, i,
+                    frame->nb_samples, AV_RN16(frame->data[0]),
+                    PKT_SAMPLES, idx);
+            return 1;
+        }
+        av_frame_unref(frames[i]);
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_PCM_S16LE);
+    AVCodecContext *avctx = NULL;
+    int ret = 1;
+
+    if (!codec) {
+        fprintf(stderr, "pcm_s16le decoder not found\n");
+        return 1;
+    }
+
+    for (int i = 0; i < NB_PKTS; i++) {
+        pkts[i] = av_packet_alloc();
+        if (!pkts[i] || av_new_packet(pkts[i], 2 * PKT_SAMPLES) < 0)
+            goto end;
+        for (int j = 0; j < PKT_SAMPLES; j++)
+            AV_WL16(pkts[i]->data + 2 * j, i * 100 + j);
+    }
+    /* pkts[NB_PKTS] stays NULL, it is used as the flush packet */
+    for (int i = 0; i < NB_FRAMES; i++) {
+        frames[i] = av_frame_alloc();
+        if (!frames[i])
+            goto end;
+    }
+
+    avctx = avcodec_alloc_context3(codec);
+    if (!avctx)
+        goto end;
+    avctx->sample_rate = 8000;
+    av_channel_layout_default(&avctx->ch_layout, 1);
+    if (avcodec_open2(avctx, codec, NULL) < 0) {
+        fprintf(stderr, "Failed to open the decoder\n");
+        goto end;
+    }
+
+    /* no packets: the decoder needs input, this is not an error */
+    if (check(avctx, "no packets", 0, 0, NB_FRAMES, 0, 0, 0, 0))
+        goto end;
+    /* fewer frames than packets: stops once the frames are filled */
+    if (check(avctx, "partial batch", 0, 5, 3, 0, 3, 3, 0))
+        goto end;
+    /* the packets left over are sent again with the next ones */
+    if (check(avctx, "resend", 3, 3, NB_FRAMES, 0, 3, 3, 3))
+        goto end;
+
+    /* mixed with the single packet API */
+    if (avcodec_send_packet(avctx, pkts[6]) < 0) {
+        fprintf(stderr, "avcodec_send_packet() failed\n");
+        goto end;
+    }
+    if (check(avctx, "after send_packet", 7, 0, NB_FRAMES, 0, 0, 1, 6))
+        goto end;
+
+    /* draining returns the last frame, then EOF */
+    if (check(avctx, "flush", 7, 2, NB_FRAMES, AVERROR_EOF, 2, 1, 7))
+        goto end;
+    if (check(avctx, "after EOF", 0, 0, NB_FRAMES, AVERROR_EOF, 0, 0, 0))
+        goto end;
+
+    /* the decoder can be reused after a flush */
+    avcodec_flush_buffers(avctx);
+    if (check(avctx, "after flush_buffers", 2, 1, NB_FRAMES, 0, 1, 1, 2))
+        goto end;
+
+    ret = 0;
+end:
+    avcodec_free_context(&avctx);
+    for (int i = 0; i < NB_PKTS; i++)
+        av_packet_free(&pkts[i]);
+    for (int i = 0; i < NB_FRAMES; i++)
+        av_frame_free(&frames[i]);
+    return ret;
+}
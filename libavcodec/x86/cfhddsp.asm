@@ -32,6 +32,10 @@ pw_1: times 8 dw 1
 pw_0: times 8 dw 0
 pw_1023: times 8 dw 1023
 pw_4095: times 8 dw 4095
+pw_9400: times 8 dw 9400
+
+cextern pw_256
+cextern pd_65535
 
 SECTION .text
 
@@ -695,3 +699,226 @@ cglobal cfhd_vert_filter, 7, 7, 8, output, x, low, y, high, pos, width, height
     cmp        xq, widthq
     jl .loopw
     RET
+
+%if ARCH_X86_64
+; void ff_cfhd_difference_coding(int16_t *band, int width, int height)
+INIT_XMM sse2
+cglobal cfhd_difference_coding, 3, 5, 3, band, width, height, x, tmp
+    movsxdifnidn widthq, widthd
+.looph:
+    pxor       m2, m2
+    xor        xq, xq
+    lea      tmpq, [xq + 8]
+    cmp      tmpq, widthq
+    jg .tail
+.loopw:
+    movu       m0, [bandq + 2 * xq]
+    pslldq     m1, m0, 2
+    paddw      m0, m1
+    pslldq     m1, m0, 4
+    paddw      m0, m1
+    pslldq     m1, m0, 8
+    paddw      m0, m1
+    paddw      m0, m2
+    movu [bandq + 2 * xq], m0
+    pshufhw    m2, m0, q3333
+    punpckhqdq m2, m2
+    add        xq, 8
+    lea      tmpq, [xq + 8]
+    cmp      tmpq, widthq
+    jle .loopw
+.tail:
+    test       xq, xq
+    jnz .tail_loop
+    inc        xq
+.tail_loop:
+    cmp        xq, widthq
+    jge .next
+    mov      tmpw, [bandq + 2 * xq - 2]
+    add [bandq + 2 * xq], tmpw
+    inc        xq
+    jmp .tail_loop
+.next:
+    lea     bandq, [bandq + 2 * widthq]
+    dec   heightd
+    jg .looph
+    RET
+
+; void ff_cfhd_process_alpha(int16_t *alpha, int width)
+cglobal cfhd_process_alpha, 2, 4, 5, alpha, width, x, tmp
+    movsxdifnidn widthq, widthd
+    pxor       m4, m4
+    mova       m2, [pw_9400]
+    mova       m3, [pw_4095]
+    xor        xq, xq
+    lea      tmpq, [xq + mmsize / 2]
+    cmp      tmpq, widthq
+    jg .tail
+.loop:
+    movu       m0, [alphaq + 2 * xq]
+    psubw      m0, [pw_256]
+    psllw      m0, 3
+    pmulhw     m0, m2
+    pmaxsw     m0, m4
+    pminsw     m0, m3
+    movu [alphaq + 2 * xq], m0
+    add        xq, mmsize / 2
+    lea      tmpq, [xq + mmsize / 2]
+    cmp      tmpq, widthq
+    jle .loop
+.tail:
+    cmp        xq, widthq
+    jge .end
+    movsx    tmpd, word [alphaq + 2 * xq]
+    sub      tmpd, 256
+    imul     tmpd, 9400 << 3
+    sar      tmpd, 16
+    jns .positive
+    xor      tmpd, tmpd
+.positive:
+    cmp      tmpd, 4095
+    jle .store
+    mov      tmpd, 4095
+.store:
+    mov [alphaq + 2 * xq], tmpw
+    inc        xq
+    jmp .tail
+.end:
+    RET
+
+; int ff_cfhd_peak_table(int16_t *band, int length, int threshold,
+;                        const uint8_t *peaks, int nb_peaks)
+%macro CFHD_PEAK_TABLE 0
+cglobal cfhd_peak_table, 5, 10, 4, band, length, threshold, peaks, nb_peaks, x, n, mask, pos, val
+    movsxdifnidn lengthq, lengthd
+    movsxdifnidn nb_peaksq, nb_peaksd
+    movd      xm2, thresholdd
+    SPLATW     m2, xm2
+    pxor       m3, m3
+    xor        xq, xq
+    xor        nq, nq
+    lea      posq, [xq + mmsize / 2]
+    cmp      posq, lengthq
+    jg .tail
+.loop:
+    movu       m0, [bandq + 2 * xq]
+    ABS1       m0, m1
+    psubusw    m1, m2, m0
+    pcmpeqw    m1, m3
+    pmovmskb maskd, m1
+    test    maskd, maskd
+    jz .next
+.bits:
+    bsf      posd, maskd
+    xor      valq, valq
+    cmp        nq, nb_peaksq
+    jge .zero
+    movzx    vald, word [peaksq + 2 * nq]
+.zero:
+    lea      posq, [bandq + 2 * xq + posq]
+    mov    [posq], valw
+    inc        nq
+    lea      vald, [maskq - 1]
+    and     maskd, vald
+    lea      vald, [maskq - 1]
+    and     maskd, vald
+    jnz .bits
+.next:
+    add        xq, mmsize / 2
+    lea      posq, [xq + mmsize / 2]
+    cmp      posq, lengthq
+    jle .loop
+.tail:
+    cmp        xq, lengthq
+    jge .end
+    movsx    posd, word [bandq + 2 * xq]
+    mov      vald, posd
+    neg      vald
+    cmovl    vald, posd
+    cmp      vald, thresholdd
+    jl .tail_next
+    xor      vald, vald
+    cmp        nq, nb_peaksq
+    jge .tail_store
+    movzx    vald, word [peaksq + 2 * nq]
+.tail_store:
+    mov [bandq + 2 * xq], valw
+    inc        nq
+.tail_next:
+    inc        xq
+    jmp .tail
+.end:
+    mov       eax, nd
+    RET
+%endmacro
+
+INIT_XMM sse2
+CFHD_PEAK_TABLE
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+CFHD_PEAK_TABLE
+%endif
+
+; void ff_cfhd_process_bayer(uint16_t *dst, ptrdiff_t linesize,
+;                            int width, int height, int bpc)
+; Each dword of the even row holds (g, rg), each dword of the odd one
+; (bg, gd); they are turned into (R, G1) and (G2, B).
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+cglobal cfhd_process_bayer, 5, 7, 12, dst, linesize, width, height, bpc, x, tmp
+    movsxdifnidn widthq, widthd
+    lea        xd, [bpcq - 1]
+    xor      tmpd, tmpd
+    bts      tmpd, xd
+    movd     xm10, tmpd
+    vpbroadcastd m10, xm10                  ; mid
+    mov      tmpd, 16
+    sub      tmpd, bpcd
+    movd     xm11, tmpd                     ; 16 - bpc
+    mova       m9, [pd_65535]
+    pxor       m8, m8
+.looph:
+    xor        xq, xq
+.loopw:
+    movu       m0, [dstq + 2 * xq]
+    movu       m2, [dstq + linesizeq + 2 * xq]
+    pand       m1, m0, m9                   ; g
+    psrld      m0, 16                       ; rg
+    pand       m3, m2, m9                   ; bg
+    psrld      m2, 16                       ; gd
+    psubd      m2, m10
+    psubd      m0, m10
+    psubd      m3, m10
+    pslld      m0, 1
+    pslld      m3, 1
+    paddd      m0, m1                       ; R
+    paddd      m3, m1                       ; B
+    paddd      m4, m1, m2                   ; G1
+    psubd      m1, m2                       ; G2
+    pslld      m0, xm11
+    pslld      m4, xm11
+    pslld      m1, xm11
+    pslld      m3, xm11
+    pmaxsd     m0, m8
+    pmaxsd     m4, m8
+    pmaxsd     m1, m8
+    pmaxsd     m3, m8
+    pminsd     m0, m9
+    pminsd     m4, m9
+    pminsd     m1, m9
+    pminsd     m3, m9
+    pslld      m4, 16
+    pslld      m3, 16
+    por        m0, m4
+    por        m1, m3
+    movu [dstq + 2 * xq], m0
+    movu [dstq + linesizeq + 2 * xq], m1
+    add        xq, mmsize / 2
+    cmp        xq, widthq
+    jl .loopw
+    lea      dstq, [dstq + 2 * linesizeq]
+    dec   heightd
+    jg .looph
+    RET
+%endif
+%endif
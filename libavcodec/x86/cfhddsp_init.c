@@ -37,6 +37,14 @@ void ff_cfhd_vert_filter_sse2(int16_t *output, ptrdiff_t out_stride,
                               int width, int height);
 void ff_cfhd_horiz_filter_clip10_sse2(int16_t *output, const int16_t *low, const int16_t *high, int width, int bpc);
 void ff_cfhd_horiz_filter_clip12_sse2(int16_t *output, const int16_t *low, const int16_t *high, int width, int bpc);
+void ff_cfhd_difference_coding_sse2(int16_t *band, int width, int height);
+void ff_cfhd_process_alpha_sse2(int16_t *alpha, int width);
+int ff_cfhd_peak_table_sse2(int16_t *band, int length, int threshold,
+                            const uint8_t *peaks, int nb_peaks);
+int ff_cfhd_peak_table_avx2(int16_t *band, int length, int threshold,
+                            const uint8_t *peaks, int nb_peaks);
+void ff_cfhd_process_bayer_avx2(uint16_t *dst, ptrdiff_t linesize,
+                                int width, int height, int bpc);
 
 av_cold void ff_cfhddsp_init_x86(CFHDDSPContext *c, int depth, int bayer)
 {
@@ -50,4 +58,17 @@ av_cold void ff_cfhddsp_init_x86(CFHDDSPContext *c, int depth, int bayer)
         if (depth == 12 && !bayer)
             c->horiz_filter_clip = ff_cfhd_horiz_filter_clip12_sse2;
     }
+
+#if ARCH_X86_64
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        c->difference_coding = ff_cfhd_difference_coding_sse2;
+        c->peak_table        = ff_cfhd_peak_table_sse2;
+        c->process_alpha     = ff_cfhd_process_alpha_sse2;
+    }
+
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        c->peak_table        = ff_cfhd_peak_table_avx2;
+        c->process_bayer     = ff_cfhd_process_bayer_avx2;
+    }
+#endif
 }
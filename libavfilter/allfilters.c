@@ -293,6 +293,7 @@ extern const AVFilter ff_vf_graphmonitor;
 extern const AVFilter ff_vf_grayworld;
 extern const AVFilter ff_vf_greyedge;
 extern const AVFilter ff_vf_guided;
+extern const AVFilter ff_vf_gyrostab;
 extern const AVFilter ff_vf_haldclut;
 extern const AVFilter ff_vf_hflip;
 extern const AVFilter ff_vf_hflip_vulkan;
@@ -355,6 +356,7 @@ extern const AVFilter ff_vf_morpho;
 extern const AVFilter ff_vf_mpdecimate;
 extern const AVFilter ff_vf_msad;
 extern const AVFilter ff_vf_multiply;
+extern const AVFilter ff_vf_multiscale;
 extern const AVFilter ff_vf_negate;
 extern const AVFilter ff_vf_nlmeans;
 extern const AVFilter ff_vf_nlmeans_opencl;
@@ -935,6 +935,17 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    /**
+     * A reference to a shared thread pool created with
+     * av_thread_pool_create(), on which the slice threading of the filters
+     * and of their scaling contexts runs instead of on threads private to
+     * this graph. nb_threads then only limits how many pool threads work for
+     * a single filter at once. May be set by the caller before adding any
+     * filters to the filtergraph, the reference is owned and freed by
+     * libavfilter.
+     */
+    AVBufferRef *thread_pool;
 } AVFilterGraph;
 
 /**
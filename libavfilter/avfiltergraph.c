@@ -127,6 +127,7 @@ void avfilter_graph_free(AVFilterGraph **graph)
     ff_graph_thread_free(*graph);
 
     av_freep(&(*graph)->sink_links);
+    av_buffer_unref(&(*graph)->thread_pool);
 
     av_opt_free(*graph);
 
@@ -111,10 +111,21 @@ typedef struct XYRemap {
     float ker[4][4];
 } XYRemap;
 
+typedef struct RemapBlock {
+    float u[4], v[4];
+    int ok;
+} RemapBlock;
+
 typedef struct SliceXYRemap {
     int16_t *u[2], *v[2];
     int16_t *ker[2];
     uint8_t *mask;
+    uint8_t *frac[2];       ///< quantized kernel position per pixel, compact mode only
+    int16_t *win[2];        ///< full windows of irregular pixels, compact mode only
+    unsigned win_size[2];
+    int *win_offset[2];     ///< index of the first irregular pixel of each row
+    uint8_t *out_mask;      ///< output projection mask, frame_rot only
+    RemapBlock *blocks;
 } SliceXYRemap;
 
 typedef struct V360Context {
@@ -123,6 +134,9 @@ typedef struct V360Context {
     int interp;
     int alpha;
     int reset_rot;
+    int compact;
+    int use_compact;              ///< compact remap tables are used, never for nearest
+    int frame_rot;
     int width, height;
     char *in_forder;
     char *out_forder;
@@ -154,6 +168,19 @@ typedef struct V360Context {
     float iflat_range[2];
 
     float rot_quaternion[2][4];
+    float frame_quaternion[2][4];
+    int32_t frame_ypr[3];
+    int rot_changed;
+
+    int stabilize;                ///< gyrostab: rotation comes from frame telemetry
+    float smooth, zoom;
+    char *axes;
+    int axis_map[3];
+    float axis_sign[3];
+    float stab_quaternion[4];     ///< smoothed camera orientation
+    float stab_correction[4];     ///< rotation from the smoothed to the actual camera
+    int64_t stab_pts;
+    int have_stab;
 
     float output_mirror_modifier[3];
 
@@ -178,6 +205,8 @@ typedef struct V360Context {
     SliceXYRemap *slice_remap;
     unsigned map[4];
 
+    int16_t frac_coeffs[256][4];
+
     int (*in_transform)(const struct V360Context *s,
                         const float *vec, int width, int height,
                         int16_t us[4][4], int16_t vs[4][4], float *du, float *dv);
@@ -189,6 +218,8 @@ typedef struct V360Context {
     void (*calculate_kernel)(float du, float dv, const XYRemap *rmap,
                              int16_t *u, int16_t *v, int16_t *ker);
 
+    void (*calculate_coeffs)(float t, float *coeffs);
+
     int (*remap_slice)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 
     void (*remap_line)(uint8_t *dst, int width, const uint8_t *const src, ptrdiff_t in_linesize,
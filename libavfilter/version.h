@@ -31,7 +31,7 @@
 
 #include "version_major.h"
 
-#define LIBAVFILTER_VERSION_MINOR  44
+#define LIBAVFILTER_VERSION_MINOR  47
 #define LIBAVFILTER_VERSION_MICRO 100
 
 
@@ -0,0 +1,453 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale one video input to several output sizes in a single pass
+ *
+ * The outputs are computed from the largest to the smallest one. With
+ * cascading enabled, each output is scaled down from the smallest output
+ * already computed that covers it instead of from the full size input,
+ * which cuts the memory traffic of encoding ladders considerably. Outputs
+ * with the same size as the input or as another output share its buffers.
+ */
+
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct MultiScaleOutput {
+    int w, h;
+    int src;                    ///< index of the output scaled from, -1 for the input
+    struct SwsContext *sws;     ///< NULL if the source is passed through
+} MultiScaleOutput;
+
+typedef struct MultiScaleContext {
+    const AVClass *class;
+
+    char *sizes_str;
+    char *flags_str;
+    int cascade;
+
+    AVDictionary *opts;
+    int flags;
+
+    int nb_outputs;
+    MultiScaleOutput *outputs;
+    int *order;                 ///< output indices by decreasing size
+    AVFrame **frames;
+    uint8_t *needed;
+} MultiScaleContext;
+
+static int config_output(AVFilterLink *outlink);
+
+static av_cold int init_dict(AVFilterContext *ctx, AVDictionary **opts)
+{
+    MultiScaleContext *s = ctx->priv;
+    const char *p = s->sizes_str;
+    int ret;
+
+    if (!p || !*p) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    while (*p) {
+        AVFilterPad pad = { 0 };
+        MultiScaleOutput *o;
+        char *size = av_get_token(&p, "|");
+
+        if (!size)
+            return AVERROR(ENOMEM);
+        if (*p)
+            p++;
+
+        o = av_dynarray2_add((void **)&s->outputs, &s->nb_outputs,
+                             sizeof(*s->outputs), NULL);
+        if (!o) {
+            av_free(size);
+            return AVERROR(ENOMEM);
+        }
+        memset(o, 0, sizeof(*o));
+        ret = av_parse_video_size(&o->w, &o->h, size);
+        if (ret < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", size);
+            av_free(size);
+            return ret;
+        }
+        av_free(size);
+
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.config_props = config_output;
+        pad.name         = av_asprintf("output%d", s->nb_outputs - 1);
+        if (!pad.name)
+            return AVERROR(ENOMEM);
+        if ((ret = ff_append_outpad_free_name(ctx, &pad)) < 0)
+            return ret;
+    }
+
+    s->order  = av_calloc(s->nb_outputs, sizeof(*s->order));
+    s->frames = av_calloc(s->nb_outputs, sizeof(*s->frames));
+    s->needed = av_calloc(s->nb_outputs, sizeof(*s->needed));
+    if (!s->order || !s->frames || !s->needed)
+        return AVERROR(ENOMEM);
+
+    /* stable insertion sort, larger outputs first */
+    for (int i = 0; i < s->nb_outputs; i++) {
+        int64_t area = (int64_t)s->outputs[i].w * s->outputs[i].h;
+        int j = i;
+
+        for (; j > 0; j--) {
+            const MultiScaleOutput *prev = &s->outputs[s->order[j - 1]];
+            if ((int64_t)prev->w * prev->h >= area)
+                break;
+            s->order[j] = s->order[j - 1];
+        }
+        s->order[j] = i;
+    }
+
+    if (s->flags_str && *s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        ret = av_opt_eval_flags(&class, o, s->flags_str, &s->flags);
+        if (ret < 0)
+            return ret;
+    }
+    s->opts = *opts;
+    *opts = NULL;
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+
+    for (int i = 0; i < s->nb_outputs; i++)
+        sws_freeContext(s->outputs[i].sws);
+    av_freep(&s->outputs);
+    av_freep(&s->order);
+    av_freep(&s->frames);
+    av_freep(&s->needed);
+    av_dict_free(&s->opts);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *formats = NULL;
+    const AVPixFmtDescriptor *desc = NULL;
+    int ret;
+
+    /* the outputs are scaled from each other, so they all share one format */
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+
+        if (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL |
+                           AV_PIX_FMT_FLAG_BITSTREAM))
+            continue;
+        if (sws_isSupportedInput(pix_fmt) && sws_isSupportedOutput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+
+    return ff_set_common_formats(ctx, formats);
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MultiScaleContext *s = ctx->priv;
+
+    for (int k = 0; k < s->nb_outputs; k++) {
+        MultiScaleOutput *o = &s->outputs[s->order[k]];
+        int64_t best = INT64_MAX;
+
+        o->src = -1;
+        for (int l = 0; l < k; l++) {
+            const MultiScaleOutput *prev = &s->outputs[s->order[l]];
+            int64_t area = (int64_t)prev->w * prev->h;
+
+            if (prev->w == o->w && prev->h == o->h) {
+                o->src = s->order[l];
+                break;
+            }
+            if (s->cascade && prev->w >= o->w && prev->h >= o->h &&
+                area < best && (prev->w != inlink->w || prev->h != inlink->h)) {
+                o->src = s->order[l];
+                best   = area;
+            }
+        }
+        if (o->w == inlink->w && o->h == inlink->h)
+            o->src = -1;
+    }
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    MultiScaleContext *s = ctx->priv;
+    MultiScaleOutput *o = &s->outputs[FF_OUTLINK_IDX(outlink)];
+    int src_w = o->src < 0 ? inlink->w : s->outputs[o->src].w;
+    int src_h = o->src < 0 ? inlink->h : s->outputs[o->src].h;
+    int ret;
+
+    outlink->w = o->w;
+    outlink->h = o->h;
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ outlink->h * inlink->w,
+                                                              outlink->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    sws_freeContext(o->sws);
+    o->sws = NULL;
+    if (src_w == o->w && src_h == o->h)
+        return 0;
+
+    o->sws = sws_alloc_context();
+    if (!o->sws)
+        return AVERROR(ENOMEM);
+
+    av_opt_set_int(o->sws, "srcw", src_w, 0);
+    av_opt_set_int(o->sws, "srch", src_h, 0);
+    av_opt_set_int(o->sws, "src_format", inlink->format, 0);
+    av_opt_set_int(o->sws, "dstw", o->w, 0);
+    av_opt_set_int(o->sws, "dsth", o->h, 0);
+    av_opt_set_int(o->sws, "dst_format", outlink->format, 0);
+    av_opt_set_int(o->sws, "sws_flags", s->flags, 0);
+    av_opt_set_int(o->sws, "threads", ff_filter_get_nb_threads(ctx), 0);
+    if ((ret = sws_set_thread_pool(o->sws, ctx->graph->thread_pool)) < 0)
+        return ret;
+
+    if (s->opts) {
+        const AVDictionaryEntry *e = NULL;
+        while ((e = av_dict_get(s->opts, "", e, AV_DICT_IGNORE_SUFFIX))) {
+            if ((ret = av_opt_set(o->sws, e->key, e->value, 0)) < 0)
+                return ret;
+        }
+    }
+
+    /* MPEG-2 chroma positions, like the scale filter */
+    if (inlink->format == AV_PIX_FMT_YUV420P) {
+        av_opt_set_int(o->sws, "src_v_chr_pos", 128, 0);
+        av_opt_set_int(o->sws, "dst_v_chr_pos", 128, 0);
+    }
+
+    if ((ret = sws_init_context(o->sws, NULL, NULL)) < 0)
+        return ret;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d: w:%d h:%d from %s%d\n",
+           FF_OUTLINK_IDX(outlink), o->w, o->h,
+           o->src < 0 ? "input" : "output", o->src < 0 ? 0 : o->src);
+
+    return 0;
+}
+
+static int scale_frame(AVFilterContext *ctx, AVFrame *in, int idx, AVFrame **out)
+{
+    MultiScaleContext *s = ctx->priv;
+    AVFilterLink *inlink  = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[idx];
+    const MultiScaleOutput *o = &s->outputs[idx];
+    const AVFrame *src = o->src < 0 ? in : s->frames[o->src];
+    AVFrame *dst;
+    int ret;
+
+    if (!o->sws) {
+        *out = av_frame_clone(src);
+        return *out ? 0 : AVERROR(ENOMEM);
+    }
+
+    dst = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!dst)
+        return AVERROR(ENOMEM);
+
+    ret = av_frame_copy_props(dst, in);
+    if (ret < 0)
+        goto fail;
+    dst->width  = outlink->w;
+    dst->height = outlink->h;
+
+    av_reduce(&dst->sample_aspect_ratio.num, &dst->sample_aspect_ratio.den,
+              (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+              (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+              INT_MAX);
+
+    ret = sws_scale_frame(o->sws, dst, src);
+    if (ret < 0)
+        goto fail;
+
+    *out = dst;
+    return 0;
+fail:
+    av_frame_free(&dst);
+    return ret;
+}
+
+static int filter_frame(AVFilterContext *ctx, AVFrame *in)
+{
+    MultiScaleContext *s = ctx->priv;
+    int ret = 0;
+
+    /* skip the outputs nobody is waiting for anymore, unless
+     * a smaller output is scaled from them */
+    for (int i = 0; i < s->nb_outputs; i++)
+        s->needed[i] = !ff_outlink_get_status(ctx->outputs[i]);
+    for (int k = s->nb_outputs - 1; k >= 0; k--) {
+        const MultiScaleOutput *o = &s->outputs[s->order[k]];
+        if (s->needed[s->order[k]] && o->src >= 0)
+            s->needed[o->src] = 1;
+    }
+
+    for (int k = 0; k < s->nb_outputs; k++) {
+        int i = s->order[k];
+
+        if (!s->needed[i])
+            continue;
+        ret = scale_frame(ctx, in, i, &s->frames[i]);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        if (!s->frames[i] || ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+        ret = ff_filter_frame(ctx->outputs[i], s->frames[i]);
+        s->frames[i] = NULL;
+        if (ret < 0)
+            break;
+    }
+
+end:
+    for (int i = 0; i < s->nb_outputs; i++)
+        av_frame_free(&s->frames[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFrame *in;
+    int status, ret, nb_eofs = 0;
+    int64_t pts;
+
+    /* the input is only closed once every rendition has ended,
+     * the others keep receiving frames */
+    for (int i = 0; i < ctx->nb_outputs; i++)
+        nb_eofs += !!ff_outlink_get_status(ctx->outputs[i]);
+    if (nb_eofs == ctx->nb_outputs) {
+        ff_inlink_set_status(inlink, AVERROR_EOF);
+        return 0;
+    }
+
+    ret = ff_inlink_consume_frame(inlink, &in);
+    if (ret < 0)
+        return ret;
+    if (ret > 0) {
+        ret = filter_frame(ctx, in);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if (ff_outlink_get_status(ctx->outputs[i]))
+                continue;
+            ff_outlink_set_status(ctx->outputs[i], status, pts);
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        if (ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+
+        if (ff_outlink_frame_wanted(ctx->outputs[i])) {
+            ff_inlink_request_frame(inlink);
+            return 0;
+        }
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+static const AVClass *child_class_iterate(void **iter)
+{
+    const AVClass *c = *iter ? NULL : sws_get_class();
+    *iter = (void*)(uintptr_t)c;
+    return c;
+}
+
+#define OFFSET(x) offsetof(MultiScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption multiscale_options[] = {
+    { "sizes",   "set the output sizes, separated by '|'", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL }, .flags = FLAGS },
+    { "flags",   "Flags to pass to libswscale",            OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "" },   .flags = FLAGS },
+    { "cascade", "scale each output from the next larger one", OFFSET(cascade), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, FLAGS },
+    { NULL }
+};
+
+static const AVClass multiscale_class = {
+    .class_name          = "multiscale",
+    .item_name           = av_default_item_name,
+    .option              = multiscale_options,
+    .version             = LIBAVUTIL_VERSION_INT,
+    .category            = AV_CLASS_CATEGORY_FILTER,
+    .child_class_iterate = child_class_iterate,
+};
+
+static const AVFilterPad multiscale_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
+    },
+};
+
+const AVFilter ff_vf_multiscale = {
+    .name            = "multiscale",
+    .description     = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes at once."),
+    .init_dict       = init_dict,
+    .uninit          = uninit,
+    .priv_size       = sizeof(MultiScaleContext),
+    .priv_class      = &multiscale_class,
+    .activate        = activate,
+    FILTER_INPUTS(multiscale_inputs),
+    .outputs         = NULL,
+    FILTER_QUERY_FUNC(query_formats),
+    .flags           = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
@@ -544,6 +544,8 @@ static int config_props(AVFilterLink *outlink)
             av_opt_set_int(s, "param0", scale->param[0], 0);
             av_opt_set_int(s, "param1", scale->param[1], 0);
             av_opt_set_int(s, "threads", ff_filter_get_nb_threads(ctx), 0);
+            if ((ret = sws_set_thread_pool(s, ctx->graph->thread_pool)) < 0)
+                return ret;
             if (scale->in_range != AVCOL_RANGE_UNSPECIFIED)
                 av_opt_set_int(s, "src_range",
                                scale->in_range == AVCOL_RANGE_JPEG, 0);
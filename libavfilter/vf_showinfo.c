@@ -37,6 +37,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/spherical.h"
 #include "libavutil/stereo3d.h"
+#include "libavutil/telemetry.h"
 #include "libavutil/timestamp.h"
 #include "libavutil/timecode.h"
 #include "libavutil/mastering_display_metadata.h"
@@ -401,6 +402,32 @@ static void dump_content_light_metadata(AVFilterContext *ctx, AVFrameSideData *s
            metadata->MaxCLL, metadata->MaxFALL);
 }
 
+static void dump_telemetry(AVFilterContext *ctx, const AVFrameSideData *sd)
+{
+    const AVTelemetry *t = (const AVTelemetry *)sd->data;
+
+    av_log(ctx, AV_LOG_INFO, "telemetry: ");
+    if (sd->size < sizeof(*t)) {
+        av_log(ctx, AV_LOG_ERROR, "invalid data");
+        return;
+    }
+
+    if (t->flags & AV_TELEMETRY_GYRO)
+        av_log(ctx, AV_LOG_INFO, "gyro=(%f/%f/%f) ",
+               t->gyro[0], t->gyro[1], t->gyro[2]);
+    if (t->flags & AV_TELEMETRY_ACCEL)
+        av_log(ctx, AV_LOG_INFO, "accel=(%f/%f/%f) ",
+               t->accel[0], t->accel[1], t->accel[2]);
+    if (t->flags & AV_TELEMETRY_ORIENTATION)
+        av_log(ctx, AV_LOG_INFO, "orientation=(%f/%f/%f/%f) ",
+               t->orientation[0], t->orientation[1],
+               t->orientation[2], t->orientation[3]);
+    if (t->flags & AV_TELEMETRY_GPS)
+        av_log(ctx, AV_LOG_INFO, "gps=(%f/%f/%f) speed=%f/%f",
+               t->latitude, t->longitude, t->altitude,
+               t->speed_2d, t->speed_3d);
+}
+
 static void dump_video_enc_params(AVFilterContext *ctx, const AVFrameSideData *sd)
 {
     const AVVideoEncParams *par = (const AVVideoEncParams *)sd->data;
@@ -807,6 +834,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
         case AV_FRAME_DATA_DOVI_METADATA:
             dump_dovi_metadata(ctx, sd);
             break;
+        case AV_FRAME_DATA_TELEMETRY:
+            dump_telemetry(ctx, sd);
+            break;
         default:
             av_log(ctx, AV_LOG_WARNING, "unknown side data type %d "
                    "(%"SIZE_SPECIFIER" bytes)\n", sd->type, sd->size);
@@ -33,18 +33,27 @@
  * 5) Remap input frame to output frame using precalculated data
  */
 
+#include "config_components.h"
+
 #include <math.h>
 
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/opt.h"
+#include "libavutil/spherical.h"
+#include "libavutil/telemetry.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
 #include "v360.h"
 
+/* size of the blocks interpolated when updating remap data for a new rotation */
+#define GRID_SIZE 16
+/* maximal error in input pixels allowed for block interpolation */
+#define GRID_TOLERANCE 0.125f
+
 typedef struct ThreadData {
     AVFrame *in;
     AVFrame *out;
@@ -167,6 +176,8 @@ static const AVOption v360_options[] = {
     {  "v_offset", "output vertical off-axis offset",  OFFSET(v_offset), AV_OPT_TYPE_FLOAT,{.dbl=0.f},       -1.f,                 1.f,TFLAGS, "v_offset"},
     {"alpha_mask", "build mask in alpha plane",      OFFSET(alpha), AV_OPT_TYPE_BOOL,   {.i64=0},               0,                   1, FLAGS, "alpha"},
     { "reset_rot", "reset rotation",             OFFSET(reset_rot), AV_OPT_TYPE_BOOL,   {.i64=0},              -1,                   1,TFLAGS, "reset_rot"},
+    {   "compact", "use compact remap tables",     OFFSET(compact), AV_OPT_TYPE_BOOL,   {.i64=0},               0,                   1, FLAGS, "compact"},
+    { "frame_rot", "apply per-frame rotation",   OFFSET(frame_rot), AV_OPT_TYPE_BOOL,   {.i64=0},               0,                   1, FLAGS, "frame_rot"},
     { NULL }
 };
 
@@ -333,6 +344,109 @@ DEFINE_REMAP(2, 16)
 DEFINE_REMAP(3, 16)
 DEFINE_REMAP(4, 16)
 
+/**
+ * Generate remapping function for compact remap tables with a given window
+ * size and pixel depth.
+ *
+ * Only the top-left window coordinate and the quantized kernel position are
+ * stored per pixel, the kernel is rebuilt from s->frac_coeffs on the fly.
+ * Pixels whose window collapses to a single input pixel store its inverted u.
+ * Pixels whose window is not a plain rectangle of the input, like at cubemap
+ * face borders or equirectangular seams, store a negative u and v and read
+ * their full window from r->win instead.
+ *
+ * @param ws size of interpolation window
+ * @param bits number of bits per pixel
+ */
+#define DEFINE_REMAP_COMPACT(ws, bits)                                                                     \
+static int remap##ws##_##bits##bit_compact_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)  \
+{                                                                                                          \
+    ThreadData *td = arg;                                                                                  \
+    const V360Context *s = ctx->priv;                                                                      \
+    const SliceXYRemap *r = &s->slice_remap[jobnr];                                                        \
+    const AVFrame *in = td->in;                                                                            \
+    AVFrame *out = td->out;                                                                                \
+    const int su = s->ih_flip ? -1 : 1;                                                                    \
+    const int sv = s->iv_flip ? -1 : 1;                                                                    \
+                                                                                                           \
+    for (int stereo = 0; stereo < 1 + s->out_stereo > STEREO_2D; stereo++) {                               \
+        for (int plane = 0; plane < s->nb_planes; plane++) {                                               \
+            const unsigned map = s->map[plane];                                                            \
+            const int in_linesize  = in->linesize[plane] / (bits >> 3);                                    \
+            const int out_linesize = out->linesize[plane];                                                 \
+            const int uv_linesize = s->uv_linesize[plane];                                                 \
+            const int in_offset_w = stereo ? s->in_offset_w[plane] : 0;                                    \
+            const int in_offset_h = stereo ? s->in_offset_h[plane] : 0;                                    \
+            const int out_offset_w = stereo ? s->out_offset_w[plane] : 0;                                  \
+            const int out_offset_h = stereo ? s->out_offset_h[plane] : 0;                                  \
+            const uint##bits##_t *const src = (const uint##bits##_t *)in->data[plane] +                    \
+                                              in_offset_h * in_linesize + in_offset_w;                     \
+            uint8_t *dst = out->data[plane] + out_offset_h * out_linesize + out_offset_w * (bits >> 3);    \
+            const uint8_t *mask = plane == 3 ? r->mask : NULL;                                             \
+            const int width = s->pr_width[plane];                                                          \
+            const int height = s->pr_height[plane];                                                        \
+                                                                                                           \
+            const int slice_start = (height *  jobnr     ) / nb_jobs;                                      \
+            const int slice_end   = (height * (jobnr + 1)) / nb_jobs;                                      \
+                                                                                                           \
+            for (int y = slice_start; y < slice_end && !mask; y++) {                                       \
+                const int16_t *const u = r->u[map] + (y - slice_start) * uv_linesize;                      \
+                const int16_t *const v = r->v[map] + (y - slice_start) * uv_linesize;                      \
+                const uint8_t *const frac = r->frac[map] + (y - slice_start) * uv_linesize * 2;            \
+                const int16_t *win = r->win[map] + r->win_offset[map][y - slice_start] * ws * ws * 3;      \
+                uint##bits##_t *d = (uint##bits##_t *)(dst + y * out_linesize);                           \
+                                                                                                           \
+                for (int x = 0; x < width; x++) {                                                          \
+                    if (u[x] >= 0) {                                                                       \
+                        const int16_t *const cu = s->frac_coeffs[frac[2 * x + 0]];                         \
+                        const int16_t *const cv = s->frac_coeffs[frac[2 * x + 1]];                         \
+                        const uint##bits##_t *ss = src + v[x] * in_linesize + u[x];                        \
+                        int64_t tmp = 0;                                                                   \
+                                                                                                           \
+                        for (int i = 0; i < ws; i++) {                                                     \
+                            int sum = 0;                                                                   \
+                                                                                                           \
+                            for (int j = 0; j < ws; j++)                                                   \
+                                sum += cu[j] * ss[j * su];                                                 \
+                            tmp += (int64_t)cv[i] * sum;                                                   \
+                            ss += sv * in_linesize;                                                        \
+                        }                                                                                  \
+                                                                                                           \
+                        d[x] = av_clip_uint##bits((tmp + (1 << 27)) >> 28);                                \
+                    } else if (v[x] >= 0) {                                                                \
+                        d[x] = src[v[x] * in_linesize + ~u[x]];                                            \
+                    } else {                                                                               \
+                        const int16_t *const uu = win;                                                     \
+                        const int16_t *const vv = win + ws * ws;                                           \
+                        const int16_t *const kker = win + ws * ws * 2;                                     \
+                        int tmp = 0;                                                                       \
+                                                                                                           \
+                        for (int i = 0; i < ws * ws; i++)                                                  \
+                            tmp += kker[i] * src[vv[i] * in_linesize + uu[i]];                             \
+                                                                                                           \
+                        d[x] = av_clip_uint##bits(tmp >> 14);                                              \
+                        win += ws * ws * 3;                                                                \
+                    }                                                                                      \
+                }                                                                                          \
+            }                                                                                              \
+                                                                                                           \
+            for (int y = slice_start; y < slice_end && mask; y++) {                                        \
+                memcpy(dst + y * out_linesize, mask +                                                      \
+                       (y - slice_start) * width * (bits >> 3), width * (bits >> 3));                      \
+            }                                                                                              \
+        }                                                                                                  \
+    }                                                                                                      \
+                                                                                                           \
+    return 0;                                                                                              \
+}
+
+DEFINE_REMAP_COMPACT(2,  8)
+DEFINE_REMAP_COMPACT(3,  8)
+DEFINE_REMAP_COMPACT(4,  8)
+DEFINE_REMAP_COMPACT(2, 16)
+DEFINE_REMAP_COMPACT(3, 16)
+DEFINE_REMAP_COMPACT(4, 16)
+
 #define DEFINE_REMAP_LINE(ws, bits, div)                                                      \
 static void remap##ws##_##bits##bit_line_c(uint8_t *dst, int width, const uint8_t *const src, \
                                            ptrdiff_t in_linesize,                             \
@@ -414,6 +528,18 @@ static void nearest_kernel(float du, float dv, const XYRemap *rmap,
     v[0] = rmap->v[i][j];
 }
 
+/**
+ * Calculate 1-dimensional linear coefficients.
+ *
+ * @param t relative coordinate
+ * @param coeffs coefficients
+ */
+static void calculate_bilinear_coeffs(float t, float *coeffs)
+{
+    coeffs[0] = 1.f - t;
+    coeffs[1] = t;
+}
+
 /**
  * Calculate kernel for bilinear interpolation.
  *
@@ -711,6 +837,17 @@ static void calculate_cubic_bc_coeffs(float t, float *coeffs,
     }
 }
 
+/**
+ * Calculate 1-dimensional mitchell coefficients.
+ *
+ * @param t relative coordinate
+ * @param coeffs coefficients
+ */
+static void calculate_mitchell_coeffs(float t, float *coeffs)
+{
+    calculate_cubic_bc_coeffs(t, coeffs, 1.f / 3.f, 1.f / 3.f);
+}
+
 /**
  * Calculate kernel for mitchell interpolation.
  *
@@ -4111,6 +4248,33 @@ static inline void input_flip(int16_t u[4][4], int16_t v[4][4], int w, int h, in
     }
 }
 
+/**
+ * Build the fixed-point 1-dimensional coefficients used by compact remap tables.
+ *
+ * Each set is normalized to sum up to exactly 1 << 14 so that flat areas
+ * are preserved.
+ *
+ * @param s filter private context
+ * @param ws size of interpolation window
+ */
+static void init_frac_coeffs(V360Context *s, int ws)
+{
+    for (int n = 0; n < 256; n++) {
+        float coeffs[4];
+        int sum = 0, max = 0;
+
+        s->calculate_coeffs(n / 255.f, coeffs);
+
+        for (int i = 0; i < ws; i++) {
+            s->frac_coeffs[n][i] = lrintf(coeffs[i] * 16384.f);
+            sum += s->frac_coeffs[n][i];
+            if (s->frac_coeffs[n][i] > s->frac_coeffs[n][max])
+                max = i;
+        }
+        s->frac_coeffs[n][max] += 16384 - sum;
+    }
+}
+
 static int allocate_plane(V360Context *s, int sizeof_uv, int sizeof_ker, int sizeof_mask, int p)
 {
     const int pr_height = s->pr_height[p];
@@ -4134,11 +4298,33 @@ static int allocate_plane(V360Context *s, int sizeof_uv, int sizeof_ker, int siz
                 return AVERROR(ENOMEM);
         }
 
+        if (s->frame_rot && !p) {
+            if (!r->blocks)
+                r->blocks = av_calloc((s->pr_width[p] + GRID_SIZE - 1) / GRID_SIZE, sizeof(*r->blocks));
+            if (!r->blocks)
+                return AVERROR(ENOMEM);
+        }
+
+        if (s->use_compact) {
+            if (!r->frac[p])
+                r->frac[p] = av_calloc(s->uv_linesize[p] * height, 2);
+            if (!r->win_offset[p])
+                r->win_offset[p] = av_calloc(height, sizeof(*r->win_offset[p]));
+            if (!r->frac[p] || !r->win_offset[p])
+                return AVERROR(ENOMEM);
+        }
+
         if (sizeof_mask && !p) {
             if (!r->mask)
                 r->mask = av_calloc(s->pr_width[p] * height, sizeof_mask);
             if (!r->mask)
                 return AVERROR(ENOMEM);
+            if (s->frame_rot) {
+                if (!r->out_mask)
+                    r->out_mask = av_calloc(s->pr_width[p] * height, 1);
+                if (!r->out_mask)
+                    return AVERROR(ENOMEM);
+            }
         }
     }
 
@@ -4226,60 +4412,339 @@ static void set_dimensions(int *outw, int *outh, int w, int h, const AVPixFmtDes
     outh[0] = outh[3] = h;
 }
 
+/**
+ * Save compact remap data for one pixel.
+ *
+ * @param s filter private context
+ * @param r slice remap data
+ * @param p index of the remap data
+ * @param offset offset of the pixel in the slice remap data
+ * @param du horizontal relative coordinate
+ * @param dv vertical relative coordinate
+ * @param rmap calculated 4x4 window
+ * @param nb_win number of full windows stored in the slice
+ * @return 0 on success, negative AVERROR on failure
+ */
+static int compact_kernel(const V360Context *s, SliceXYRemap *r, int p, int offset,
+                          float du, float dv, const XYRemap *rmap, int *nb_win)
+{
+    const int ws = s->elements == 4 ? 2 : s->elements == 9 ? 3 : 4;
+    const int o = ws == 4 ? 0 : 1;
+    const int su = s->ih_flip ? -1 : 1;
+    const int sv = s->iv_flip ? -1 : 1;
+    int16_t *u = r->u[p] + offset;
+    int16_t *v = r->v[p] + offset;
+    uint8_t *frac = r->frac[p] + offset * 2;
+    const XYRemap *t = rmap;
+    XYRemap tmap;
+    int regular = 1, single = 1;
+    float tu = du, tv = dv;
+    int16_t *win;
+
+    if (s->in_transpose) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                tmap.u[i][j] = rmap->u[j][i];
+                tmap.v[i][j] = rmap->v[j][i];
+            }
+        }
+        FFSWAP(float, tu, tv);
+        t = &tmap;
+    }
+
+    for (int i = 0; i < ws; i++) {
+        for (int j = 0; j < ws; j++) {
+            const int uu = t->u[o + i][o + j];
+            const int vv = t->v[o + i][o + j];
+
+            regular &= uu == t->u[o][o] + j * su && vv == t->v[o][o] + i * sv;
+            single  &= uu == t->u[o][o]          && vv == t->v[o][o];
+        }
+    }
+
+    if (regular) {
+        u[0] = t->u[o][o];
+        v[0] = t->v[o][o];
+        frac[0] = av_clip_uint8(lrintf(tu * 255.f));
+        frac[1] = av_clip_uint8(lrintf(tv * 255.f));
+        return 0;
+    } else if (single) {
+        u[0] = ~t->u[o][o];
+        v[0] = t->v[o][o];
+        return 0;
+    }
+
+    win = av_fast_realloc(r->win[p], &r->win_size[p],
+                          (*nb_win + 1) * ws * ws * 3 * sizeof(*win));
+    if (!win)
+        return AVERROR(ENOMEM);
+    r->win[p] = win;
+    win += *nb_win * ws * ws * 3;
+    s->calculate_kernel(du, dv, rmap, win, win + ws * ws, win + ws * ws * 2);
+    (*nb_win)++;
+
+    u[0] = v[0] = -1;
+
+    return 0;
+}
+
+/**
+ * Map output pixel to input window for the current rotation.
+ *
+ * @param s filter private context
+ * @param rot_quaternion rotation quaternion
+ * @param p index of the remap data
+ * @param i horizontal output position
+ * @param j vertical output position
+ * @param rmap calculated 4x4 window, before input flipping
+ * @param du horizontal relative coordinate
+ * @param dv vertical relative coordinate
+ * @param vec rotated unit vector of the pixel
+ * @param out_mask output projection mask
+ * @return input projection mask
+ */
+static int transform_pixel(const V360Context *s, const float rot_quaternion[2][4],
+                           int p, int i, int j, XYRemap *rmap,
+                           float *du, float *dv, float *vec, int *out_mask)
+{
+    const int width = s->pr_width[p];
+    const int height = s->pr_height[p];
+    const int in_width = s->inplanewidth[p];
+    const int in_height = s->inplaneheight[p];
+
+    if (s->out_transpose)
+        *out_mask = s->out_transform(s, j, i, height, width, vec);
+    else
+        *out_mask = s->out_transform(s, i, j, width, height, vec);
+    offset_vector(vec, s->h_offset, s->v_offset);
+    normalize_vector(vec);
+    av_assert1(!isnan(vec[0]) && !isnan(vec[1]) && !isnan(vec[2]));
+    rotate(rot_quaternion, vec);
+    av_assert1(!isnan(vec[0]) && !isnan(vec[1]) && !isnan(vec[2]));
+    normalize_vector(vec);
+    mirror(s->output_mirror_modifier, vec);
+    if (s->in_transpose)
+        return s->in_transform(s, vec, in_height, in_width, rmap->v, rmap->u, du, dv);
+    else
+        return s->in_transform(s, vec, in_width, in_height, rmap->u, rmap->v, du, dv);
+}
+
+/**
+ * Save remap data for one pixel.
+ *
+ * @param s filter private context
+ * @param r slice remap data
+ * @param p index of the remap data
+ * @param y vertical position of the pixel in the slice
+ * @param x horizontal position of the pixel
+ * @param du horizontal relative coordinate
+ * @param dv vertical relative coordinate
+ * @param rmap calculated 4x4 window, before input flipping
+ * @param mask combined projection mask
+ * @param nb_win number of full windows stored in the slice
+ * @return 0 on success, negative AVERROR on failure
+ */
+static int store_pixel(const V360Context *s, SliceXYRemap *r, int p, int y, int x,
+                       float du, float dv, XYRemap *rmap, int mask, int *nb_win)
+{
+    const int offset = y * s->uv_linesize[p] + x;
+
+    input_flip(rmap->u, rmap->v, s->inplanewidth[p], s->inplaneheight[p], s->ih_flip, s->iv_flip);
+    av_assert1(!isnan(du) && !isnan(dv));
+    if (s->use_compact) {
+        int ret = compact_kernel(s, r, p, offset, du, dv, rmap, nb_win);
+        if (ret < 0)
+            return ret;
+    } else {
+        s->calculate_kernel(du, dv, rmap,
+                            r->u[p] + offset * s->elements,
+                            r->v[p] + offset * s->elements,
+                            r->ker[p] + offset * s->elements);
+    }
+
+    if (!p && r->mask) {
+        if (s->mask_size == 1) {
+            r->mask[y * s->pr_width[0] + x] = 255 * mask;
+        } else {
+            ((uint16_t *)r->mask)[y * s->pr_width[0] + x] = s->max_value * mask;
+        }
+    }
+
+    return 0;
+}
+
 // Calculate remap data
 static int v360_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     V360Context *s = ctx->priv;
     SliceXYRemap *r = &s->slice_remap[jobnr];
+    const float (*rot_quaternion)[4] = s->frame_rot ? s->frame_quaternion : s->rot_quaternion;
 
     for (int p = 0; p < s->nb_allocated; p++) {
-        const int max_value = s->max_value;
         const int width = s->pr_width[p];
-        const int uv_linesize = s->uv_linesize[p];
         const int height = s->pr_height[p];
-        const int in_width = s->inplanewidth[p];
-        const int in_height = s->inplaneheight[p];
         const int slice_start = (height *  jobnr     ) / nb_jobs;
         const int slice_end   = (height * (jobnr + 1)) / nb_jobs;
-        const int elements = s->elements;
+        int nb_win = 0;
         float du, dv;
         float vec[3];
         XYRemap rmap;
 
         for (int j = slice_start; j < slice_end; j++) {
+            if (s->use_compact)
+                r->win_offset[p][j - slice_start] = nb_win;
+
             for (int i = 0; i < width; i++) {
-                int16_t *u = r->u[p] + ((j - slice_start) * uv_linesize + i) * elements;
-                int16_t *v = r->v[p] + ((j - slice_start) * uv_linesize + i) * elements;
-                int16_t *ker = r->ker[p] + ((j - slice_start) * uv_linesize + i) * elements;
-                uint8_t *mask8 = p ? NULL : r->mask + ((j - slice_start) * s->pr_width[0] + i);
-                uint16_t *mask16 = p ? NULL : (uint16_t *)r->mask + ((j - slice_start) * s->pr_width[0] + i);
-                int in_mask, out_mask;
-
-                if (s->out_transpose)
-                    out_mask = s->out_transform(s, j, i, height, width, vec);
-                else
-                    out_mask = s->out_transform(s, i, j, width, height, vec);
-                offset_vector(vec, s->h_offset, s->v_offset);
-                normalize_vector(vec);
-                av_assert1(!isnan(vec[0]) && !isnan(vec[1]) && !isnan(vec[2]));
-                rotate(s->rot_quaternion, vec);
-                av_assert1(!isnan(vec[0]) && !isnan(vec[1]) && !isnan(vec[2]));
-                normalize_vector(vec);
-                mirror(s->output_mirror_modifier, vec);
-                if (s->in_transpose)
-                    in_mask = s->in_transform(s, vec, in_height, in_width, rmap.v, rmap.u, &du, &dv);
-                else
-                    in_mask = s->in_transform(s, vec, in_width, in_height, rmap.u, rmap.v, &du, &dv);
-                input_flip(rmap.u, rmap.v, in_width, in_height, s->ih_flip, s->iv_flip);
-                av_assert1(!isnan(du) && !isnan(dv));
-                s->calculate_kernel(du, dv, &rmap, u, v, ker);
-
-                if (!p && r->mask) {
-                    if (s->mask_size == 1) {
-                        mask8[0] = 255 * (out_mask & in_mask);
-                    } else {
-                        mask16[0] = max_value * (out_mask & in_mask);
+                int in_mask, out_mask, ret;
+
+                in_mask = transform_pixel(s, rot_quaternion, p, i, j, &rmap, &du, &dv, vec, &out_mask);
+                if (!p && r->out_mask)
+                    r->out_mask[(j - slice_start) * width + i] = out_mask;
+                ret = store_pixel(s, r, p, j - slice_start, i, du, dv, &rmap, out_mask & in_mask, &nb_win);
+                if (ret < 0)
+                    return ret;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Check whether the remap of a block can be interpolated from its corners
+ * and save the corner input coordinates.
+ *
+ * The input coordinates of the block center must match the interpolated
+ * ones, all points must map to a plain input rectangle on the same cube face
+ * direction, which rules out seams and face borders inside the block.
+ */
+static void check_block(const V360Context *s, const float rot_quaternion[2][4],
+                        int p, int x, int y, int w, int h, RemapBlock *b)
+{
+    const int px[5] = { x, x + w - 1, x,         x + w - 1, x + (w - 1) / 2 };
+    const int py[5] = { y, y,         y + h - 1, y + h - 1, y + (h - 1) / 2 };
+    const float fx = ((w - 1) / 2) / (float)(w - 1);
+    const float fy = ((h - 1) / 2) / (float)(h - 1);
+    int face = -1;
+
+    b->ok = w > 1 && h > 1;
+
+    for (int k = 0; k < 5 && b->ok; k++) {
+        const int16_t (*us)[4], (*vs)[4];
+        int out_mask, in_mask, axis;
+        float du, dv, tu, tv;
+        float vec[3];
+        XYRemap rmap;
+
+        in_mask = transform_pixel(s, rot_quaternion, p, px[k], py[k], &rmap, &du, &dv, vec, &out_mask);
+        us = s->in_transpose ? rmap.v : rmap.u;
+        vs = s->in_transpose ? rmap.u : rmap.v;
+
+        axis = fabsf(vec[0]) > fabsf(vec[1]) ? 0 : 1;
+        axis = fabsf(vec[2]) > fabsf(vec[axis]) ? 2 : axis;
+        axis = axis * 2 + (vec[axis] < 0.f);
+        if (!in_mask || (face >= 0 && axis != face)) {
+            b->ok = 0;
+            break;
+        }
+        face = axis;
+
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++)
+                b->ok &= us[i][j] == us[1][1] + j - 1 && vs[i][j] == vs[1][1] + i - 1;
+        }
+
+        tu = us[1][1] + du;
+        tv = vs[1][1] + dv;
+
+        if (k < 4) {
+            b->u[k] = tu;
+            b->v[k] = tv;
+        } else {
+            const float iu = (b->u[0] + (b->u[1] - b->u[0]) * fx) * (1.f - fy) +
+                             (b->u[2] + (b->u[3] - b->u[2]) * fx) * fy;
+            const float iv = (b->v[0] + (b->v[1] - b->v[0]) * fx) * (1.f - fy) +
+                             (b->v[2] + (b->v[3] - b->v[2]) * fx) * fy;
+
+            b->ok &= fabsf(iu - tu) <= GRID_TOLERANCE && fabsf(iv - tv) <= GRID_TOLERANCE;
+        }
+    }
+}
+
+/**
+ * Update remap data for a new rotation.
+ *
+ * Input coordinates are calculated exactly only for the corners and center
+ * of each GRID_SIZE x GRID_SIZE block and interpolated for the other pixels
+ * of blocks that pass check_block().
+ */
+static int rotate_slice(AVFilterContext *ctx, int jobnr, int nb_jobs)
+{
+    V360Context *s = ctx->priv;
+    SliceXYRemap *r = &s->slice_remap[jobnr];
+    const float (*rot_quaternion)[4] = s->frame_quaternion;
+
+    for (int p = 0; p < s->nb_allocated; p++) {
+        const int width = s->pr_width[p];
+        const int height = s->pr_height[p];
+        const int slice_start = (height *  jobnr     ) / nb_jobs;
+        const int slice_end   = (height * (jobnr + 1)) / nb_jobs;
+        const int tw = s->in_transpose ? s->inplaneheight[p] : s->inplanewidth[p];
+        const int th = s->in_transpose ? s->inplanewidth[p]  : s->inplaneheight[p];
+        int nb_win = 0;
+
+        for (int by = slice_start; by < slice_end; by += GRID_SIZE) {
+            const int bh = FFMIN(GRID_SIZE, slice_end - by);
+
+            for (int bx = 0; bx < width; bx += GRID_SIZE)
+                check_block(s, rot_quaternion, p, bx, by, FFMIN(GRID_SIZE, width - bx), bh,
+                            &r->blocks[bx / GRID_SIZE]);
+
+            for (int j = by; j < by + bh; j++) {
+                if (s->use_compact)
+                    r->win_offset[p][j - slice_start] = nb_win;
+
+                for (int i = 0; i < width; i++) {
+                    const RemapBlock *b = &r->blocks[i / GRID_SIZE];
+                    int in_mask = 0, out_mask = 0, ret;
+                    float du, dv;
+                    float vec[3];
+                    XYRemap rmap;
+
+                    if (b->ok) {
+                        const int bx = i - i % GRID_SIZE;
+                        const float fx = (i - bx) / (float)(FFMIN(GRID_SIZE, width - bx) - 1);
+                        const float fy = (j - by) / (float)(bh - 1);
+                        const float tu = (b->u[0] + (b->u[1] - b->u[0]) * fx) * (1.f - fy) +
+                                         (b->u[2] + (b->u[3] - b->u[2]) * fx) * fy;
+                        const float tv = (b->v[0] + (b->v[1] - b->v[0]) * fx) * (1.f - fy) +
+                                         (b->v[2] + (b->v[3] - b->v[2]) * fx) * fy;
+                        const int ui = floorf(tu);
+                        const int vi = floorf(tv);
+
+                        if (ui >= 1 && ui + 2 < tw && vi >= 1 && vi + 2 < th) {
+                            int16_t (*us)[4] = s->in_transpose ? rmap.v : rmap.u;
+                            int16_t (*vs)[4] = s->in_transpose ? rmap.u : rmap.v;
+
+                            for (int k = 0; k < 4; k++) {
+                                for (int l = 0; l < 4; l++) {
+                                    us[k][l] = ui + l - 1;
+                                    vs[k][l] = vi + k - 1;
+                                }
+                            }
+                            du = tu - ui;
+                            dv = tv - vi;
+                            in_mask = 1;
+                            out_mask = !p && r->out_mask ? r->out_mask[(j - slice_start) * width + i] : 1;
+                        }
                     }
+
+                    if (!in_mask)
+                        in_mask = transform_pixel(s, rot_quaternion, p, i, j, &rmap, &du, &dv, vec, &out_mask);
+
+                    ret = store_pixel(s, r, p, j - slice_start, i, du, dv, &rmap, out_mask & in_mask, &nb_win);
+                    if (ret < 0)
+                        return ret;
                 }
             }
         }
@@ -4288,6 +4753,66 @@ static int v360_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
     return 0;
 }
 
+// Update remap data for a new rotation and remap the frame slice with it
+static int rotate_remap_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    V360Context *s = ctx->priv;
+    int ret;
+
+    ret = rotate_slice(ctx, jobnr, nb_jobs);
+    if (ret < 0)
+        return ret;
+
+    return s->remap_slice(ctx, arg, jobnr, nb_jobs);
+}
+
+/**
+ * Run a slice function over all slices and collect the first error.
+ */
+static int execute_slices(AVFilterContext *ctx, avfilter_action_func *func, void *arg)
+{
+    V360Context *s = ctx->priv;
+    int *ret, err = 0;
+
+    if (!s->use_compact) {
+        ff_filter_execute(ctx, func, arg, NULL, s->nb_threads);
+        return 0;
+    }
+
+    ret = av_calloc(s->nb_threads, sizeof(*ret));
+    if (!ret)
+        return AVERROR(ENOMEM);
+
+    ff_filter_execute(ctx, func, arg, ret, s->nb_threads);
+
+    for (int n = 0; n < s->nb_threads; n++)
+        err = FFMIN(err, ret[n]);
+    av_free(ret);
+
+    return err;
+}
+
+/**
+ * Combine the filter rotation with the per-frame spherical orientation,
+ * or with the stabilizing correction for gyrostab.
+ */
+static void update_frame_rotation(V360Context *s)
+{
+    static const int order[3] = { YAW, PITCH, ROLL };
+
+    if (s->stabilize) {
+        multiply_quaternion(s->frame_quaternion[0], s->stab_correction, s->rot_quaternion[0]);
+        conjugate_quaternion(s->frame_quaternion[1], s->frame_quaternion[0]);
+        return;
+    }
+
+    memcpy(s->frame_quaternion, s->rot_quaternion, sizeof(s->frame_quaternion));
+    calculate_rotation(s->frame_ypr[0] / 65536.f,
+                       s->frame_ypr[1] / 65536.f,
+                       s->frame_ypr[2] / 65536.f,
+                       s->frame_quaternion, order);
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -4322,6 +4847,7 @@ static int config_output(AVFilterLink *outlink)
         break;
     case BILINEAR:
         s->calculate_kernel = bilinear_kernel;
+        s->calculate_coeffs = calculate_bilinear_coeffs;
         s->remap_slice = depth <= 8 ? remap2_8bit_slice : remap2_16bit_slice;
         s->elements = 2 * 2;
         sizeof_uv = sizeof(int16_t) * s->elements;
@@ -4329,6 +4855,7 @@ static int config_output(AVFilterLink *outlink)
         break;
     case LAGRANGE9:
         s->calculate_kernel = lagrange_kernel;
+        s->calculate_coeffs = calculate_lagrange_coeffs;
         s->remap_slice = depth <= 8 ? remap3_8bit_slice : remap3_16bit_slice;
         s->elements = 3 * 3;
         sizeof_uv = sizeof(int16_t) * s->elements;
@@ -4336,6 +4863,7 @@ static int config_output(AVFilterLink *outlink)
         break;
     case BICUBIC:
         s->calculate_kernel = bicubic_kernel;
+        s->calculate_coeffs = calculate_bicubic_coeffs;
         s->remap_slice = depth <= 8 ? remap4_8bit_slice : remap4_16bit_slice;
         s->elements = 4 * 4;
         sizeof_uv = sizeof(int16_t) * s->elements;
@@ -4343,6 +4871,7 @@ static int config_output(AVFilterLink *outlink)
         break;
     case LANCZOS:
         s->calculate_kernel = lanczos_kernel;
+        s->calculate_coeffs = calculate_lanczos_coeffs;
         s->remap_slice = depth <= 8 ? remap4_8bit_slice : remap4_16bit_slice;
         s->elements = 4 * 4;
         sizeof_uv = sizeof(int16_t) * s->elements;
@@ -4350,6 +4879,7 @@ static int config_output(AVFilterLink *outlink)
         break;
     case SPLINE16:
         s->calculate_kernel = spline16_kernel;
+        s->calculate_coeffs = calculate_spline16_coeffs;
         s->remap_slice = depth <= 8 ? remap4_8bit_slice : remap4_16bit_slice;
         s->elements = 4 * 4;
         sizeof_uv = sizeof(int16_t) * s->elements;
@@ -4357,6 +4887,7 @@ static int config_output(AVFilterLink *outlink)
         break;
     case GAUSSIAN:
         s->calculate_kernel = gaussian_kernel;
+        s->calculate_coeffs = calculate_gaussian_coeffs;
         s->remap_slice = depth <= 8 ? remap4_8bit_slice : remap4_16bit_slice;
         s->elements = 4 * 4;
         sizeof_uv = sizeof(int16_t) * s->elements;
@@ -4364,6 +4895,7 @@ static int config_output(AVFilterLink *outlink)
         break;
     case MITCHELL:
         s->calculate_kernel = mitchell_kernel;
+        s->calculate_coeffs = calculate_mitchell_coeffs;
         s->remap_slice = depth <= 8 ? remap4_8bit_slice : remap4_16bit_slice;
         s->elements = 4 * 4;
         sizeof_uv = sizeof(int16_t) * s->elements;
@@ -4373,6 +4905,21 @@ static int config_output(AVFilterLink *outlink)
         av_assert0(0);
     }
 
+    s->use_compact = s->compact && s->interp != NEAREST;
+    if (s->use_compact) {
+        static int (*const compact_slice[3][2])(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs) = {
+            { remap2_8bit_compact_slice, remap2_16bit_compact_slice },
+            { remap3_8bit_compact_slice, remap3_16bit_compact_slice },
+            { remap4_8bit_compact_slice, remap4_16bit_compact_slice },
+        };
+        const int ws = s->interp == BILINEAR ? 2 : s->interp == LAGRANGE9 ? 3 : 4;
+
+        s->remap_slice = compact_slice[ws - 2][depth > 8];
+        sizeof_uv = sizeof(int16_t);
+        sizeof_ker = 0;
+        init_frac_coeffs(s, ws);
+    }
+
     ff_v360_init(s, depth);
 
     for (int order = 0; order < NB_RORDERS; order++) {
@@ -4888,9 +5435,58 @@ static int config_output(AVFilterLink *outlink)
 
     set_mirror_modifier(s->h_flip, s->v_flip, s->d_flip, s->output_mirror_modifier);
 
-    ff_filter_execute(ctx, v360_slice, NULL, NULL, s->nb_threads);
+    update_frame_rotation(s);
+    s->rot_changed = 0;
 
-    return 0;
+    return execute_slices(ctx, v360_slice, NULL);
+}
+
+/**
+ * Low-pass the camera orientation and derive the rotation that maps the
+ * smoothed virtual camera onto the actual one.
+ */
+static void update_stabilization(AVFilterContext *ctx, const double *orientation, int64_t pts)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    V360Context *s = ctx->priv;
+    float q[4], inv[4], correction[4], norm = 0.f;
+
+    q[0] = orientation[0];
+    for (int i = 0; i < 3; i++)
+        q[1 + s->axis_map[i]] = s->axis_sign[i] * orientation[1 + i];
+
+    if (!s->have_stab) {
+        memcpy(s->stab_quaternion, q, sizeof(q));
+        s->have_stab = 1;
+    } else if (s->smooth > 0.f) {
+        float dt, a, dot = 0.f;
+
+        if (pts != AV_NOPTS_VALUE && s->stab_pts != AV_NOPTS_VALUE && pts > s->stab_pts)
+            dt = (pts - s->stab_pts) * av_q2d(inlink->time_base);
+        else if (inlink->frame_rate.num && inlink->frame_rate.den)
+            dt = av_q2d(av_inv_q(inlink->frame_rate));
+        else
+            dt = 1.f / 25.f;
+        a = 1.f - expf(-dt / s->smooth);
+
+        for (int i = 0; i < 4; i++)
+            dot += s->stab_quaternion[i] * q[i];
+        for (int i = 0; i < 4; i++) {
+            s->stab_quaternion[i] += a * ((dot < 0.f ? -q[i] : q[i]) - s->stab_quaternion[i]);
+            norm += s->stab_quaternion[i] * s->stab_quaternion[i];
+        }
+        norm = sqrtf(norm);
+        for (int i = 0; i < 4; i++)
+            s->stab_quaternion[i] /= norm;
+    }
+    s->stab_pts = pts;
+
+    conjugate_quaternion(inv, q);
+    multiply_quaternion(correction, inv, s->stab_quaternion);
+    if (memcmp(correction, s->stab_correction, sizeof(correction))) {
+        memcpy(s->stab_correction, correction, sizeof(correction));
+        s->rot_changed = 1;
+    }
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
@@ -4900,6 +5496,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     V360Context *s = ctx->priv;
     AVFrame *out;
     ThreadData td;
+    int ret = 0;
 
     out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out) {
@@ -4911,9 +5508,44 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     td.in = in;
     td.out = out;
 
-    ff_filter_execute(ctx, s->remap_slice, &td, NULL, s->nb_threads);
+    if (s->stabilize) {
+        AVFrameSideData *sd = av_frame_get_side_data(in, AV_FRAME_DATA_TELEMETRY);
+        const AVTelemetry *t = sd && sd->size >= sizeof(*t) ? (const AVTelemetry *)sd->data : NULL;
+
+        if (t && (t->flags & AV_TELEMETRY_ORIENTATION))
+            update_stabilization(ctx, t->orientation, in->pts);
+    } else if (s->frame_rot) {
+        AVFrameSideData *sd = av_frame_get_side_data(in, AV_FRAME_DATA_SPHERICAL);
+        int32_t ypr[3] = { 0 };
+
+        if (sd) {
+            const AVSphericalMapping *mapping = (const AVSphericalMapping *)sd->data;
+
+            ypr[0] = mapping->yaw;
+            ypr[1] = mapping->pitch;
+            ypr[2] = mapping->roll;
+            av_frame_remove_side_data(out, AV_FRAME_DATA_SPHERICAL);
+        }
+
+        if (memcmp(ypr, s->frame_ypr, sizeof(ypr))) {
+            memcpy(s->frame_ypr, ypr, sizeof(ypr));
+            s->rot_changed = 1;
+        }
+    }
+
+    if (s->rot_changed) {
+        update_frame_rotation(s);
+        s->rot_changed = 0;
+        ret = execute_slices(ctx, rotate_remap_slice, &td);
+    } else {
+        ff_filter_execute(ctx, s->remap_slice, &td, NULL, s->nb_threads);
+    }
 
     av_frame_free(&in);
+    if (ret < 0) {
+        av_frame_free(&out);
+        return ret;
+    }
     return ff_filter_frame(outlink, out);
 }
 
@@ -4941,6 +5573,15 @@ static int process_command(AVFilterContext *ctx, const char *cmd, const char *ar
     if (s->reset_rot)
         reset_rot(s);
 
+    if (s->frame_rot && s->slice_remap &&
+        (!strcmp(cmd, "yaw") || !strcmp(cmd, "pitch") ||
+         !strcmp(cmd, "roll") || !strcmp(cmd, "reset_rot"))) {
+        calculate_rotation(s->yaw, s->pitch, s->roll,
+                           s->rot_quaternion, s->rotation_order);
+        s->rot_changed = 1;
+        return 0;
+    }
+
     return config_output(ctx->outputs[0]);
 }
 
@@ -4964,9 +5605,14 @@ static av_cold void uninit(AVFilterContext *ctx)
             av_freep(&r->u[p]);
             av_freep(&r->v[p]);
             av_freep(&r->ker[p]);
+            av_freep(&r->frac[p]);
+            av_freep(&r->win[p]);
+            av_freep(&r->win_offset[p]);
         }
 
         av_freep(&r->mask);
+        av_freep(&r->out_mask);
+        av_freep(&r->blocks);
     }
 
     av_freep(&s->slice_remap);
@@ -5001,3 +5647,148 @@ const AVFilter ff_vf_v360 = {
     .flags         = AVFILTER_FLAG_SLICE_THREADS,
     .process_command = process_command,
 };
+
+#if CONFIG_GYROSTAB_FILTER
+
+static const AVOption gyrostab_options[] = {
+    {"projection", "set lens projection",               OFFSET(in), AV_OPT_TYPE_INT,    {.i64=FLAT},            0,    NB_PROJECTIONS-1, FLAGS, "proj" },
+    {      "flat", "regular video",                              0, AV_OPT_TYPE_CONST,  {.i64=FLAT},            0,                   0, FLAGS, "proj" },
+    {"rectilinear", "regular video",                             0, AV_OPT_TYPE_CONST,  {.i64=FLAT},            0,                   0, FLAGS, "proj" },
+    {   "fisheye", "fisheye",                                    0, AV_OPT_TYPE_CONST,  {.i64=FISHEYE},         0,                   0, FLAGS, "proj" },
+    { "equisolid", "equisolid",                                  0, AV_OPT_TYPE_CONST,  {.i64=EQUISOLID},       0,                   0, FLAGS, "proj" },
+    {        "sg", "stereographic",                              0, AV_OPT_TYPE_CONST,  {.i64=STEREOGRAPHIC},   0,                   0, FLAGS, "proj" },
+    {        "og", "orthographic",                               0, AV_OPT_TYPE_CONST,  {.i64=ORTHOGRAPHIC},    0,                   0, FLAGS, "proj" },
+    {"cylindrical", "cylindrical",                               0, AV_OPT_TYPE_CONST,  {.i64=CYLINDRICAL},     0,                   0, FLAGS, "proj" },
+    {         "e", "equirectangular",                            0, AV_OPT_TYPE_CONST,  {.i64=EQUIRECTANGULAR}, 0,                   0, FLAGS, "proj" },
+    {  "equirect", "equirectangular",                            0, AV_OPT_TYPE_CONST,  {.i64=EQUIRECTANGULAR}, 0,                   0, FLAGS, "proj" },
+    {  "dfisheye", "dual fisheye",                               0, AV_OPT_TYPE_CONST,  {.i64=DUAL_FISHEYE},    0,                   0, FLAGS, "proj" },
+    {    "interp", "set interpolation method",      OFFSET(interp), AV_OPT_TYPE_INT,    {.i64=BILINEAR},        0, NB_INTERP_METHODS-1, FLAGS, "interp" },
+    {      "near", "nearest neighbour",                          0, AV_OPT_TYPE_CONST,  {.i64=NEAREST},         0,                   0, FLAGS, "interp" },
+    {   "nearest", "nearest neighbour",                          0, AV_OPT_TYPE_CONST,  {.i64=NEAREST},         0,                   0, FLAGS, "interp" },
+    {      "line", "bilinear interpolation",                     0, AV_OPT_TYPE_CONST,  {.i64=BILINEAR},        0,                   0, FLAGS, "interp" },
+    {    "linear", "bilinear interpolation",                     0, AV_OPT_TYPE_CONST,  {.i64=BILINEAR},        0,                   0, FLAGS, "interp" },
+    { "lagrange9", "lagrange9 interpolation",                    0, AV_OPT_TYPE_CONST,  {.i64=LAGRANGE9},       0,                   0, FLAGS, "interp" },
+    {      "cube", "bicubic interpolation",                      0, AV_OPT_TYPE_CONST,  {.i64=BICUBIC},         0,                   0, FLAGS, "interp" },
+    {     "cubic", "bicubic interpolation",                      0, AV_OPT_TYPE_CONST,  {.i64=BICUBIC},         0,                   0, FLAGS, "interp" },
+    {      "lanc", "lanczos interpolation",                      0, AV_OPT_TYPE_CONST,  {.i64=LANCZOS},         0,                   0, FLAGS, "interp" },
+    {   "lanczos", "lanczos interpolation",                      0, AV_OPT_TYPE_CONST,  {.i64=LANCZOS},         0,                   0, FLAGS, "interp" },
+    {      "sp16", "spline16 interpolation",                     0, AV_OPT_TYPE_CONST,  {.i64=SPLINE16},        0,                   0, FLAGS, "interp" },
+    {  "spline16", "spline16 interpolation",                     0, AV_OPT_TYPE_CONST,  {.i64=SPLINE16},        0,                   0, FLAGS, "interp" },
+    {     "gauss", "gaussian interpolation",                     0, AV_OPT_TYPE_CONST,  {.i64=GAUSSIAN},        0,                   0, FLAGS, "interp" },
+    {  "gaussian", "gaussian interpolation",                     0, AV_OPT_TYPE_CONST,  {.i64=GAUSSIAN},        0,                   0, FLAGS, "interp" },
+    {  "mitchell", "mitchell interpolation",                     0, AV_OPT_TYPE_CONST,  {.i64=MITCHELL},        0,                   0, FLAGS, "interp" },
+    {     "h_fov", "lens horizontal field of view",  OFFSET(ih_fov), AV_OPT_TYPE_FLOAT, {.dbl=0.f},           0.f,               360.f, FLAGS, "h_fov"},
+    {     "v_fov", "lens vertical field of view",    OFFSET(iv_fov), AV_OPT_TYPE_FLOAT, {.dbl=0.f},           0.f,               360.f, FLAGS, "v_fov"},
+    {     "d_fov", "lens diagonal field of view",    OFFSET(id_fov), AV_OPT_TYPE_FLOAT, {.dbl=0.f},           0.f,               360.f, FLAGS, "d_fov"},
+    {      "zoom", "zoom factor hiding the borders",   OFFSET(zoom), AV_OPT_TYPE_FLOAT, {.dbl=1.1f},          1.f,                10.f, FLAGS, "zoom"},
+    {    "smooth", "orientation smoothing time",     OFFSET(smooth), AV_OPT_TYPE_FLOAT, {.dbl=0.5f},          0.f,                60.f, FLAGS, "smooth"},
+    {      "axes", "telemetry to image axes mapping",  OFFSET(axes), AV_OPT_TYPE_STRING,{.str="XYZ"},           0,                   0, FLAGS, "axes"},
+    {       "yaw", "yaw rotation",                     OFFSET(yaw), AV_OPT_TYPE_FLOAT,  {.dbl=0.f},        -180.f,               180.f,TFLAGS, "yaw"},
+    {     "pitch", "pitch rotation",                 OFFSET(pitch), AV_OPT_TYPE_FLOAT,  {.dbl=0.f},        -180.f,               180.f,TFLAGS, "pitch"},
+    {      "roll", "roll rotation",                   OFFSET(roll), AV_OPT_TYPE_FLOAT,  {.dbl=0.f},        -180.f,               180.f,TFLAGS, "roll"},
+    {    "rorder", "rotation order",                OFFSET(rorder), AV_OPT_TYPE_STRING, {.str="ypr"},           0,                   0,TFLAGS, "rorder"},
+    {   "compact", "use compact remap tables",     OFFSET(compact), AV_OPT_TYPE_BOOL,   {.i64=0},               0,                   1, FLAGS, "compact"},
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(gyrostab);
+
+static av_cold int gyrostab_init(AVFilterContext *ctx)
+{
+    V360Context *s = ctx->priv;
+    int used = 0, parity = 1;
+
+    if (strlen(s->axes) != 3) {
+        av_log(ctx, AV_LOG_ERROR, "axes must name exactly 3 axes.\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        const char c = s->axes[i];
+        const int axis = (c | 0x20) - 'x';
+
+        if (axis < 0 || axis > 2 || used & (1 << axis)) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid axes mapping '%s'.\n", s->axes);
+            return AVERROR(EINVAL);
+        }
+        used |= 1 << axis;
+        s->axis_map[i]  = axis;
+        s->axis_sign[i] = c & 0x20 ? -1.f : 1.f;
+        parity *= c & 0x20 ? -1 : 1;
+    }
+
+    /* the rotation axis is a pseudovector: a mirroring mapping flips it */
+    if (s->axis_map[0] > s->axis_map[1])
+        parity = -parity;
+    if (s->axis_map[0] > s->axis_map[2])
+        parity = -parity;
+    if (s->axis_map[1] > s->axis_map[2])
+        parity = -parity;
+    for (int i = 0; i < 3; i++)
+        s->axis_sign[i] *= parity;
+
+    s->stabilize = s->frame_rot = 1;
+    s->stab_correction[0] = 1.f;
+    s->stab_pts = AV_NOPTS_VALUE;
+
+    return init(ctx);
+}
+
+static int gyrostab_config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    V360Context *s = ctx->priv;
+    const float w = inlink->w, h = inlink->h;
+
+    s->out = s->in;
+    s->width  = inlink->w;
+    s->height = inlink->h;
+
+    if (s->in == EQUIRECTANGULAR || s->in == DUAL_FISHEYE)
+        return config_output(outlink);
+
+    if (s->id_fov > 0.f) {
+        fov_from_dfov(s->in, s->id_fov, w, h, &s->ih_fov, &s->iv_fov);
+    } else {
+        if (s->ih_fov == 0.f)
+            s->ih_fov = s->in == FLAT || s->in == CYLINDRICAL ? 90.f : 180.f;
+        if (s->iv_fov == 0.f)
+            s->iv_fov = s->in == FLAT ? atanf(tanf(s->ih_fov * M_PI / 360.f) * h / w) * 360.f / M_PI
+                                      : s->ih_fov * h / w;
+    }
+
+    if (s->in == FLAT) {
+        s->h_fov = atanf(tanf(s->ih_fov * M_PI / 360.f) / s->zoom) * 360.f / M_PI;
+        s->v_fov = atanf(tanf(s->iv_fov * M_PI / 360.f) / s->zoom) * 360.f / M_PI;
+    } else {
+        s->h_fov = s->ih_fov / s->zoom;
+        s->v_fov = s->iv_fov / s->zoom;
+    }
+
+    return config_output(outlink);
+}
+
+static const AVFilterPad gyrostab_outputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = gyrostab_config_output,
+    },
+};
+
+const AVFilter ff_vf_gyrostab = {
+    .name          = "gyrostab",
+    .description   = NULL_IF_CONFIG_SMALL("Stabilize video using gyroscope telemetry."),
+    .priv_size     = sizeof(V360Context),
+    .init          = gyrostab_init,
+    .uninit        = uninit,
+    FILTER_INPUTS(inputs),
+    FILTER_OUTPUTS(gyrostab_outputs),
+    FILTER_QUERY_FUNC(query_formats),
+    .priv_class    = &gyrostab_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+    .process_command = process_command,
+};
+
+#endif /* CONFIG_GYROSTAB_FILTER */
@@ -0,0 +1,363 @@
+/*
+ * GoPro Metadata Format (GPMF) telemetry parsing
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * GPMF is a KLV format: every entry starts with a four character key,
+ * a one byte value type, a one byte structure size and a 16 bit big-endian
+ * repeat count, followed by structure size * repeat bytes of big-endian data
+ * padded to 32 bits. Type 0 entries nest further KLV entries; device (DEVC)
+ * and stream (STRM) containers use it. Scaling (SCAL) and axis orientation
+ * (ORIN) entries apply to the data entries that follow them in the same
+ * stream.
+ */
+
+#include <math.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intfloat.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/log.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "gpmf.h"
+
+#define MAX_NESTING 8
+#define MAX_SCALE   8
+
+typedef struct GPMFStreamState {
+    double scale[MAX_SCALE];
+    int nb_scale;
+    char orin[MAX_SCALE];
+    int nb_orin;
+    int gps_fix;
+} GPMFStreamState;
+
+static int element_size(int type)
+{
+    switch (type) {
+    case 'b': case 'B': case 'c':
+        return 1;
+    case 's': case 'S':
+        return 2;
+    case 'l': case 'L': case 'f': case 'q':
+        return 4;
+    case 'd': case 'j': case 'J': case 'Q':
+        return 8;
+    }
+    return 0;
+}
+
+static double read_element(int type, const uint8_t *p)
+{
+    switch (type) {
+    case 'b': case 'c':
+        return (int8_t)p[0];
+    case 'B':
+        return p[0];
+    case 's':
+        return (int16_t)AV_RB16(p);
+    case 'S':
+        return AV_RB16(p);
+    case 'l':
+        return (int32_t)AV_RB32(p);
+    case 'L':
+        return AV_RB32(p);
+    case 'f':
+        return av_int2float(AV_RB32(p));
+    case 'd':
+        return av_int2double(AV_RB64(p));
+    case 'j':
+        return (int64_t)AV_RB64(p);
+    case 'J':
+        return AV_RB64(p);
+    case 'q':
+        return (int32_t)AV_RB32(p) / 65536.0;
+    case 'Q':
+        return (int64_t)AV_RB64(p) / 4294967296.0;
+    }
+    return 0;
+}
+
+static int add_samples(GPMFSeriesData *s, const GPMFStreamState *st,
+                       int type, const uint8_t *buf, int struct_size, int repeat,
+                       int nb_values, int remap, int64_t start, int64_t duration)
+{
+    const int es = element_size(type);
+    GPMFSample *samples;
+
+    if (!es || struct_size % es || struct_size / es < nb_values || !repeat)
+        return AVERROR_INVALIDDATA;
+    if (s->nb_samples + (size_t)repeat > INT_MAX / sizeof(*s->samples))
+        return AVERROR(ENOMEM);
+
+    samples = av_fast_realloc(s->samples, &s->allocated_size,
+                              (s->nb_samples + repeat) * sizeof(*s->samples));
+    if (!samples)
+        return AVERROR(ENOMEM);
+    s->samples = samples;
+    s->max_gap = FFMAX(s->max_gap, duration);
+
+    for (int i = 0; i < repeat; i++, buf += struct_size) {
+        GPMFSample *sample = &s->samples[s->nb_samples];
+        double v[5] = { 0 };
+
+        sample->time = start + av_rescale(duration, i, repeat);
+        if (s->nb_samples && sample->time < s->samples[s->nb_samples - 1].time)
+            continue;
+
+        for (int j = 0; j < nb_values; j++) {
+            double scale = st->nb_scale > j ? st->scale[j] :
+                           st->nb_scale     ? st->scale[0] : 1.0;
+            v[j] = read_element(type, buf + j * es) / (scale ? scale : 1.0);
+        }
+
+        memcpy(sample->v, v, sizeof(sample->v));
+        if (remap && st->nb_orin == 3) {
+            for (int j = 0; j < 3; j++) {
+                int axis = (st->orin[j] | 0x20) - 'x';
+                if (axis >= 0 && axis < 3)
+                    sample->v[axis] = st->orin[j] & 0x20 ? -v[j] : v[j];
+            }
+        }
+        s->nb_samples++;
+    }
+
+    return 0;
+}
+
+static int parse_klv(GPMFContext *g, const uint8_t *buf, const uint8_t *end,
+                     int64_t start, int64_t duration, int depth)
+{
+    GPMFStreamState st = { .gps_fix = -1 };
+    int ret;
+
+    if (depth > MAX_NESTING)
+        return AVERROR_INVALIDDATA;
+
+    while (end - buf >= 8) {
+        uint32_t key     = AV_RL32(buf);
+        int type         = buf[4];
+        int struct_size  = buf[5];
+        int repeat       = AV_RB16(buf + 6);
+        int len          = struct_size * repeat;
+        int es           = element_size(type);
+
+        buf += 8;
+        if (FFALIGN(len, 4) > end - buf)
+            return AVERROR_INVALIDDATA;
+
+        switch (type ? key : 0) {
+        case 0:
+            if (!type && len) {
+                ret = parse_klv(g, buf, buf + len, start, duration, depth + 1);
+                if (ret < 0)
+                    return ret;
+            }
+            break;
+        case MKTAG('S','C','A','L'):
+            if (!es)
+                break;
+            st.nb_scale = FFMIN(len / es, MAX_SCALE);
+            for (int i = 0; i < st.nb_scale; i++)
+                st.scale[i] = read_element(type, buf + i * es);
+            break;
+        case MKTAG('O','R','I','N'):
+            if (type != 'c')
+                break;
+            st.nb_orin = FFMIN(len, MAX_SCALE);
+            memcpy(st.orin, buf, st.nb_orin);
+            break;
+        case MKTAG('G','P','S','F'):
+            if (es && len >= es)
+                st.gps_fix = read_element(type, buf);
+            break;
+        case MKTAG('G','Y','R','O'):
+            ret = add_samples(&g->series[GPMF_GYRO], &st, type, buf, struct_size,
+                              repeat, 3, 1, start, duration);
+            if (ret == AVERROR(ENOMEM))
+                return ret;
+            break;
+        case MKTAG('A','C','C','L'):
+            ret = add_samples(&g->series[GPMF_ACCEL], &st, type, buf, struct_size,
+                              repeat, 3, 1, start, duration);
+            if (ret == AVERROR(ENOMEM))
+                return ret;
+            break;
+        case MKTAG('G','P','S','5'):
+            if (!st.gps_fix)
+                break;
+            ret = add_samples(&g->series[GPMF_GPS], &st, type, buf, struct_size,
+                              repeat, 5, 0, start, duration);
+            if (ret == AVERROR(ENOMEM))
+                return ret;
+            break;
+        }
+
+        buf += FFALIGN(len, 4);
+    }
+
+    return 0;
+}
+
+int ff_gpmf_parse(GPMFContext *g, void *logctx, const uint8_t *buf, int size,
+                  int64_t start, int64_t duration)
+{
+    int ret = parse_klv(g, buf, buf + size, start, FFMAX(duration, 0), 0);
+
+    if (ret == AVERROR_INVALIDDATA) {
+        av_log(logctx, AV_LOG_WARNING, "Invalid GPMF payload at %"PRId64"\n", start);
+        return 0;
+    }
+    return ret;
+}
+
+int ff_gpmf_finish(GPMFContext *g)
+{
+    const GPMFSeriesData *gyro = &g->series[GPMF_GYRO];
+    GPMFSeriesData *orient = &g->series[GPMF_ORIENTATION];
+    double q[4] = { 1.0, 0.0, 0.0, 0.0 };
+
+    av_freep(&orient->samples);
+    orient->nb_samples = orient->allocated_size = 0;
+    if (!gyro->nb_samples)
+        return 0;
+
+    orient->samples = av_malloc_array(gyro->nb_samples, sizeof(*orient->samples));
+    if (!orient->samples)
+        return AVERROR(ENOMEM);
+    orient->nb_samples = orient->allocated_size = gyro->nb_samples;
+    orient->max_gap    = gyro->max_gap;
+
+    for (unsigned i = 0; i < gyro->nb_samples; i++) {
+        GPMFSample *o = &orient->samples[i];
+
+        if (i) {
+            const GPMFSample *g0 = &gyro->samples[i - 1];
+            const GPMFSample *g1 = &gyro->samples[i];
+            const double dt = (g1->time - g0->time) / (double)AV_TIME_BASE;
+            double w[3], angle, s, c, dq[4], r[4], norm;
+
+            /* trapezoidal step, the rate is given in the body frame */
+            for (int j = 0; j < 3; j++)
+                w[j] = 0.5 * (g0->v[j] + g1->v[j]) * dt;
+            angle = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+            c = cos(0.5 * angle);
+            s = angle > 1e-12 ? sin(0.5 * angle) / angle : 0.5;
+            dq[0] = c;
+            dq[1] = w[0] * s;
+            dq[2] = w[1] * s;
+            dq[3] = w[2] * s;
+
+            r[0] = q[0] * dq[0] - q[1] * dq[1] - q[2] * dq[2] - q[3] * dq[3];
+            r[1] = q[0] * dq[1] + q[1] * dq[0] + q[2] * dq[3] - q[3] * dq[2];
+            r[2] = q[0] * dq[2] - q[1] * dq[3] + q[2] * dq[0] + q[3] * dq[1];
+            r[3] = q[0] * dq[3] + q[1] * dq[2] - q[2] * dq[1] + q[3] * dq[0];
+            norm = sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+            for (int j = 0; j < 4; j++)
+                q[j] = r[j] / norm;
+        }
+
+        o->time = gyro->samples[i].time;
+        memcpy(o->v, q, sizeof(q));
+        o->v[4] = 0.0;
+    }
+
+    return 0;
+}
+
+static int interpolate_series(const GPMFSeriesData *s, int64_t time,
+                              int nb_values, int quaternion, double *out)
+{
+    const GPMFSample *a, *b;
+    double f, sign = 1.0, norm = 0.0;
+    unsigned lo = 0, hi;
+
+    if (!s->nb_samples ||
+        time < s->samples[0].time - s->max_gap ||
+        time > s->samples[s->nb_samples - 1].time + s->max_gap)
+        return 0;
+
+    /* last sample not after time */
+    hi = s->nb_samples;
+    while (hi - lo > 1) {
+        unsigned mid = (lo + hi) >> 1;
+        if (s->samples[mid].time <= time)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    a = &s->samples[lo];
+    b = lo + 1 < s->nb_samples ? a + 1 : a;
+    if (time <= a->time || a->time == b->time) {
+        memcpy(out, a->v, nb_values * sizeof(*out));
+        return 1;
+    }
+    f = (time - a->time) / (double)(b->time - a->time);
+
+    if (quaternion) {
+        double dot = 0.0;
+        for (int j = 0; j < 4; j++)
+            dot += a->v[j] * b->v[j];
+        sign = dot < 0.0 ? -1.0 : 1.0;
+    }
+    for (int j = 0; j < nb_values; j++) {
+        out[j] = a->v[j] + f * (sign * b->v[j] - a->v[j]);
+        norm  += out[j] * out[j];
+    }
+    if (quaternion) {
+        norm = sqrt(norm);
+        for (int j = 0; j < nb_values; j++)
+            out[j] /= norm;
+    }
+
+    return 1;
+}
+
+int ff_gpmf_interpolate(const GPMFContext *g, int64_t time, AVTelemetry *t)
+{
+    double gps[5];
+
+    t->flags = 0;
+    if (interpolate_series(&g->series[GPMF_GYRO], time, 3, 0, t->gyro))
+        t->flags |= AV_TELEMETRY_GYRO;
+    if (interpolate_series(&g->series[GPMF_ACCEL], time, 3, 0, t->accel))
+        t->flags |= AV_TELEMETRY_ACCEL;
+    if (interpolate_series(&g->series[GPMF_ORIENTATION], time, 4, 1, t->orientation))
+        t->flags |= AV_TELEMETRY_ORIENTATION;
+    if (interpolate_series(&g->series[GPMF_GPS], time, 5, 0, gps)) {
+        t->latitude  = gps[0];
+        t->longitude = gps[1];
+        t->altitude  = gps[2];
+        t->speed_2d  = gps[3];
+        t->speed_3d  = gps[4];
+        t->flags |= AV_TELEMETRY_GPS;
+    }
+
+    return !!t->flags;
+}
+
+void ff_gpmf_free(GPMFContext *g)
+{
+    for (int i = 0; i < GPMF_NB_SERIES; i++)
+        av_freep(&g->series[i].samples);
+    memset(g, 0, sizeof(*g));
+}
@@ -0,0 +1,81 @@
+/*
+ * GoPro Metadata Format (GPMF) telemetry parsing
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_GPMF_H
+#define AVFORMAT_GPMF_H
+
+#include <stdint.h>
+
+#include "libavutil/telemetry.h"
+
+enum GPMFSeries {
+    GPMF_GYRO,
+    GPMF_ACCEL,
+    GPMF_GPS,
+    GPMF_ORIENTATION,
+    GPMF_NB_SERIES
+};
+
+typedef struct GPMFSample {
+    int64_t time;           ///< in AV_TIME_BASE units
+    double v[5];
+} GPMFSample;
+
+typedef struct GPMFSeriesData {
+    GPMFSample *samples;
+    unsigned int nb_samples;
+    unsigned int allocated_size;
+    int64_t max_gap;        ///< longest payload duration, limits extrapolation
+} GPMFSeriesData;
+
+typedef struct GPMFContext {
+    GPMFSeriesData series[GPMF_NB_SERIES];
+} GPMFContext;
+
+/**
+ * Parse one GPMF payload (the content of a 'gpmd' sample) and append its
+ * gyroscope, accelerometer and GPS readings to the context. The samples of
+ * each stream are spread evenly over the payload duration.
+ *
+ * @param start    payload start time in AV_TIME_BASE units
+ * @param duration payload duration in AV_TIME_BASE units
+ * @return 0 on success, a negative AVERROR on allocation failure; malformed
+ *         payloads are skipped with a warning
+ */
+int ff_gpmf_parse(GPMFContext *g, void *logctx, const uint8_t *buf, int size,
+                  int64_t start, int64_t duration);
+
+/**
+ * Derive the orientation series by integrating the gyroscope readings.
+ * Must be called once after all payloads have been parsed.
+ */
+int ff_gpmf_finish(GPMFContext *g);
+
+/**
+ * Interpolate the readings at the given time.
+ *
+ * @param time time in AV_TIME_BASE units
+ * @return 1 if t has been filled, 0 if no reading covers that time
+ */
+int ff_gpmf_interpolate(const GPMFContext *g, int64_t time, AVTelemetry *t);
+
+void ff_gpmf_free(GPMFContext *g);
+
+#endif /* AVFORMAT_GPMF_H */
@@ -35,6 +35,7 @@
 #include "avio.h"
 #include "internal.h"
 #include "dv.h"
+#include "gpmf.h"
 
 /* isom.c */
 extern const AVCodecTag ff_mp4_obj_type[];
@@ -289,6 +290,8 @@ typedef struct MOVContext {
     int64_t next_root_atom; ///< offset of the next root atom
     int export_all;
     int export_xmp;
+    int export_gpmf;
+    GPMFContext gpmf;       ///< telemetry read from the 'gpmd' track
     int *bitrates;          ///< bitrates read before streams creation
     int bitrates_count;
     int moov_retry;
@@ -8168,6 +8168,8 @@ static int mov_read_close(AVFormatContext *s)
     avformat_free_context(mov->dv_fctx);
     mov->dv_fctx = NULL;
 
+    ff_gpmf_free(&mov->gpmf);
+
     if (mov->meta_keys) {
         for (i = 1; i < mov->meta_keys_count; i++) {
             av_freep(&mov->meta_keys[i]);
@@ -8328,6 +8330,67 @@ fail:
     return ret;
 }
 
+static int mov_read_gpmf(AVFormatContext *s)
+{
+    MOVContext *mov = s->priv_data;
+    AVStream *st = NULL;
+    MOVStreamContext *sc;
+    FFStream *sti;
+    uint8_t *buf = NULL;
+    unsigned int buf_size = 0;
+    int64_t pos;
+    int i, ret = 0;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_DATA &&
+            s->streams[i]->codecpar->codec_tag == MKTAG('g','p','m','d')) {
+            st = s->streams[i];
+            break;
+        }
+    }
+    if (!st)
+        return 0;
+
+    sc  = st->priv_data;
+    sti = ffstream(st);
+    if (!sc->pb || !(sc->pb->seekable & AVIO_SEEKABLE_NORMAL)) {
+        av_log(s, AV_LOG_WARNING, "GPMF telemetry requires seekable input\n");
+        return 0;
+    }
+
+    pos = avio_tell(sc->pb);
+    for (i = 0; i < sti->nb_index_entries; i++) {
+        const AVIndexEntry *e = &sti->index_entries[i];
+        int64_t next = i + 1 < sti->nb_index_entries ?
+                       sti->index_entries[i + 1].timestamp : st->duration;
+        int64_t start    = av_rescale_q(e->timestamp, st->time_base, AV_TIME_BASE_Q);
+        int64_t duration = next > e->timestamp ?
+                           av_rescale_q(next - e->timestamp, st->time_base, AV_TIME_BASE_Q) : 0;
+
+        if (e->size <= 0)
+            continue;
+        av_fast_malloc(&buf, &buf_size, e->size);
+        if (!buf) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if (avio_seek(sc->pb, e->pos, SEEK_SET) != e->pos ||
+            avio_read(sc->pb, buf, e->size) != e->size) {
+            av_log(s, AV_LOG_WARNING, "Truncated GPMF track\n");
+            break;
+        }
+        ret = ff_gpmf_parse(&mov->gpmf, s, buf, e->size, start, duration);
+        if (ret < 0)
+            goto fail;
+    }
+
+    ret = ff_gpmf_finish(&mov->gpmf);
+fail:
+    av_free(buf);
+    avio_seek(sc->pb, pos, SEEK_SET);
+    return ret;
+}
+
 static int mov_read_header(AVFormatContext *s)
 {
     MOVContext *mov = s->priv_data;
@@ -8471,6 +8534,9 @@ static int mov_read_header(AVFormatContext *s)
 
     ff_rfps_calculate(s);
 
+    if (mov->export_gpmf && (err = mov_read_gpmf(s)) < 0)
+        return err;
+
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *st = s->streams[i];
         MOVStreamContext *sc = st->priv_data;
@@ -8787,6 +8853,27 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         }
     }
 
+    if (mov->export_gpmf && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+        (pkt->pts != AV_NOPTS_VALUE || pkt->dts != AV_NOPTS_VALUE)) {
+        int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+        size_t size;
+        AVTelemetry *telemetry = av_telemetry_alloc(&size);
+
+        if (!telemetry)
+            return AVERROR(ENOMEM);
+        if (ff_gpmf_interpolate(&mov->gpmf, av_rescale_q(ts, st->time_base, AV_TIME_BASE_Q),
+                                telemetry)) {
+            ret = av_packet_add_side_data(pkt, AV_PKT_DATA_TELEMETRY,
+                                          (uint8_t *)telemetry, size);
+            if (ret < 0) {
+                av_free(telemetry);
+                return ret;
+            }
+        } else {
+            av_free(telemetry);
+        }
+    }
+
     if (mov->aax_mode)
         aax_filter(pkt->data, pkt->size, mov);
 
@@ -9031,6 +9118,8 @@ static const AVOption mov_options[] = {
         AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, .flags = FLAGS },
     { "export_xmp", "Export full XMP metadata", OFFSET(export_xmp),
         AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, .flags = FLAGS },
+    { "export_gpmf", "Attach GoPro GPMF telemetry to video packets", OFFSET(export_gpmf),
+        AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, .flags = FLAGS },
     { "activation_bytes", "Secret bytes for Audible AAX files", OFFSET(activation_bytes),
         AV_OPT_TYPE_BINARY, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "audible_key", "AES-128 Key for Audible AAXC files", OFFSET(audible_key),
@@ -0,0 +1,158 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+#include "libavformat/gpmf.c"
+
+typedef struct Writer {
+    uint8_t buf[1024];
+    int size;
+} Writer;
+
+/* Write a KLV header, the values are written by the caller. */
+static void put_header(Writer *w, const char *key, int type, int struct_size, int repeat)
+{
+    memcpy(w->buf + w->size, key, 4);
+    w->buf[w->size + 4] = type;
+    w->buf[w->size + 5] = struct_size;
+    AV_WB16(w->buf + w->size + 6, repeat);
+    w->size += 8;
+}
+
+static void put_values(Writer *w, const char *key, int type,
+                       int nb_values, int repeat, const int32_t *values)
+{
+    const int es = element_size(type);
+
+    put_header(w, key, type, es * nb_values, repeat);
+    for (int i = 0; i < nb_values * repeat; i++) {
+        if (es == 2)
+            AV_WB16(w->buf + w->size, values[i]);
+        else
+            AV_WB32(w->buf + w->size, values[i]);
+        w->size += es;
+    }
+    w->size = FFALIGN(w->size, 4);
+}
+
+/* Nest everything written since start into a container with the given key. */
+static void put_container(Writer *w, const char *key, int start)
+{
+    int len = w->size - start;
+
+    memmove(w->buf + start + 8, w->buf + start, len);
+    w->size = start;
+    put_header(w, key, 0, 1, len);
+    w->size += len;
+}
+
+static void put_gyro_stream(Writer *w, int nb, const int32_t *values)
+{
+    static const int32_t scale[] = { 10 };
+    int start = w->size;
+
+    put_values(w, "SCAL", 's', 1, 1, scale);
+    put_header(w, "ORIN", 'c', 1, 3);
+    memcpy(w->buf + w->size, "ZXy\0", 4);
+    w->size += 4;
+    put_values(w, "GYRO", 's', 3, nb, values);
+    put_container(w, "STRM", start);
+}
+
+static void put_gps_stream(Writer *w, int fix, const int32_t *values)
+{
+    static const int32_t scale[] = { 10000000, 10000000, 1000, 1000, 100 };
+    int start = w->size;
+
+    put_values(w, "GPSF", 'L', 1, 1, &fix);
+    put_values(w, "SCAL", 'l', 5, 1, scale);
+    put_values(w, "GPS5", 'l', 5, 1, values);
+    put_container(w, "STRM", start);
+}
+
+static void print_telemetry(const GPMFContext *g, int64_t time)
+{
+    AVTelemetry t;
+
+    printf("%8"PRId64":", time);
+    if (!ff_gpmf_interpolate(g, time, &t)) {
+        printf(" none\n");
+        return;
+    }
+    if (t.flags & AV_TELEMETRY_GYRO)
+        printf(" gyro %.4f %.4f %.4f", t.gyro[0], t.gyro[1], t.gyro[2]);
+    if (t.flags & AV_TELEMETRY_ACCEL)
+        printf(" accel %.4f %.4f %.4f", t.accel[0], t.accel[1], t.accel[2]);
+    if (t.flags & AV_TELEMETRY_ORIENTATION)
+        printf(" orientation %.4f %.4f %.4f %.4f", t.orientation[0],
+               t.orientation[1], t.orientation[2], t.orientation[3]);
+    if (t.flags & AV_TELEMETRY_GPS)
+        printf(" gps %.4f %.4f %.2f %.2f %.2f", t.latitude, t.longitude,
+               t.altitude, t.speed_2d, t.speed_3d);
+    printf("\n");
+}
+
+int main(void)
+{
+    static const int32_t gyro0[] = { 10, 20, 30,  30, 40, 50 };
+    static const int32_t gyro1[] = { 50, 50, 50,  0, 0, 0 };
+    static const int32_t accel[] = { 0, 0, 981 };
+    static const int32_t gps0[]  = { 377749000, -1224194000, 15000, 2500, 300 };
+    static const int32_t gps1[]  = { 0, 0, 0, 0, 0 };
+    static const int64_t times[] = { -1500000, -500000, 0, 250000, 500000,
+                                     1250000, 1500000, 2000000, 3000000 };
+    GPMFContext g = { 0 };
+    Writer w = { 0 };
+    int start, ret;
+
+    /* first second: gyroscope, accelerometer and a GPS fix */
+    put_gyro_stream(&w, 2, gyro0);
+    start = w.size;
+    put_values(&w, "ACCL", 's', 3, 1, accel);
+    put_container(&w, "STRM", start);
+    put_gps_stream(&w, 3, gps0);
+    put_container(&w, "DEVC", 0);
+    ret = ff_gpmf_parse(&g, NULL, w.buf, w.size, 0, 1000000);
+    printf("payload 0: %d\n", ret);
+
+    /* second second: the GPS has no fix, its reading must be ignored */
+    w.size = 0;
+    put_gyro_stream(&w, 2, gyro1);
+    put_gps_stream(&w, 0, gps1);
+    put_container(&w, "DEVC", 0);
+    ret = ff_gpmf_parse(&g, NULL, w.buf, w.size, 1000000, 1000000);
+    printf("payload 1: %d\n", ret);
+
+    /* truncated payload, skipped as a whole */
+    ret = ff_gpmf_parse(&g, NULL, w.buf, w.size - 4, 2000000, 1000000);
+    printf("payload 2: %d\n", ret);
+
+    printf("samples: gyro %u accel %u gps %u\n", g.series[GPMF_GYRO].nb_samples,
+           g.series[GPMF_ACCEL].nb_samples, g.series[GPMF_GPS].nb_samples);
+
+    ret = ff_gpmf_finish(&g);
+    if (ret < 0)
+        return 1;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(times); i++)
+        print_telemetry(&g, times[i]);
+
+    ff_gpmf_free(&g);
+    return 0;
+}
@@ -272,6 +272,7 @@ AVBufferPool *av_buffer_pool_init2(size_t size, void *opaque,
     pool->alloc     = av_buffer_alloc; // fallback
     pool->pool_free = pool_free;
 
+    atomic_init(&pool->pool, 0);
     atomic_init(&pool->refcount, 1);
 
     return pool;
@@ -288,6 +289,7 @@ AVBufferPool *av_buffer_pool_init(size_t size, AVBufferRef* (*alloc)(size_t size
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
+    atomic_init(&pool->pool, 0);
     atomic_init(&pool->refcount, 1);
 
     return pool;
@@ -295,12 +297,15 @@ AVBufferPool *av_buffer_pool_init(size_t size, AVBufferRef* (*alloc)(size_t size
 
 static void buffer_pool_flush(AVBufferPool *pool)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    BufferPoolEntry *buf = (BufferPoolEntry *)atomic_exchange_explicit(&pool->pool, 0,
+                                                                       memory_order_acquire);
+
+    while (buf) {
+        BufferPoolEntry *next = buf->next;
 
         buf->free(buf->opaque, buf->data);
         av_freep(&buf);
+        buf = next;
     }
 }
 
@@ -336,6 +341,17 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
         buffer_pool_free(pool);
 }
 
+static void buffer_pool_push(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    uintptr_t head = atomic_load_explicit(&pool->pool, memory_order_relaxed);
+
+    do {
+        buf->next = (BufferPoolEntry *)head;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->pool, &head, (uintptr_t)buf,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
 static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
@@ -344,10 +360,7 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    buffer_pool_push(pool, buf);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -388,17 +401,27 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 {
     AVBufferRef *ret;
     BufferPoolEntry *buf;
+    uintptr_t head;
 
     ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
+    /* Only one thread pops at a time, so the head entry cannot be popped and
+     * pushed back under our feet between the load and the compare-and-swap. */
+    head = atomic_load_explicit(&pool->pool, memory_order_acquire);
+    while (head && !atomic_compare_exchange_weak_explicit(&pool->pool, &head,
+                                                          (uintptr_t)((BufferPoolEntry *)head)->next,
+                                                          memory_order_acquire,
+                                                          memory_order_acquire))
+        ;
+    buf = (BufferPoolEntry *)head;
     if (buf) {
         memset(&buf->buffer, 0, sizeof(buf->buffer));
         ret = buffer_create(&buf->buffer, buf->data, pool->size,
                             pool_release_buffer, buf, 0);
         if (ret) {
-            pool->pool = buf->next;
             buf->next = NULL;
             buf->buffer.flags_internal |= BUFFER_FLAG_NO_FREE;
+        } else {
+            buffer_pool_push(pool, buf);
         }
     } else {
         ret = pool_alloc_buffer(pool);
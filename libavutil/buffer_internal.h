@@ -86,8 +86,20 @@ typedef struct BufferPoolEntry {
 } BufferPoolEntry;
 
 struct AVBufferPool {
+    /*
+     * Serializes av_buffer_pool_get(), i.e. popping from the free stack and
+     * the calls to the alloc callbacks, which are not required to be
+     * thread-safe.
+     */
     AVMutex mutex;
-    BufferPoolEntry *pool;
+
+    /*
+     * Stack of the entries available for reuse, a BufferPoolEntry pointer.
+     * Returned buffers are pushed with a compare-and-swap and without taking
+     * the mutex. Popping is safe from the ABA problem as long as there is
+     * only one thread popping at a time.
+     */
+    atomic_uintptr_t pool;
 
     /*
      * This is used to track when the pool is to be freed.
@@ -209,6 +209,13 @@ enum AVFrameSideDataType {
      * volume transform - CUVA 005.1-2021.
      */
     AV_FRAME_DATA_DYNAMIC_HDR_VIVID,
+
+    /**
+     * Sensor telemetry (gyroscope, accelerometer, GPS) sampled at the
+     * presentation time of the frame. The payload is an AVTelemetry
+     * struct defined in libavutil/telemetry.h.
+     */
+    AV_FRAME_DATA_TELEMETRY,
 };
 
 enum AVActiveFormatDescription {
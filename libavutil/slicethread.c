@@ -22,6 +22,7 @@
 #include "slicethread.h"
 #include "mem.h"
 #include "thread.h"
+#include "threadpool_internal.h"
 #include "avassert.h"
 
 #if HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS
@@ -50,6 +51,8 @@ struct AVSliceThread {
     void            *priv;
     void            (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
     void            (*main_func)(void *priv);
+
+    AVBufferRef     *pool;
 };
 
 static int run_jobs(AVSliceThread *ctx)
@@ -163,11 +166,47 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return nb_threads;
 }
 
+int avpriv_slicethread_create_pool(AVSliceThread **pctx, void *priv,
+                                   void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                   void (*main_func)(void *priv),
+                                   int nb_threads, AVBufferRef *pool)
+{
+    AVSliceThread *ctx;
+
+    if (!pool || main_func)
+        return avpriv_slicethread_create(pctx, priv, worker_func, main_func, nb_threads);
+
+    av_assert0(nb_threads >= 0);
+    if (!nb_threads)
+        nb_threads = av_thread_pool_get_nb_threads(pool) + 1;
+
+    *pctx = ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+
+    ctx->pool = av_buffer_ref(pool);
+    if (!ctx->pool) {
+        av_freep(pctx);
+        return AVERROR(ENOMEM);
+    }
+    ctx->priv        = priv;
+    ctx->worker_func = worker_func;
+    ctx->nb_threads  = nb_threads;
+
+    return nb_threads;
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     int nb_workers, i, is_last = 0;
 
     av_assert0(nb_jobs > 0);
+    if (ctx->pool) {
+        ff_thread_pool_execute((AVThreadPool *)ctx->pool->data, ctx->priv,
+                               ctx->worker_func, nb_jobs, ctx->nb_threads);
+        return;
+    }
+
     ctx->nb_jobs           = nb_jobs;
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
@@ -207,6 +246,12 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+    if (ctx->pool) {
+        av_buffer_unref(&ctx->pool);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
@@ -244,6 +289,15 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return AVERROR(ENOSYS);
 }
 
+int avpriv_slicethread_create_pool(AVSliceThread **pctx, void *priv,
+                                   void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                   void (*main_func)(void *priv),
+                                   int nb_threads, AVBufferRef *pool)
+{
+    *pctx = NULL;
+    return AVERROR(ENOSYS);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     av_assert0(0);
@@ -19,6 +19,8 @@
 #ifndef AVUTIL_SLICETHREAD_H
 #define AVUTIL_SLICETHREAD_H
 
+#include "buffer.h"
+
 typedef struct AVSliceThread AVSliceThread;
 
 /**
@@ -35,6 +37,21 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*main_func)(void *priv),
                               int nb_threads);
 
+/**
+ * Create slice threading context running on a shared thread pool.
+ * Unlike with avpriv_slicethread_create(), no two jobs are guaranteed to run
+ * concurrently, so jobs must not wait for each other.
+ * @param pool thread pool created with av_thread_pool_create(); if NULL, or if
+ *             main_func is set, this is equivalent to avpriv_slicethread_create()
+ * @param nb_threads maximum number of threads running jobs at once,
+ *                   0 for the number of pool threads plus one
+ * @see avpriv_slicethread_create()
+ */
+int avpriv_slicethread_create_pool(AVSliceThread **pctx, void *priv,
+                                   void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                   void (*main_func)(void *priv),
+                                   int nb_threads, AVBufferRef *pool);
+
 /**
  * Execute slice threading.
  * @param ctx slice threading context
@@ -0,0 +1,119 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_video_telemetry
+ * Motion and position sensor telemetry
+ */
+
+#ifndef AVUTIL_TELEMETRY_H
+#define AVUTIL_TELEMETRY_H
+
+#include "frame.h"
+
+/**
+ * @defgroup lavu_video_telemetry Sensor telemetry
+ * @ingroup lavu_video
+ *
+ * Sensor readings recorded alongside a video, e.g. the GoPro GPMF track,
+ * resampled to the presentation time of a single frame.
+ *
+ * @{
+ */
+
+enum AVTelemetryFlags {
+    AV_TELEMETRY_GYRO        = 1 << 0, ///< AVTelemetry.gyro is set
+    AV_TELEMETRY_ACCEL       = 1 << 1, ///< AVTelemetry.accel is set
+    AV_TELEMETRY_ORIENTATION = 1 << 2, ///< AVTelemetry.orientation is set
+    AV_TELEMETRY_GPS         = 1 << 3, ///< the GPS fields of AVTelemetry are set
+};
+
+/**
+ * Sensor telemetry interpolated at the presentation time of a frame.
+ *
+ * Motion vectors are expressed in the camera frame of the source, i.e. after
+ * the sensor axes have been remapped with any orientation information the
+ * container carries.
+ *
+ * @note The struct must be allocated with av_telemetry_alloc() and
+ *       its size is not a part of the public ABI.
+ */
+typedef struct AVTelemetry {
+    /**
+     * A combination of AVTelemetryFlags telling which of the fields
+     * below carry valid data.
+     */
+    int flags;
+
+    /**
+     * Angular velocity around the X, Y and Z axes, in radians per second.
+     */
+    double gyro[3];
+
+    /**
+     * Acceleration along the X, Y and Z axes including gravity, in meters
+     * per second squared.
+     */
+    double accel[3];
+
+    /**
+     * Unit quaternion (w, x, y, z) rotating the camera frame at this time
+     * into the camera frame at the first gyroscope sample of the stream,
+     * obtained by integrating the angular velocity.
+     */
+    double orientation[4];
+
+    /**
+     * WGS 84 latitude and longitude in degrees, altitude in meters.
+     */
+    double latitude;
+    double longitude;
+    double altitude;
+
+    /**
+     * Ground speed and 3D speed, in meters per second.
+     */
+    double speed_2d;
+    double speed_3d;
+} AVTelemetry;
+
+/**
+ * Allocate an AVTelemetry structure and set its fields to
+ * default values. The resulting struct can be freed using av_freep().
+ * If size is not NULL it will be set to the number of bytes allocated.
+ *
+ * @return An AVTelemetry filled with default values or NULL
+ *         on failure.
+ */
+AVTelemetry *av_telemetry_alloc(size_t *size);
+
+/**
+ * Allocate a complete AVTelemetry and add it to the frame.
+ *
+ * @param frame The frame which side data is added to.
+ *
+ * @return The AVTelemetry structure to be filled by caller.
+ */
+AVTelemetry *av_telemetry_create_side_data(AVFrame *frame);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_TELEMETRY_H */
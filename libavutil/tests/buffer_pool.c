@@ -0,0 +1,140 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Stress av_buffer_pool_get() and buffer release from several threads,
+ * checking that no buffer is handed out twice. With -t, measure the time per
+ * get/release pair for an increasing number of threads.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_THREADS 16
+#define HELD        4
+#define BUF_SIZE    64
+
+typedef struct ThreadData {
+    AVBufferPool *pool;
+    int id;
+    int iterations;
+    int errors;
+} ThreadData;
+
+static atomic_int nb_allocs;
+
+static AVBufferRef *pool_alloc(void *opaque, size_t size)
+{
+    atomic_fetch_add(&nb_allocs, 1);
+    return av_buffer_alloc(size);
+}
+
+static void *thread_main(void *arg)
+{
+    ThreadData *td = arg;
+    AVBufferRef *held[HELD] = { NULL };
+
+    for (int i = 0; i < td->iterations; i++) {
+        AVBufferRef **buf = &held[i % HELD];
+
+        if (*buf) {
+            if ((*buf)->data[0] != td->id ||
+                (*buf)->data[BUF_SIZE - 1] != (uint8_t)i)
+                td->errors++;
+            av_buffer_unref(buf);
+        }
+
+        *buf = av_buffer_pool_get(td->pool);
+        if (!*buf) {
+            td->errors++;
+            break;
+        }
+        (*buf)->data[0]            = td->id;
+        (*buf)->data[BUF_SIZE - 1] = i + HELD;
+    }
+
+    for (int i = 0; i < HELD; i++)
+        av_buffer_unref(&held[i]);
+
+    return NULL;
+}
+
+static int run(int nb_threads, int iterations, int64_t *time)
+{
+    pthread_t threads[MAX_THREADS];
+    ThreadData td[MAX_THREADS];
+    AVBufferPool *pool;
+    int64_t start;
+    int errors = 0, ret;
+
+    atomic_store(&nb_allocs, 0);
+    pool = av_buffer_pool_init2(BUF_SIZE, NULL, pool_alloc, NULL);
+    if (!pool)
+        return -1;
+
+    start = av_gettime_relative();
+    for (int i = 0; i < nb_threads; i++) {
+        td[i] = (ThreadData){ .pool = pool, .id = i + 1, .iterations = iterations };
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &td[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return -1;
+        }
+    }
+    for (int i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+        errors += td[i].errors;
+    }
+    *time = av_gettime_relative() - start;
+
+    av_buffer_pool_uninit(&pool);
+
+    if (errors)
+        fprintf(stderr, "%d threads: %d buffers shared between threads\n",
+                nb_threads, errors);
+    if (atomic_load(&nb_allocs) > nb_threads * HELD) {
+        fprintf(stderr, "%d threads: %d buffers allocated\n",
+                nb_threads, atomic_load(&nb_allocs));
+        errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    int bench = argc > 1 && !strcmp(argv[1], "-t");
+    int iterations = bench ? 1000000 : 20000;
+    int errors = 0;
+    int64_t time;
+
+    for (int nb_threads = 1; nb_threads <= MAX_THREADS; nb_threads *= 2) {
+        int ret = run(nb_threads, iterations, &time);
+        if (ret < 0)
+            return 1;
+        errors += ret;
+        if (bench)
+            printf("%2d threads: %6.1f ns per get/release\n", nb_threads,
+                   time * 1000.0 / iterations);
+    }
+
+    return !!errors;
+}
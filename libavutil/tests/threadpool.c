@@ -0,0 +1,166 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Share one thread pool between slice threading contexts driven from several
+ * threads at once, the way a decoder, a filter graph and a scaler running in
+ * different ffmpeg threads share it. Every job must run exactly once per
+ * execute call, with a thread number below the context's thread count, and
+ * no more threads may run jobs at once than the pool has workers plus the
+ * number of calling threads. One of the contexts submits nested work to
+ * another one from inside its jobs.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/error.h"
+#include "libavutil/macros.h"
+#include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadpool.h"
+
+#define POOL_THREADS 3
+#define MAX_JOBS     64
+#define ITERATIONS   500
+
+typedef struct Client {
+    const char    *name;
+    AVSliceThread *thread;
+    int            nb_threads;
+    int            nb_jobs;
+    atomic_int     runs[MAX_JOBS];
+    atomic_int     errors;
+    /* context to submit to from inside every job, if any */
+    struct Client *nested;
+} Client;
+
+static atomic_int nb_running;
+static atomic_int max_running;
+
+static void worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    Client *c = priv;
+    int running = atomic_fetch_add(&nb_running, 1) + 1;
+    int max = atomic_load(&max_running);
+
+    while (running > max && !atomic_compare_exchange_weak(&max_running, &max, running))
+        ;
+
+    if (nb_jobs != c->nb_jobs || nb_threads > c->nb_threads ||
+        threadnr < 0 || threadnr >= nb_threads)
+        atomic_fetch_add(&c->errors, 1);
+    atomic_fetch_add(&c->runs[jobnr], 1);
+
+    atomic_fetch_sub(&nb_running, 1);
+
+    if (c->nested)
+        avpriv_slicethread_execute(c->nested->thread, c->nested->nb_jobs, 0);
+}
+
+static void *caller_main(void *arg)
+{
+    Client *c = arg;
+
+    for (int i = 0; i < ITERATIONS; i++)
+        avpriv_slicethread_execute(c->thread, c->nb_jobs, 0);
+
+    return NULL;
+}
+
+static int check_client(Client *c, int expected)
+{
+    int errors = atomic_load(&c->errors);
+
+    for (int i = 0; i < c->nb_jobs; i++) {
+        if (atomic_load(&c->runs[i]) != expected) {
+            fprintf(stderr, "%s: job %d ran %d times instead of %d\n", c->name,
+                    i, atomic_load(&c->runs[i]), expected);
+            errors++;
+        }
+    }
+    if (atomic_load(&c->errors))
+        fprintf(stderr, "%s: %d jobs with wrong arguments\n", c->name,
+                atomic_load(&c->errors));
+    return errors;
+}
+
+int main(void)
+{
+    Client clients[] = {
+        { .name = "decoder", .nb_threads = 4, .nb_jobs = 17 },
+        { .name = "filter",  .nb_threads = 2, .nb_jobs = 8 },
+        { .name = "scaler",  .nb_threads = 8, .nb_jobs = MAX_JOBS },
+        { .name = "nested",  .nb_threads = 3, .nb_jobs = 5 },
+    };
+    const int nb_callers = 3;
+    pthread_t threads[3];
+    AVBufferRef *pool;
+    int errors = 0, ret;
+
+    ret = av_thread_pool_create(&pool, POOL_THREADS);
+    if (ret < 0) {
+        fprintf(stderr, "av_thread_pool_create failed: %s\n", av_err2str(ret));
+        return 1;
+    }
+    if (av_thread_pool_get_nb_threads(pool) != POOL_THREADS) {
+        fprintf(stderr, "pool has %d threads\n", av_thread_pool_get_nb_threads(pool));
+        errors++;
+    }
+
+    /* the filter runs a nested context from inside each of its jobs */
+    clients[1].nested = &clients[3];
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(clients); i++) {
+        Client *c = &clients[i];
+
+        ret = avpriv_slicethread_create_pool(&c->thread, c, worker, NULL,
+                                             c->nb_threads, pool);
+        if (ret != c->nb_threads) {
+            fprintf(stderr, "%s: created with %d threads\n", c->name, ret);
+            return 1;
+        }
+    }
+    /* the contexts keep the pool alive */
+    av_buffer_unref(&pool);
+
+    for (int i = 0; i < nb_callers; i++) {
+        if ((ret = pthread_create(&threads[i], NULL, caller_main, &clients[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    }
+    for (int i = 0; i < nb_callers; i++)
+        pthread_join(threads[i], NULL);
+
+    for (int i = 0; i < nb_callers; i++)
+        errors += check_client(&clients[i], ITERATIONS);
+    errors += check_client(&clients[3], ITERATIONS * clients[1].nb_jobs);
+
+    if (atomic_load(&max_running) > POOL_THREADS + nb_callers) {
+        fprintf(stderr, "%d threads ran jobs at once\n", atomic_load(&max_running));
+        errors++;
+    }
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(clients); i++)
+        avpriv_slicethread_free(&clients[i].thread);
+
+    return !!errors;
+}
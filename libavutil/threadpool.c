@@ -0,0 +1,261 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdatomic.h>
+
+#include "avassert.h"
+#include "buffer.h"
+#include "cpu.h"
+#include "error.h"
+#include "internal.h"
+#include "mem.h"
+#include "thread.h"
+#include "threadpool.h"
+#include "threadpool_internal.h"
+
+#if HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS
+
+/**
+ * Work submitted by one ff_thread_pool_execute() call. It lives on the stack
+ * of the submitting thread, which does not return before every worker that
+ * joined it is done with it.
+ */
+typedef struct PoolBatch {
+    struct PoolBatch *next;
+    int               queued;
+
+    void              *priv;
+    void              (*func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
+    unsigned          nb_jobs;
+    int               nb_slots;
+    atomic_uint       next_job;
+
+    /* protected by the pool mutex */
+    int               slots_taken;
+    int               nb_running;
+} PoolBatch;
+
+struct AVThreadPool {
+    pthread_t       *threads;
+    int             nb_threads;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  work_cond;
+    pthread_cond_t  done_cond;
+    PoolBatch       *batches;
+    int             finished;
+};
+
+static void enqueue_batch(AVThreadPool *pool, PoolBatch *b)
+{
+    PoolBatch **p = &pool->batches;
+
+    while (*p)
+        p = &(*p)->next;
+    *p = b;
+    b->queued = 1;
+}
+
+static void dequeue_batch(AVThreadPool *pool, PoolBatch *b)
+{
+    PoolBatch **p = &pool->batches;
+
+    if (!b->queued)
+        return;
+    while (*p != b)
+        p = &(*p)->next;
+    *p = b->next;
+    b->queued = 0;
+}
+
+static void run_batch(PoolBatch *b, int slot)
+{
+    unsigned jobnr;
+
+    while ((jobnr = atomic_fetch_add_explicit(&b->next_job, 1, memory_order_acq_rel)) < b->nb_jobs)
+        b->func(b->priv, jobnr, slot, b->nb_jobs, b->nb_slots);
+}
+
+static void *attribute_align_arg pool_worker(void *v)
+{
+    AVThreadPool *pool = v;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->finished) {
+        PoolBatch *b = pool->batches;
+        int slot;
+
+        if (!b) {
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+            continue;
+        }
+
+        slot = b->slots_taken++;
+        if (b->slots_taken == b->nb_slots)
+            dequeue_batch(pool, b);
+        b->nb_running++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_batch(b, slot);
+
+        pthread_mutex_lock(&pool->mutex);
+        /* all jobs have been taken, no point in others joining */
+        dequeue_batch(pool, b);
+        if (!--b->nb_running)
+            pthread_cond_broadcast(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+void ff_thread_pool_execute(AVThreadPool *pool, void *priv,
+                            void (*func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                            int nb_jobs, int nb_threads)
+{
+    PoolBatch b = {
+        .priv        = priv,
+        .func        = func,
+        .nb_jobs     = nb_jobs,
+        .nb_slots    = FFMIN(nb_jobs, nb_threads),
+        .slots_taken = 1,
+        .nb_running  = 1,
+    };
+
+    av_assert0(nb_jobs > 0 && nb_threads > 0);
+    atomic_init(&b.next_job, 0);
+
+    if (b.nb_slots == 1) {
+        run_batch(&b, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    enqueue_batch(pool, &b);
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    run_batch(&b, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    dequeue_batch(pool, &b);
+    b.nb_running--;
+    while (b.nb_running)
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void pool_free(void *opaque, uint8_t *data)
+{
+    AVThreadPool *pool = (AVThreadPool *)data;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->finished = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->mutex);
+    av_freep(&pool->threads);
+    av_free(pool);
+}
+
+int av_thread_pool_create(AVBufferRef **ppool, int nb_threads)
+{
+    AVThreadPool *pool;
+    AVBufferRef *buf;
+    int ret;
+
+    *ppool = NULL;
+    if (nb_threads < 0)
+        return AVERROR(EINVAL);
+    if (!nb_threads)
+        nb_threads = av_cpu_count();
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return AVERROR(ENOMEM);
+    pool->threads = av_calloc(nb_threads, sizeof(*pool->threads));
+    if (!pool->threads) {
+        av_free(pool);
+        return AVERROR(ENOMEM);
+    }
+
+    if ((ret = pthread_mutex_init(&pool->mutex, NULL)))
+        goto fail;
+    if ((ret = pthread_cond_init(&pool->work_cond, NULL)))
+        goto fail_mutex;
+    if ((ret = pthread_cond_init(&pool->done_cond, NULL)))
+        goto fail_work_cond;
+
+    buf = av_buffer_create((uint8_t *)pool, sizeof(*pool), pool_free, NULL, 0);
+    if (!buf) {
+        pool_free(NULL, (uint8_t *)pool);
+        return AVERROR(ENOMEM);
+    }
+
+    for (; pool->nb_threads < nb_threads; pool->nb_threads++) {
+        ret = pthread_create(&pool->threads[pool->nb_threads], NULL, pool_worker, pool);
+        if (ret) {
+            av_buffer_unref(&buf);
+            return AVERROR(ret);
+        }
+    }
+
+    *ppool = buf;
+    return 0;
+
+fail_work_cond:
+    pthread_cond_destroy(&pool->work_cond);
+fail_mutex:
+    pthread_mutex_destroy(&pool->mutex);
+fail:
+    av_freep(&pool->threads);
+    av_free(pool);
+    return AVERROR(ret);
+}
+
+#else /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS */
+
+struct AVThreadPool {
+    int nb_threads;
+};
+
+void ff_thread_pool_execute(AVThreadPool *pool, void *priv,
+                            void (*func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                            int nb_jobs, int nb_threads)
+{
+    av_assert0(0);
+}
+
+int av_thread_pool_create(AVBufferRef **ppool, int nb_threads)
+{
+    *ppool = NULL;
+    return AVERROR(ENOSYS);
+}
+
+#endif /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS */
+
+int av_thread_pool_get_nb_threads(const AVBufferRef *pool)
+{
+    return ((const AVThreadPool *)pool->data)->nb_threads;
+}
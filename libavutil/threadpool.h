@@ -0,0 +1,75 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_thread_pool
+ * Shared worker thread pool
+ */
+
+#ifndef AVUTIL_THREADPOOL_H
+#define AVUTIL_THREADPOOL_H
+
+#include "buffer.h"
+
+/**
+ * @defgroup lavu_thread_pool Shared thread pool
+ * @ingroup lavu_data
+ *
+ * A set of worker threads which can be shared by any number of codec
+ * contexts, filter graphs and scaling contexts, in place of the threads each
+ * of them would otherwise create for slice threading.
+ *
+ * Every context keeps splitting its work into as many slices as its own
+ * thread count allows. The calling thread always processes slices of its own
+ * work, and idle pool workers pick up the remaining slices of whichever
+ * context submitted work, so the total number of threads is bounded by the
+ * pool size plus the number of calling threads.
+ *
+ * The pool is reference counted with AVBufferRef: the contexts it is
+ * attached to take their own references, and it is destroyed once the last
+ * one is released.
+ *
+ * @{
+ */
+
+/**
+ * Opaque shared thread pool, the data of the AVBufferRef returned by
+ * av_thread_pool_create().
+ */
+typedef struct AVThreadPool AVThreadPool;
+
+/**
+ * Create a shared thread pool.
+ *
+ * @param pool       a reference to the pool is returned here
+ * @param nb_threads number of worker threads, 0 for one per CPU core
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_thread_pool_create(AVBufferRef **pool, int nb_threads);
+
+/**
+ * @return the number of worker threads of the pool
+ */
+int av_thread_pool_get_nb_threads(const AVBufferRef *pool);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_THREADPOOL_H */
@@ -0,0 +1,37 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_THREADPOOL_INTERNAL_H
+#define AVUTIL_THREADPOOL_INTERNAL_H
+
+#include "threadpool.h"
+
+/**
+ * Run func for jobs 0 to nb_jobs - 1 on the calling thread and on up to
+ * nb_threads - 1 idle pool workers, and wait for all of them to be done.
+ * threadnr is unique among the threads running jobs of this call and lower
+ * than min(nb_jobs, nb_threads), which is passed as nb_threads.
+ *
+ * Jobs must not wait for each other, as there is no guarantee that any two of
+ * them run concurrently.
+ */
+void ff_thread_pool_execute(AVThreadPool *pool, void *priv,
+                            void (*func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                            int nb_jobs, int nb_threads);
+
+#endif /* AVUTIL_THREADPOOL_INTERNAL_H */
@@ -577,6 +577,7 @@ av_cold void swri_rematrix_free(SwrContext *s){
     av_freep(&s->native_one);
     av_freep(&s->native_simd_matrix);
     av_freep(&s->native_simd_one);
+    av_freep(&s->native_simd_matrix_n);
 }
 
 int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
@@ -589,7 +590,7 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
         return 0;
     }
 
-    if(s->mix_2_1_simd || s->mix_1_1_simd){
+    if(s->mix_2_1_simd || s->mix_1_1_simd || s->mix_n_1_simd){
         len1= len&~15;
         off = len1 * out->bps;
     }
@@ -627,8 +628,18 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
                 s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
             break;}
         default:
+            i = 0;
+            if(s->mix_n_1_simd && len1){
+                // one extra entry, the int16 kernels work on pairs of inputs
+                const uint8_t *ins[SWR_CH_MAX + 1];
+                for(j=0; j<s->matrix_ch[out_i][0]; j++)
+                    ins[j]= in->ch[s->matrix_ch[out_i][1+j]];
+                ins[j]= ins[0];
+                s->mix_n_1_simd(out->ch[out_i], ins, s->native_simd_matrix_n + 4*(in->ch_count+1)*out_i, s->matrix_ch[out_i][0], len1);
+                i = len1;
+            }
             if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
+                for(; i<len; i++){
                     float v=0;
                     for(j=0; j<s->matrix_ch[out_i][0]; j++){
                         in_i= s->matrix_ch[out_i][1+j];
@@ -637,7 +648,7 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
                     ((float*)out->ch[out_i])[i]= v;
                 }
             }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
+                for(; i<len; i++){
                     double v=0;
                     for(j=0; j<s->matrix_ch[out_i][0]; j++){
                         in_i= s->matrix_ch[out_i][1+j];
@@ -646,7 +657,7 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
                     ((double*)out->ch[out_i])[i]= v;
                 }
             }else{
-                for(i=0; i<len; i++){
+                for(; i<len; i++){
                     int v=0;
                     for(j=0; j<s->matrix_ch[out_i][0]; j++){
                         in_i= s->matrix_ch[out_i][1+j];
@@ -345,7 +345,8 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
         c->linear        = linear;
         c->factor        = factor;
         c->filter_length = filter_length;
-        c->filter_alloc  = FFALIGN(c->filter_length, 8);
+        // the SIMD kernels read whole vectors of up to 16 coefficients
+        c->filter_alloc  = FFALIGN(c->filter_length, SWR_RESAMPLE_TAP_ALIGN);
         c->filter_bank   = av_calloc(c->filter_alloc, (phase_count+1)*c->felem_size);
         c->filter_type   = filter_type;
         c->kaiser_beta   = kaiser_beta;
@@ -354,7 +355,9 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
             goto error;
         if (build_filter(c, (void*)c->filter_bank, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta))
             goto error;
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
+        /* only copy filter_length - 1 taps, the SIMD kernels also read the
+         * padding and must see zeros there as the C code ignores it */
+        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_length-1)*c->felem_size);
         memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
     }
 
@@ -403,7 +406,7 @@ static int rebuild_filter_bank_with_compensation(ResampleContext *c)
         av_freep(&new_filter_bank);
         return ret;
     }
-    memcpy(new_filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, new_filter_bank, (c->filter_alloc-1)*c->felem_size);
+    memcpy(new_filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, new_filter_bank, (c->filter_length-1)*c->felem_size);
     memcpy(new_filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, new_filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
 
     if (!av_reduce(&new_src_incr, &new_dst_incr, c->src_incr,
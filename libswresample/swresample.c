@@ -493,7 +493,8 @@ int swri_realloc_audio(AudioData *a, int count){
 
     count*=2;
 
-    countb= FFALIGN(count*a->bps, ALIGN);
+    /* leave room for what the SIMD resamplers read past the last sample */
+    countb= FFALIGN((count + SWR_RESAMPLE_TAP_ALIGN - 1)*a->bps, ALIGN);
     old= *a;
 
     av_assert0(a->bps);
@@ -573,7 +574,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
     AudioData in, out, tmp;
     int ret_sum=0;
     int border=0;
-    int padless = ARCH_X86 && s->engine == SWR_ENGINE_SWR ? 7 : 0;
+    int padless = ARCH_X86 && s->engine == SWR_ENGINE_SWR ? SWR_RESAMPLE_TAP_ALIGN - 1 : 0;
 
     av_assert1(s->in_buffer.ch_count == in_param->ch_count);
     av_assert1(s->in_buffer.planar   == in_param->planar);
@@ -31,6 +31,11 @@
 
 #define NS_TAPS 20
 
+/* The resample filter bank rows are padded with zero taps to a multiple of
+ * this, and the SIMD resample functions may read that many samples minus one
+ * past the input window they actually use. */
+#define SWR_RESAMPLE_TAP_ALIGN 16
+
 #if ARCH_X86_64
 typedef int64_t integer;
 #else
@@ -39,6 +44,7 @@ typedef int integer;
 
 typedef void (mix_1_1_func_type)(void *out, const void *in, void *coeffp, integer index, integer len);
 typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, void *coeffp, integer index1, integer index2, integer len);
+typedef void (mix_n_1_func_type)(void *out, const uint8_t **in, void *coeffp, integer nb_in, integer len);
 
 typedef void (mix_any_func_type)(uint8_t **out, const uint8_t **in1, void *coeffp, integer len);
 
@@ -178,6 +184,7 @@ struct SwrContext {
     uint8_t *native_one;
     uint8_t *native_simd_one;
     uint8_t *native_simd_matrix;
+    uint8_t *native_simd_matrix_n;                  ///< per output channel coefficients of the inputs listed in matrix_ch, for mix_n_1_simd
     int32_t matrix32[SWR_CH_MAX][SWR_CH_MAX];       ///< 17.15 fixed point rematrixing coefficients
     uint8_t matrix_ch[SWR_CH_MAX][SWR_CH_MAX+1];    ///< Lists of input channels per output channel that have non zero rematrixing coefficients
     mix_1_1_func_type *mix_1_1_f;
@@ -186,6 +193,8 @@ struct SwrContext {
     mix_2_1_func_type *mix_2_1_f;
     mix_2_1_func_type *mix_2_1_simd;
 
+    mix_n_1_func_type *mix_n_1_simd;
+
     mix_any_func_type *mix_any_f;
 
     /* TODO: callbacks for ASM optimizations */
@@ -222,6 +222,90 @@ mix_2_1_int16_u_int %+ SUFFIX:
 %endif
 %endmacro
 
+; void mix_n_1_float(float *out, const float **in, const float *coeffp,
+;                    integer nb_in, integer len)
+; Sums nb_in >= 2 inputs in the same order as the C code does, len is a
+; multiple of 2 * mmsize / 4.
+%macro MIXN_FLT 0
+cglobal mix_n_1_float, 5, 8, 6, out, in, coeffp, nb_in, len, off, i, src
+    shl        lenq, 2
+    lea         inq, [inq + nb_inq*gprsize]
+    lea     coeffpq, [coeffpq + nb_inq*4]
+    neg      nb_inq
+    xor        offd, offd
+.next:
+    mov          iq, nb_inq
+    mov        srcq, [inq + iq*gprsize]
+    VBROADCASTSS m2, [coeffpq + iq*4]
+    movu         m0, [srcq + offq         ]
+    movu         m1, [srcq + offq + mmsize]
+    mulps        m0, m0, m2
+    mulps        m1, m1, m2
+    inc          iq
+.next_in:
+    mov        srcq, [inq + iq*gprsize]
+    VBROADCASTSS m2, [coeffpq + iq*4]
+    movu         m3, [srcq + offq         ]
+    movu         m4, [srcq + offq + mmsize]
+    mulps        m3, m3, m2
+    mulps        m4, m4, m2
+    addps        m0, m0, m3
+    addps        m1, m1, m4
+    inc          iq
+        jl .next_in
+    movu  [outq + offq         ], m0
+    movu  [outq + offq + mmsize], m1
+    add        offq, mmsize*2
+    cmp        offq, lenq
+        jl .next
+    REP_RET
+%endmacro
+
+; void mix_n_1_int16(int16_t *out, const int16_t **in, const int32_t *coeffp,
+;                    integer nb_in, integer len)
+; coeffp holds the shift followed by the coefficients as int16 pairs, an odd
+; nb_in is rounded up and in[nb_in] must be readable. len is a multiple of
+; mmsize / 2.
+%macro MIXN_INT16 0
+cglobal mix_n_1_int16, 5, 9, 8, out, in, coeffp, nb_in, len, off, i, src1, src2
+    movd        xm4, [coeffpq]
+    mova         m7, [dw1]
+    pslld        m7, xm4
+    psrld        m7, 1
+    add      nb_inq, 1
+    and      nb_inq, ~1
+    add        lenq, lenq
+    lea         inq, [inq + nb_inq*gprsize]
+    lea     coeffpq, [coeffpq + nb_inq*2 + 4]
+    neg      nb_inq
+    xor        offd, offd
+.next:
+    mova         m0, m7
+    mova         m1, m7
+    mov          iq, nb_inq
+.next_in:
+    mov       src1q, [inq + iq*gprsize          ]
+    mov       src2q, [inq + iq*gprsize + gprsize]
+    VPBROADCASTD m5, [coeffpq + iq*2]
+    movu         m2, [src1q + offq]
+    movu         m6, [src2q + offq]
+    punpckhwd    m3, m2, m6
+    punpcklwd    m2, m6
+    pmaddwd      m2, m5
+    pmaddwd      m3, m5
+    paddd        m0, m2
+    paddd        m1, m3
+    add          iq, 2
+        jl .next_in
+    psrad        m0, xm4
+    psrad        m1, xm4
+    packssdw     m0, m1
+    movu  [outq + offq], m0
+    add        offq, mmsize
+    cmp        offq, lenq
+        jl .next
+    REP_RET
+%endmacro
 
 INIT_XMM sse
 MIX2_FLT u
@@ -242,3 +326,18 @@ MIX2_FLT a
 MIX1_FLT u
 MIX1_FLT a
 %endif
+
+%if ARCH_X86_64
+INIT_XMM sse
+MIXN_FLT
+INIT_XMM sse2
+MIXN_INT16
+%if HAVE_AVX_EXTERNAL
+INIT_YMM avx
+MIXN_FLT
+%endif
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+MIXN_INT16
+%endif
+%endif
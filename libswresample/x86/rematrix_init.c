@@ -30,6 +30,11 @@ D(float, sse)
 D(float, avx)
 D(int16, sse2)
 
+mix_n_1_func_type ff_mix_n_1_float_sse;
+mix_n_1_func_type ff_mix_n_1_float_avx;
+mix_n_1_func_type ff_mix_n_1_int16_sse2;
+mix_n_1_func_type ff_mix_n_1_int16_avx2;
+
 av_cold int swri_rematrix_init_x86(struct SwrContext *s){
 #if HAVE_X86ASM
     int mm_flags = av_get_cpu_flags();
@@ -40,6 +45,7 @@ av_cold int swri_rematrix_init_x86(struct SwrContext *s){
 
     s->mix_1_1_simd = NULL;
     s->mix_2_1_simd = NULL;
+    s->mix_n_1_simd = NULL;
 
     if (s->midbuf.fmt == AV_SAMPLE_FMT_S16P){
         if(EXTERNAL_SSE2(mm_flags)) {
@@ -64,6 +70,28 @@ av_cold int swri_rematrix_init_x86(struct SwrContext *s){
         }
         ((int16_t*)s->native_simd_one)[1] = 14;
         ((int16_t*)s->native_simd_one)[0] = 16384;
+
+        if (ARCH_X86_64 && EXTERNAL_SSE2(mm_flags))
+            s->mix_n_1_simd = ff_mix_n_1_int16_sse2;
+        if (ARCH_X86_64 && EXTERNAL_AVX2_FAST(mm_flags))
+            s->mix_n_1_simd = ff_mix_n_1_int16_avx2;
+        if (s->mix_n_1_simd) {
+            /* One row of nb_in + 1 dwords per output channel: the shift
+             * followed by the coefficients of the inputs listed in
+             * matrix_ch, as int16 pairs padded with 0 */
+            s->native_simd_matrix_n = av_calloc(nb_out, (nb_in + 1) * sizeof(int32_t));
+            if (!s->native_simd_matrix_n)
+                return AVERROR(ENOMEM);
+
+            for(i=0; i<nb_out; i++){
+                int32_t *row = (int32_t*)s->native_simd_matrix_n + i * (nb_in + 1);
+                for(j=0; j<s->matrix_ch[i][0]; j++){
+                    int in_i = s->matrix_ch[i][1+j];
+                    row[0] = ((int16_t*)s->native_simd_matrix)[2*(i * nb_in + in_i)+1];
+                    ((int16_t*)(row + 1))[j] = ((int16_t*)s->native_simd_matrix)[2*(i * nb_in + in_i)];
+                }
+            }
+        }
     } else if(s->midbuf.fmt == AV_SAMPLE_FMT_FLTP){
         if(EXTERNAL_SSE(mm_flags)) {
             s->mix_1_1_simd = ff_mix_1_1_a_float_sse;
@@ -79,6 +107,23 @@ av_cold int swri_rematrix_init_x86(struct SwrContext *s){
             return AVERROR(ENOMEM);
         memcpy(s->native_simd_matrix, s->native_matrix, num * sizeof(float));
         memcpy(s->native_simd_one, s->native_one, sizeof(float));
+
+        if (ARCH_X86_64 && EXTERNAL_SSE(mm_flags))
+            s->mix_n_1_simd = ff_mix_n_1_float_sse;
+        if (ARCH_X86_64 && EXTERNAL_AVX_FAST(mm_flags))
+            s->mix_n_1_simd = ff_mix_n_1_float_avx;
+        if (s->mix_n_1_simd) {
+            /* One row of nb_in + 1 floats per output channel: the
+             * coefficients of the inputs listed in matrix_ch */
+            s->native_simd_matrix_n = av_calloc(nb_out, (nb_in + 1) * sizeof(float));
+            if (!s->native_simd_matrix_n)
+                return AVERROR(ENOMEM);
+
+            for(i=0; i<nb_out; i++)
+                for(j=0; j<s->matrix_ch[i][0]; j++)
+                    ((float*)s->native_simd_matrix_n)[i * (nb_in + 1) + j] =
+                        ((float*)s->native_matrix)[i * nb_in + s->matrix_ch[i][1+j]];
+        }
     }
 #endif
 
@@ -251,7 +251,7 @@ int ff_init_filters(SwsContext * c)
     int index;
     int num_ydesc;
     int num_cdesc;
-    int num_vdesc = isPlanarYUV(c->dstFormat) && !isGray(c->dstFormat) ? 2 : 1;
+    int num_vdesc = isPlanarYUV(c->dstFormat) && !isGray(c->dstFormat) && !c->use_cmatrix ? 2 : 1;
     int need_lum_conv = c->lumToYV12 || c->readLumPlanar || c->alpToYV12 || c->readAlpPlanar;
     int need_chr_conv = c->chrToYV12 || c->readChrPlanar;
     int need_gamma = c->is_internal_gamma;
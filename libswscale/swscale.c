@@ -1240,5 +1240,7 @@ void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
                              parent->dst_slice_start + slice_start, slice_end - slice_start);
     }
 
-    parent->slice_err[threadnr] = err;
+    /* a thread may run several jobs, keep the first error */
+    if (err < 0 && !parent->slice_err[threadnr])
+        parent->slice_err[threadnr] = err;
 }
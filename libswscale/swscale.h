@@ -163,6 +163,19 @@ struct SwsContext *sws_alloc_context(void);
 av_warn_unused_result
 int sws_init_context(struct SwsContext *sws_context, SwsFilter *srcFilter, SwsFilter *dstFilter);
 
+/**
+ * Run the slice threads of the context on a shared thread pool created with
+ * av_thread_pool_create(), instead of on threads private to the context. The
+ * "threads" option then only limits how many pool threads work for this
+ * context at once.
+ *
+ * Must be called before sws_init_context(). The context takes its own
+ * reference to the pool.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_set_thread_pool(struct SwsContext *sws_context, AVBufferRef *pool);
+
 /**
  * Free the swscaler context swsContext.
  * If swsContext is NULL, then does nothing.
@@ -304,6 +304,7 @@ typedef struct SwsContext {
     struct SwsContext *parent;
 
     AVSliceThread      *slicethread;
+    AVBufferRef        *thread_pool;
     struct SwsContext **slice_ctx;
     int                *slice_err;
     int              nb_slice_ctx;
@@ -674,6 +675,10 @@ typedef struct SwsContext {
     unsigned int dst_slice_align;
     atomic_int   stride_unaligned_warned;
     atomic_int   data_unaligned_warned;
+
+    int use_cmatrix;            ///< YUV->YUV matrix is applied by the vertical scaler
+
+    AVBufferRef *filter_ref[4]; ///< Filter cache references for hLum, hChr, vLum and vChr filters, NULL if owned.
 } SwsContext;
 //FIXME check init (where 0)
 
@@ -1130,6 +1135,9 @@ int ff_init_desc_no_chr(SwsFilterDescriptor *desc, SwsSlice * src, SwsSlice *dst
 /// initializes vertical scaling descriptors
 int ff_init_vscale(SwsContext *c, SwsFilterDescriptor *desc, SwsSlice *src, SwsSlice *dst);
 
+/// returns whether the YUV->YUV matrix can be applied by the vertical scaler
+int ff_cmatrix_supported(SwsContext *c);
+
 /// setup vertical scaler functions
 void ff_init_vscale_pfn(SwsContext *c, yuv2planar1_fn yuv2plane1, yuv2planarX_fn yuv2planeX,
     yuv2interleavedX_fn yuv2nv12cX, yuv2packed1_fn yuv2packed1, yuv2packed2_fn yuv2packed2,
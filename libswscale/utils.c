@@ -763,6 +763,142 @@ done:
     return ret;
 }
 
+/* Process-wide cache of the filters made by initFilter(). The coefficients
+ * are never modified after init, so contexts with the same parameters share
+ * them instead of computing their own. */
+#define FILTER_CACHE_SIZE 32
+
+typedef struct FilterCacheKey {
+    int xInc, srcW, dstW;
+    int filterAlign, one;
+    int flags, cpu_flags;
+    int srcPos, dstPos;
+    int srcBpc, dstBpc;     ///< horizontal filters only, they may be shuffled for the SIMD scalers
+    double param[2];
+} FilterCacheKey;
+
+typedef struct CachedFilter {
+    int16_t *filter;
+    int32_t *filter_pos;
+    int filter_size;
+} CachedFilter;
+
+static struct {
+    FilterCacheKey key;
+    AVBufferRef *buf;
+} filter_cache[FILTER_CACHE_SIZE];
+static int filter_cache_next;
+static AVMutex filter_cache_mutex = AV_MUTEX_INITIALIZER;
+
+static void free_cached_filter(void *opaque, uint8_t *data)
+{
+    CachedFilter *f = (CachedFilter *)data;
+
+    av_free(f->filter);
+    av_free(f->filter_pos);
+    av_free(f);
+}
+
+static av_cold int init_cached_filter(SwsContext *c, AVBufferRef **ref,
+                                      int16_t **outFilter, int32_t **filterPos,
+                                      int *outFilterSize, int xInc, int srcW,
+                                      int dstW, int filterAlign, int one,
+                                      int flags, int cpu_flags,
+                                      SwsVector *srcFilter, SwsVector *dstFilter,
+                                      double param[2], int srcPos, int dstPos,
+                                      int is_horizontal)
+{
+    FilterCacheKey key;
+    CachedFilter *f;
+    AVBufferRef *buf;
+    int i, ret;
+
+    memset(&key, 0, sizeof(key));
+    key.xInc        = xInc;
+    key.srcW        = srcW;
+    key.dstW        = dstW;
+    key.filterAlign = filterAlign;
+    key.one         = one;
+    key.flags       = flags;
+    key.cpu_flags   = cpu_flags;
+    key.srcPos      = srcPos;
+    key.dstPos      = dstPos;
+    key.param[0]    = param[0];
+    key.param[1]    = param[1];
+    if (is_horizontal) {
+        key.srcBpc  = c->srcBpc;
+        key.dstBpc  = c->dstBpc;
+    }
+
+    // user supplied vectors are not part of the key
+    if (!srcFilter && !dstFilter) {
+        ff_mutex_lock(&filter_cache_mutex);
+        for (i = 0; i < FILTER_CACHE_SIZE; i++) {
+            if (filter_cache[i].buf && !memcmp(&filter_cache[i].key, &key, sizeof(key))) {
+                *ref = av_buffer_ref(filter_cache[i].buf);
+                break;
+            }
+        }
+        ff_mutex_unlock(&filter_cache_mutex);
+
+        if (*ref) {
+            f = (CachedFilter *)(*ref)->data;
+            *outFilter     = f->filter;
+            *filterPos     = f->filter_pos;
+            *outFilterSize = f->filter_size;
+            return 0;
+        }
+    }
+
+    if ((ret = initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                          filterAlign, one, flags, cpu_flags, srcFilter, dstFilter,
+                          param, srcPos, dstPos)) < 0)
+        return ret;
+    if (is_horizontal &&
+        ff_shuffle_filter_coefficients(c, *filterPos, *outFilterSize, *outFilter, dstW) < 0)
+        return AVERROR(ENOMEM);
+
+    if (srcFilter || dstFilter)
+        return 0;
+
+    // on failure the context keeps owning the filter
+    f = av_mallocz(sizeof(*f));
+    if (!f)
+        return 0;
+    buf = av_buffer_create((uint8_t *)f, sizeof(*f), free_cached_filter, NULL,
+                           AV_BUFFER_FLAG_READONLY);
+    if (!buf) {
+        av_free(f);
+        return 0;
+    }
+    f->filter      = *outFilter;
+    f->filter_pos  = *filterPos;
+    f->filter_size = *outFilterSize;
+    *ref = buf;
+
+    ff_mutex_lock(&filter_cache_mutex);
+    i = filter_cache_next;
+    filter_cache_next = (filter_cache_next + 1) % FILTER_CACHE_SIZE;
+    av_buffer_unref(&filter_cache[i].buf);
+    filter_cache[i].key = key;
+    filter_cache[i].buf = av_buffer_ref(buf);
+    ff_mutex_unlock(&filter_cache_mutex);
+
+    return 0;
+}
+
+static void free_filter(AVBufferRef **ref, int16_t **filter, int32_t **filter_pos)
+{
+    if (*ref) {
+        av_buffer_unref(ref);
+        *filter     = NULL;
+        *filter_pos = NULL;
+    } else {
+        av_freep(filter);
+        av_freep(filter_pos);
+    }
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -964,6 +1100,30 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
         return 0;
 
     if ((isYUV(c->dstFormat) || isGray(c->dstFormat)) && (isYUV(c->srcFormat) || isGray(c->srcFormat))) {
+        int use_cmatrix = c->desc && !c->convert_unscaled && !c->cascaded_context[0] &&
+                          memcmp(c->dstColorspaceTable, c->srcColorspaceTable, sizeof(int) * 4) &&
+                          ff_cmatrix_supported(c);
+
+        if (use_cmatrix || c->use_cmatrix) {
+            int ret;
+
+            c->use_cmatrix = use_cmatrix;
+            if (use_cmatrix) {
+                av_log(c, AV_LOG_VERBOSE, "YUV color matrix differs for YUV->YUV, converting in the vertical scaler\n");
+                // the range conversion is part of the matrix
+                c->lumConvertRange = NULL;
+                c->chrConvertRange = NULL;
+            } else {
+                ff_sws_init_range_convert(c);
+            }
+
+            ff_free_filters(c);
+            if ((ret = ff_init_filters(c)) < 0)
+                return ret;
+            if (use_cmatrix)
+                return 0;
+        }
+
         if (!c->cascaded_context[0] &&
             memcmp(c->dstColorspaceTable, c->srcColorspaceTable, sizeof(int) * 4) &&
             c->srcW && c->srcH && c->dstW && c->dstH) {
@@ -1240,8 +1400,9 @@ static int context_init_threaded(SwsContext *c,
 {
     int ret;
 
-    ret = avpriv_slicethread_create(&c->slicethread, (void*)c,
-                                    ff_sws_slice_worker, NULL, c->nb_threads);
+    ret = avpriv_slicethread_create_pool(&c->slicethread, (void*)c,
+                                         ff_sws_slice_worker, NULL, c->nb_threads,
+                                         c->thread_pool);
     if (ret == AVERROR(ENOSYS)) {
         c->nb_threads = 1;
         return 0;
@@ -1289,6 +1450,16 @@ static int context_init_threaded(SwsContext *c,
     return 0;
 }
 
+int sws_set_thread_pool(SwsContext *c, AVBufferRef *pool)
+{
+    av_buffer_unref(&c->thread_pool);
+    if (!pool)
+        return 0;
+
+    c->thread_pool = av_buffer_ref(pool);
+    return c->thread_pool ? 0 : AVERROR(ENOMEM);
+}
+
 av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                              SwsFilter *dstFilter)
 {
@@ -1823,28 +1994,26 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                     PPC_ALTIVEC(cpu_flags) ? 8 :
                                     have_neon(cpu_flags)   ? 4 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if ((ret = init_cached_filter(c, &c->filter_ref[0],
+                           &c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                            cpu_flags, srcFilter->lumH, dstFilter->lumH,
                            c->param,
                            get_local_pos(c, 0, 0, 0),
-                           get_local_pos(c, 0, 0, 0))) < 0)
+                           get_local_pos(c, 0, 0, 0), 1)) < 0)
                 goto fail;
-            if (ff_shuffle_filter_coefficients(c, c->hLumFilterPos, c->hLumFilterSize, c->hLumFilter, dstW) < 0)
-                goto nomem;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if ((ret = init_cached_filter(c, &c->filter_ref[1],
+                           &c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
                            cpu_flags, srcFilter->chrH, dstFilter->chrH,
                            c->param,
                            get_local_pos(c, c->chrSrcHSubSample, c->src_h_chr_pos, 0),
-                           get_local_pos(c, c->chrDstHSubSample, c->dst_h_chr_pos, 0))) < 0)
+                           get_local_pos(c, c->chrDstHSubSample, c->dst_h_chr_pos, 0), 1)) < 0)
                 goto fail;
-            if (ff_shuffle_filter_coefficients(c, c->hChrFilterPos, c->hChrFilterSize, c->hChrFilter, c->chrDstW) < 0)
-                goto nomem;
         }
     } // initialize horizontal stuff
 
@@ -1854,22 +2023,24 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                 PPC_ALTIVEC(cpu_flags) ? 8 :
                                 have_neon(cpu_flags)   ? 2 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if ((ret = init_cached_filter(c, &c->filter_ref[2],
+                       &c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
                        c->param,
                        get_local_pos(c, 0, 0, 1),
-                       get_local_pos(c, 0, 0, 1))) < 0)
+                       get_local_pos(c, 0, 0, 1), 0)) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if ((ret = init_cached_filter(c, &c->filter_ref[3],
+                       &c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
                        cpu_flags, srcFilter->chrV, dstFilter->chrV,
                        c->param,
                        get_local_pos(c, c->chrSrcVSubSample, c->src_v_chr_pos, 1),
-                       get_local_pos(c, c->chrDstVSubSample, c->dst_v_chr_pos, 1))) < 0)
+                       get_local_pos(c, c->chrDstVSubSample, c->dst_v_chr_pos, 1), 0)) < 0)
 
             goto fail;
 
@@ -2390,6 +2561,7 @@ void sws_freeContext(SwsContext *c)
     av_freep(&c->slice_err);
 
     avpriv_slicethread_free(&c->slicethread);
+    av_buffer_unref(&c->thread_pool);
 
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
@@ -2399,20 +2571,15 @@ void sws_freeContext(SwsContext *c)
 
     av_freep(&c->src_ranges.ranges);
 
-    av_freep(&c->vLumFilter);
-    av_freep(&c->vChrFilter);
-    av_freep(&c->hLumFilter);
-    av_freep(&c->hChrFilter);
+    free_filter(&c->filter_ref[0], &c->hLumFilter, &c->hLumFilterPos);
+    free_filter(&c->filter_ref[1], &c->hChrFilter, &c->hChrFilterPos);
+    free_filter(&c->filter_ref[2], &c->vLumFilter, &c->vLumFilterPos);
+    free_filter(&c->filter_ref[3], &c->vChrFilter, &c->vChrFilterPos);
 #if HAVE_ALTIVEC
     av_freep(&c->vYCoeffsBank);
     av_freep(&c->vCCoeffsBank);
 #endif
 
-    av_freep(&c->vLumFilterPos);
-    av_freep(&c->vChrFilterPos);
-    av_freep(&c->hLumFilterPos);
-    av_freep(&c->hChrFilterPos);
-
 #if HAVE_MMX_INLINE
 #if USE_MMAP
     if (c->lumMmxextFilterCode)
@@ -17,6 +17,8 @@
  * License along with FFmpeg; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include <math.h>
+
 #include "swscale_internal.h"
 
 typedef struct VScalerContext
@@ -36,6 +38,22 @@ typedef struct VScalerContext
     yuv2packedX_fn yuv2packedX;
 } VScalerContext;
 
+/**
+ * Vertical scaler with a YUV to YUV matrix applied to its output, before
+ * the conversion to the destination depth. The lines stay in the
+ * intermediate format, so scaling, matrix and depth conversion are done in
+ * a single pass.
+ */
+typedef struct CMatrixContext
+{
+    VScalerContext vscale[2];   ///< luma/alpha and chroma scalers, must be first
+    int coeffs[3][3];           ///< matrix applied to (Y, U, V), 14 fractional bits
+    int in_offset[2];           ///< luma and chroma input offsets
+    int64_t bias[3];            ///< output offsets, with rounding
+    int32_t *line[4];           ///< vertically scaled Y, U, V, A lines
+    uint8_t *out[3];            ///< matrix output in the intermediate format
+} CMatrixContext;
+
 
 static int lum_planar_vscale(SwsContext *c, SwsFilterDescriptor *desc, int sliceY, int sliceH)
 {
@@ -210,12 +228,222 @@ static int any_vscale(SwsContext *c, SwsFilterDescriptor *desc, int sliceY, int
 
 }
 
+static void cmatrix_vfilter(const int16_t *filter, int filter_size, uint8_t **src,
+                            int32_t *dst, int dstW, int is19)
+{
+    int i, j;
+
+    if (is19) {
+        for (i = 0; i < dstW; i++) {
+            int64_t val = 1 << 11;
+            for (j = 0; j < filter_size; j++)
+                val += (int64_t)((const int32_t *)src[j])[i] * filter[j];
+            dst[i] = val >> 12;
+        }
+    } else {
+        for (i = 0; i < dstW; i++) {
+            int val = 1 << 11;
+            for (j = 0; j < filter_size; j++)
+                val += ((const int16_t *)src[j])[i] * filter[j];
+            dst[i] = val >> 12;
+        }
+    }
+}
+
+static void cmatrix_store(uint8_t *dst, int64_t val, int i, int is19)
+{
+    if (is19)
+        ((int32_t *)dst)[i] = av_clip64(val, 0, (1 << 19) - 1);
+    else
+        ((int16_t *)dst)[i] = av_clip_int16(val);
+}
+
+/* Luma uses the chroma sample covering its position. The luma weights of
+ * two YCbCr matrices both sum to 1, so the chroma outputs only depend on
+ * the chroma inputs and y is NULL for them. */
+static void cmatrix_line(const CMatrixContext *inst, int plane, uint8_t *dst,
+                         const int32_t *y, const int32_t *u, const int32_t *v,
+                         int hsub, int dstW, int is19)
+{
+    const int *m = inst->coeffs[plane];
+    int i;
+
+    for (i = 0; i < dstW; i++) {
+        int64_t val = inst->bias[plane] +
+                      (int64_t)m[1] * (u[i >> hsub] - inst->in_offset[1]) +
+                      (int64_t)m[2] * (v[i >> hsub] - inst->in_offset[1]);
+        if (y)
+            val += (int64_t)m[0] * (y[i] - inst->in_offset[0]);
+        cmatrix_store(dst, val >> 14, i, is19);
+    }
+}
+
+static int cmatrix_vscale(SwsContext *c, SwsFilterDescriptor *desc, int sliceY, int sliceH)
+{
+    CMatrixContext *inst = desc->instance;
+    VScalerContext *lum = &inst->vscale[0];
+    VScalerContext *chr = &inst->vscale[1];
+    const int is19 = c->dstBpc > 14;
+    const int hsub = desc->dst->h_chr_sub_sample;
+    const int dstW = desc->dst->width;
+    const int chrDstW = AV_CEIL_RSHIFT(dstW, hsub);
+    const int chrSliceY = sliceY >> desc->dst->v_chr_sub_sample;
+
+    int first = FFMAX(1-lum->filter_size, lum->filter_pos[sliceY]);
+    int sp = first - desc->src->plane[0].sliceY;
+    int dp = sliceY - desc->dst->plane[0].sliceY;
+    uint8_t **src = desc->src->plane[0].line + sp;
+    uint8_t **dst = desc->dst->plane[0].line + dp;
+    const int16_t *filter = (const int16_t *)lum->filter[0] + sliceY * lum->filter_size;
+
+    // chroma is scaled once per chroma line and kept for the luma lines it covers
+    if (!(sliceY & ((1 << desc->dst->v_chr_sub_sample) - 1))) {
+        int first = FFMAX(1-chr->filter_size, chr->filter_pos[chrSliceY]);
+        int sp1 = first - desc->src->plane[1].sliceY;
+        int sp2 = first - desc->src->plane[2].sliceY;
+        int dp1 = chrSliceY - desc->dst->plane[1].sliceY;
+        int dp2 = chrSliceY - desc->dst->plane[2].sliceY;
+        uint8_t **src1 = desc->src->plane[1].line + sp1;
+        uint8_t **src2 = desc->src->plane[2].line + sp2;
+        uint8_t **dst1 = desc->dst->plane[1].line + dp1;
+        uint8_t **dst2 = desc->dst->plane[2].line + dp2;
+        const int16_t *filter = (const int16_t *)chr->filter[0] + chrSliceY * chr->filter_size;
+
+        cmatrix_vfilter(filter, chr->filter_size, src1, inst->line[1], chrDstW, is19);
+        cmatrix_vfilter(filter, chr->filter_size, src2, inst->line[2], chrDstW, is19);
+        cmatrix_line(inst, 1, inst->out[1], NULL, inst->line[1], inst->line[2], 0, chrDstW, is19);
+        cmatrix_line(inst, 2, inst->out[2], NULL, inst->line[1], inst->line[2], 0, chrDstW, is19);
+
+        if (c->yuv2nv12cX) {
+            static const int16_t unity = 4096;
+            const int16_t *u = (const int16_t *)inst->out[1];
+            const int16_t *v = (const int16_t *)inst->out[2];
+            chr->pfn.yuv2interleavedX(c->dstFormat, c->chrDither8, &unity, 1, &u, &v, dst1[0], chrDstW);
+        } else {
+            chr->pfn.yuv2planar1((const int16_t *)inst->out[1], dst1[0], chrDstW, c->chrDither8, 0);
+            chr->pfn.yuv2planar1((const int16_t *)inst->out[2], dst2[0], chrDstW, c->chrDither8, 3);
+        }
+    }
+
+    cmatrix_vfilter(filter, lum->filter_size, src, inst->line[0], dstW, is19);
+    cmatrix_line(inst, 0, inst->out[0], inst->line[0], inst->line[1], inst->line[2], hsub, dstW, is19);
+    lum->pfn.yuv2planar1((const int16_t *)inst->out[0], dst[0], dstW, c->lumDither8, 0);
+
+    if (desc->alpha) {
+        int sp = first - desc->src->plane[3].sliceY;
+        int dp = sliceY - desc->dst->plane[3].sliceY;
+        uint8_t **src = desc->src->plane[3].line + sp;
+        uint8_t **dst = desc->dst->plane[3].line + dp;
+        const int16_t *filter = (const int16_t *)lum->filter[1] + sliceY * lum->filter_size;
+        int i;
+
+        cmatrix_vfilter(filter, lum->filter_size, src, inst->line[3], dstW, is19);
+        for (i = 0; i < dstW; i++)
+            cmatrix_store(inst->out[0], inst->line[3][i], i, is19);
+        lum->pfn.yuv2planar1((const int16_t *)inst->out[0], dst[0], dstW, c->lumDither8, 0);
+    }
+
+    return 1;
+}
+
+/* Kr and Kb of a YCbCr matrix from its sws_getCoefficients() table */
+static void cmatrix_get_weights(const int table[4], double *kr, double *kb)
+{
+    *kr = 1 - table[0] * 224.0 / (2 * 255 * 65536);
+    *kb = 1 - table[1] * 224.0 / (2 * 255 * 65536);
+}
+
+int ff_cmatrix_supported(SwsContext *c)
+{
+    double kr[2], kb[2];
+    int i;
+
+    if (!isYUV(c->srcFormat) || isGray(c->srcFormat) ||
+        !isPlanarYUV(c->dstFormat) || isGray(c->dstFormat) || c->dstBpc > 16)
+        return 0;
+
+    cmatrix_get_weights(c->srcColorspaceTable, &kr[0], &kb[0]);
+    cmatrix_get_weights(c->dstColorspaceTable, &kr[1], &kb[1]);
+    for (i = 0; i < 2; i++)
+        if (!(kr[i] > 0 && kb[i] > 0 && kr[i] + kb[i] < 1))
+            return 0;
+    return 1;
+}
+
+static void cmatrix_init_coeffs(SwsContext *c, CMatrixContext *inst)
+{
+    const int sh = c->dstBpc > 14 ? 11 : 7; // intermediate units per 8-bit level
+    const double in_scale[3] = {
+        c->contrast / 65536.0 / (c->srcRange ? 255 : 219),
+        c->contrast / 65536.0 * c->saturation / 65536.0 / (c->srcRange ? 255 : 224),
+        c->contrast / 65536.0 * c->saturation / 65536.0 / (c->srcRange ? 255 : 224),
+    };
+    const double out_scale[3] = {
+        c->dstRange ? 255 : 219,
+        c->dstRange ? 255 : 224,
+        c->dstRange ? 255 : 224,
+    };
+    const int out_offset[3] = { c->dstRange ? 0 : 16, 128, 128 };
+    double kr, kb, kg;
+    double to_rgb[3][3], to_yuv[3][3];
+    int i, j, k;
+
+    cmatrix_get_weights(c->srcColorspaceTable, &kr, &kb);
+    kg = 1 - kr - kb;
+    to_rgb[0][0] = 1; to_rgb[0][1] = 0;                      to_rgb[0][2] = 2 * (1 - kr);
+    to_rgb[1][0] = 1; to_rgb[1][1] = -2 * kb * (1 - kb) / kg; to_rgb[1][2] = -2 * kr * (1 - kr) / kg;
+    to_rgb[2][0] = 1; to_rgb[2][1] = 2 * (1 - kb);           to_rgb[2][2] = 0;
+
+    cmatrix_get_weights(c->dstColorspaceTable, &kr, &kb);
+    kg = 1 - kr - kb;
+    to_yuv[0][0] = kr;                    to_yuv[0][1] = kg;                    to_yuv[0][2] = kb;
+    to_yuv[1][0] = -kr / (2 * (1 - kb));  to_yuv[1][1] = -kg / (2 * (1 - kb));  to_yuv[1][2] = 0.5;
+    to_yuv[2][0] = 0.5;                   to_yuv[2][1] = -kg / (2 * (1 - kr));  to_yuv[2][2] = -kb / (2 * (1 - kr));
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            double m = 0;
+            for (k = 0; k < 3; k++)
+                m += to_yuv[i][k] * to_rgb[k][j];
+            inst->coeffs[i][j] = lrint(out_scale[i] * m * in_scale[j] * (1 << 14));
+        }
+        inst->bias[i] = ((int64_t)out_offset[i] << (sh + 14)) + (1 << 13);
+    }
+
+    // brightness is in 1/256 of an 8-bit level, as in ff_yuv2rgb_c_init_tables()
+    inst->in_offset[0] = lrint(((c->srcRange ? 0 : 16) - c->brightness / 256.0) * (1 << sh));
+    inst->in_offset[1] = 128 << sh;
+}
+
 int ff_init_vscale(SwsContext *c, SwsFilterDescriptor *desc, SwsSlice *src, SwsSlice *dst)
 {
     VScalerContext *lumCtx = NULL;
     VScalerContext *chrCtx = NULL;
 
-    if (isPlanarYUV(c->dstFormat) || (isGray(c->dstFormat) && !isALPHA(c->dstFormat))) {
+    if (c->use_cmatrix) {
+        // SIMD output functions may read past dstW
+        const int line_size = FFALIGN(c->dstW * sizeof(int32_t), 64) + 64;
+        const int ctx_size  = FFALIGN(sizeof(CMatrixContext), 64);
+        CMatrixContext *inst = av_mallocz(ctx_size + 7 * line_size);
+        uint8_t *ptr;
+        int i;
+
+        if (!inst)
+            return AVERROR(ENOMEM);
+
+        ptr = (uint8_t *)inst + ctx_size;
+        for (i = 0; i < 4; i++, ptr += line_size)
+            inst->line[i] = (int32_t *)ptr;
+        for (i = 0; i < 3; i++, ptr += line_size)
+            inst->out[i] = ptr;
+        cmatrix_init_coeffs(c, inst);
+
+        desc[0].process = cmatrix_vscale;
+        desc[0].instance = inst;
+        desc[0].src = src;
+        desc[0].dst = dst;
+        desc[0].alpha = c->needAlpha;
+    } else if (isPlanarYUV(c->dstFormat) || (isGray(c->dstFormat) && !isALPHA(c->dstFormat))) {
         lumCtx = av_mallocz(sizeof(VScalerContext));
         if (!lumCtx)
             return AVERROR(ENOMEM);
@@ -267,7 +495,23 @@ void ff_init_vscale_pfn(SwsContext *c,
     VScalerContext *chrCtx = NULL;
     int idx = c->numDesc - (c->is_internal_gamma ? 2 : 1); //FIXME avoid hardcoding indexes
 
-    if (isPlanarYUV(c->dstFormat) || (isGray(c->dstFormat) && !isALPHA(c->dstFormat))) {
+    if (c->use_cmatrix) {
+        // the matrix stage does its own vertical filtering and only outputs single lines
+        lumCtx = c->desc[idx].instance;
+        chrCtx = &lumCtx[1];
+
+        lumCtx->filter[0] = c->vLumFilter;
+        lumCtx->filter[1] = c->vLumFilter;
+        lumCtx->filter_size = c->vLumFilterSize;
+        lumCtx->filter_pos = c->vLumFilterPos;
+        lumCtx->pfn.yuv2planar1 = yuv2plane1;
+
+        chrCtx->filter[0] = c->vChrFilter;
+        chrCtx->filter_size = c->vChrFilterSize;
+        chrCtx->filter_pos = c->vChrFilterPos;
+        if (yuv2nv12cX) chrCtx->pfn.yuv2interleavedX = yuv2nv12cX;
+        else            chrCtx->pfn.yuv2planar1 = yuv2plane1;
+    } else if (isPlanarYUV(c->dstFormat) || (isGray(c->dstFormat) && !isALPHA(c->dstFormat))) {
         if (!isGray(c->dstFormat)) {
             chrCtx = c->desc[idx].instance;
 
@@ -0,0 +1,217 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * CineForm RAW demosaic test.
+ * The CineForm encoder cannot write Bayer streams, so encode a four plane
+ * gbrap12 frame and relabel it as Bayer: its four planes then decode as the
+ * four components of a mosaic twice as wide and high. Decode it with and
+ * without the demosaic option and compare the gbrp16 output with a bilinear
+ * demosaic of the bayer_rggb16 output, with mirrored frame edges.
+ */
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/dict.h"
+#include "libavutil/frame.h"
+#include "libavutil/intreadwrite.h"
+
+#define WIDTH  64
+#define HEIGHT 32
+
+/* CineForm tag of the encoded sample format, 2 is Bayer, 4 is RGBA */
+#define TAG_ENCODED_FORMAT 84
+
+static AVPacket *encode_frame(void)
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_CFHD);
+    AVCodecContext *ctx = NULL;
+    AVFrame *frame = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    int ret;
+
+    if (!codec || !pkt)
+        goto fail;
+    ctx   = avcodec_alloc_context3(codec);
+    frame = av_frame_alloc();
+    if (!ctx || !frame)
+        goto fail;
+
+    ctx->width     = WIDTH;
+    ctx->height    = HEIGHT;
+    ctx->pix_fmt   = AV_PIX_FMT_GBRAP12;
+    ctx->time_base = (AVRational){ 1, 25 };
+    if ((ret = avcodec_open2(ctx, codec, NULL)) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Can't open encoder\n");
+        goto fail;
+    }
+
+    frame->format = ctx->pix_fmt;
+    frame->width  = ctx->width;
+    frame->height = ctx->height;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        goto fail;
+    for (int p = 0; p < 4; p++) {
+        for (int y = 0; y < HEIGHT; y++) {
+            uint16_t *line = (uint16_t *)(frame->data[p] + y * frame->linesize[p]);
+            for (int x = 0; x < WIDTH; x++)
+                line[x] = 400 * p + 20 * x + 30 * y + (x * y % 7) * 16;
+        }
+    }
+
+    if (avcodec_send_frame(ctx, frame) < 0 ||
+        avcodec_send_frame(ctx, NULL) < 0 ||
+        avcodec_receive_packet(ctx, pkt) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Can't encode the frame\n");
+        goto fail;
+    }
+
+    for (int i = 0; i + 4 <= pkt->size; i += 4) {
+        if (AV_RB16(pkt->data + i) == TAG_ENCODED_FORMAT && AV_RB16(pkt->data + i + 2) == 4) {
+            AV_WB16(pkt->data + i + 2, 2);
+            avcodec_free_context(&ctx);
+            av_frame_free(&frame);
+            return pkt;
+        }
+    }
+    av_log(NULL, AV_LOG_ERROR, "No encoded format tag in the packet\n");
+
+fail:
+    avcodec_free_context(&ctx);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    return NULL;
+}
+
+static AVFrame *decode_frame(const AVPacket *pkt, int demosaic, int threads)
+{
+    const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_CFHD);
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    AVDictionary *opts = NULL;
+    int ret;
+
+    if (!ctx || !frame)
+        goto fail;
+
+    ctx->thread_count = threads;
+    ctx->thread_type  = FF_THREAD_SLICE;
+    av_dict_set_int(&opts, "demosaic", demosaic, 0);
+    ret = avcodec_open2(ctx, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Can't open decoder\n");
+        goto fail;
+    }
+
+    if (avcodec_send_packet(ctx, pkt) < 0 ||
+        avcodec_send_packet(ctx, NULL) < 0 ||
+        avcodec_receive_frame(ctx, frame) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Can't decode with demosaic=%d threads=%d\n",
+               demosaic, threads);
+        goto fail;
+    }
+    if (frame->format != (demosaic ? AV_PIX_FMT_GBRP16 : AV_PIX_FMT_BAYER_RGGB16)) {
+        av_log(NULL, AV_LOG_ERROR, "Wrong output format %d with demosaic=%d\n",
+               frame->format, demosaic);
+        goto fail;
+    }
+
+    avcodec_free_context(&ctx);
+    return frame;
+
+fail:
+    avcodec_free_context(&ctx);
+    av_frame_free(&frame);
+    return NULL;
+}
+
+/* mosaic sample at x, y, mirrored at the frame edges */
+static int bayer(const AVFrame *f, int x, int y)
+{
+    x = x < 0 ? -x : x >= f->width  ? 2 * f->width  - 2 - x : x;
+    y = y < 0 ? -y : y >= f->height ? 2 * f->height - 2 - y : y;
+    return AV_RN16(f->data[0] + y * f->linesize[0] + 2 * x);
+}
+
+static int check_demosaic(const AVFrame *ref, const AVFrame *rgb)
+{
+    if (rgb->width != ref->width || rgb->height != ref->height) {
+        av_log(NULL, AV_LOG_ERROR, "Size %dx%d, expected %dx%d\n",
+               rgb->width, rgb->height, ref->width, ref->height);
+        return 1;
+    }
+
+    for (int y = 0; y < ref->height; y++) {
+        for (int x = 0; x < ref->width; x++) {
+#define B(dx, dy) bayer(ref, x + (dx), y + (dy))
+            int cross = (B(0, -1) + B(-1, 0) + B(1, 0) + B(0, 1)) >> 2;
+            int diag  = (B(-1, -1) + B(1, -1) + B(-1, 1) + B(1, 1)) >> 2;
+            int horiz = (B(-1, 0) + B(1, 0)) >> 1;
+            int vert  = (B(0, -1) + B(0, 1)) >> 1;
+            int r, g, b;
+
+            if (!(y & 1) && !(x & 1)) {
+                r = B(0, 0); g = cross; b = diag;
+            } else if (!(y & 1)) {
+                r = horiz;   g = B(0, 0); b = vert;
+            } else if (!(x & 1)) {
+                r = vert;    g = B(0, 0); b = horiz;
+            } else {
+                r = diag;    g = cross;   b = B(0, 0);
+            }
+#undef B
+            if (AV_RN16(rgb->data[0] + y * rgb->linesize[0] + 2 * x) != g ||
+                AV_RN16(rgb->data[1] + y * rgb->linesize[1] + 2 * x) != b ||
+                AV_RN16(rgb->data[2] + y * rgb->linesize[2] + 2 * x) != r) {
+                av_log(NULL, AV_LOG_ERROR, "Mismatch at %d,%d\n", x, y);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    static const int threads[] = { 1, 3 };
+    AVPacket *pkt = encode_frame();
+    AVFrame *ref, *rgb;
+    int ret = 0;
+
+    if (!pkt)
+        return 1;
+
+    ref = decode_frame(pkt, 0, 1);
+    if (!ref) {
+        av_packet_free(&pkt);
+        return 1;
+    }
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(threads); i++) {
+        rgb = decode_frame(pkt, 1, threads[i]);
+        if (!rgb || check_demosaic(ref, rgb)) {
+            av_log(NULL, AV_LOG_ERROR, "Demosaic with %d threads failed\n", threads[i]);
+            ret = 1;
+        }
+        av_frame_free(&rgb);
+    }
+
+    av_frame_free(&ref);
+    av_packet_free(&pkt);
+    return ret;
+}
@@ -0,0 +1,224 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Frame threading low delay test.
+ * Encodes an MPEG-4 stream with B-frames and decodes it with frame threads,
+ * with and without AV_CODEC_FLAG2_THREAD_LOW_DELAY. Both modes must return
+ * the same frames in the same order, and the low delay mode must not return
+ * the first frame later than the default mode.
+ */
+
+#include <stdio.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/adler32.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+
+#define WIDTH      176
+#define HEIGHT     144
+#define NB_FRAMES  30
+#define NB_THREADS 4
+
+typedef struct DecodedFrame {
+    int64_t  pts;
+    uint32_t checksum;
+} DecodedFrame;
+
+static int encode_stream(AVPacket **pkts, int *nb_pkts)
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    AVCodecContext *ctx = NULL;
+    AVFrame *frame = NULL;
+    int ret = AVERROR(ENOMEM);
+
+    *nb_pkts = 0;
+    if (!codec)
+        return AVERROR_ENCODER_NOT_FOUND;
+    ctx   = avcodec_alloc_context3(codec);
+    frame = av_frame_alloc();
+    if (!ctx || !frame)
+        goto end;
+
+    ctx->width        = WIDTH;
+    ctx->height       = HEIGHT;
+    ctx->pix_fmt      = AV_PIX_FMT_YUV420P;
+    ctx->time_base    = (AVRational){ 1, 25 };
+    ctx->gop_size     = 12;
+    ctx->max_b_frames = 2;
+    ctx->flags       |= AV_CODEC_FLAG_BITEXACT;
+    if ((ret = avcodec_open2(ctx, codec, NULL)) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Can't open encoder\n");
+        goto end;
+    }
+
+    frame->format = ctx->pix_fmt;
+    frame->width  = ctx->width;
+    frame->height = ctx->height;
+    if ((ret = av_frame_get_buffer(frame, 0)) < 0)
+        goto end;
+
+    for (int i = 0; i <= NB_FRAMES; i++) {
+        if (i < NB_FRAMES) {
+            if ((ret = av_frame_make_writable(frame)) < 0)
+                goto end;
+            for (int p = 0; p < 3; p++) {
+                int w = p ? WIDTH  / 2 : WIDTH;
+                int h = p ? HEIGHT / 2 : HEIGHT;
+                for (int y = 0; y < h; y++)
+                    for (int x = 0; x < w; x++)
+                        frame->data[p][y * frame->linesize[p] + x] =
+                            p * 64 + x + y * 3 + i * (p + 2);
+            }
+            frame->pts = i;
+        }
+        ret = avcodec_send_frame(ctx, i < NB_FRAMES ? frame : NULL);
+        if (ret < 0)
+            goto end;
+
+        while (1) {
+            AVPacket *pkt = av_packet_alloc();
+
+            if (!pkt) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            ret = avcodec_receive_packet(ctx, pkt);
+            if (ret < 0) {
+                av_packet_free(&pkt);
+                break;
+            }
+            pkts[(*nb_pkts)++] = pkt;
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            goto end;
+    }
+    ret = 0;
+
+end:
+    avcodec_free_context(&ctx);
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int receive_frames(AVCodecContext *ctx, AVFrame *frame,
+                          DecodedFrame *out, int *nb_out)
+{
+    int ret;
+
+    while ((ret = avcodec_receive_frame(ctx, frame)) >= 0) {
+        uint32_t checksum = 0;
+
+        if (*nb_out >= NB_FRAMES) {
+            av_log(NULL, AV_LOG_ERROR, "Too many frames\n");
+            return AVERROR(EINVAL);
+        }
+        for (int p = 0; p < 3; p++) {
+            int w = p ? WIDTH  / 2 : WIDTH;
+            int h = p ? HEIGHT / 2 : HEIGHT;
+            for (int y = 0; y < h; y++)
+                checksum = av_adler32_update(checksum, frame->data[p] + y * frame->linesize[p], w);
+        }
+        out[*nb_out].pts      = frame->pts;
+        out[*nb_out].checksum = checksum;
+        (*nb_out)++;
+        av_frame_unref(frame);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int decode_stream(AVPacket **pkts, int nb_pkts, int flags2,
+                         DecodedFrame *out, int *nb_out, int *first_delay)
+{
+    const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_MPEG4);
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    int ret = AVERROR(ENOMEM);
+
+    *nb_out = 0;
+    *first_delay = -1;
+    if (!ctx || !frame)
+        goto end;
+
+    ctx->thread_count = NB_THREADS;
+    ctx->thread_type  = FF_THREAD_FRAME;
+    ctx->flags2      |= flags2;
+    ctx->flags       |= AV_CODEC_FLAG_BITEXACT;
+    if ((ret = avcodec_open2(ctx, codec, NULL)) < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Can't open decoder\n");
+        goto end;
+    }
+
+    for (int i = 0; i <= nb_pkts; i++) {
+        ret = avcodec_send_packet(ctx, i < nb_pkts ? pkts[i] : NULL);
+        if (ret < 0)
+            goto end;
+        if ((ret = receive_frames(ctx, frame, out, nb_out)) < 0)
+            goto end;
+        if (*nb_out && *first_delay < 0)
+            *first_delay = i + 1;
+    }
+
+end:
+    avcodec_free_context(&ctx);
+    av_frame_free(&frame);
+    return ret;
+}
+
+int main(void)
+{
+    AVPacket *pkts[NB_FRAMES + 1] = { NULL };
+    DecodedFrame ref[NB_FRAMES], low[NB_FRAMES];
+    int nb_pkts, nb_ref, nb_low, delay_ref, delay_low;
+    int ret;
+
+    ret = encode_stream(pkts, &nb_pkts);
+    if (ret >= 0)
+        ret = decode_stream(pkts, nb_pkts, 0, ref, &nb_ref, &delay_ref);
+    if (ret >= 0)
+        ret = decode_stream(pkts, nb_pkts, AV_CODEC_FLAG2_THREAD_LOW_DELAY,
+                            low, &nb_low, &delay_low);
+    for (int i = 0; i < nb_pkts; i++)
+        av_packet_free(&pkts[i]);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Coding failed: %s\n", av_err2str(ret));
+        return 1;
+    }
+
+    if (nb_ref != NB_FRAMES || nb_low != nb_ref) {
+        av_log(NULL, AV_LOG_ERROR, "%d frames in low delay mode, %d in default mode, %d expected\n",
+               nb_low, nb_ref, NB_FRAMES);
+        return 1;
+    }
+    for (int i = 0; i < nb_ref; i++) {
+        if (ref[i].pts != low[i].pts || ref[i].checksum != low[i].checksum) {
+            av_log(NULL, AV_LOG_ERROR, "Frame %d differs: pts %"PRId64"/%"PRId64" "
+                   "checksum %08"PRIx32"/%08"PRIx32"\n", i, low[i].pts, ref[i].pts,
+                   low[i].checksum, ref[i].checksum);
+            return 1;
+        }
+    }
+    if (delay_low > delay_ref) {
+        av_log(NULL, AV_LOG_ERROR, "First frame after %d packets in low delay mode, "
+               "%d in default mode\n", delay_low, delay_ref);
+        return 1;
+    }
+
+    return 0;
+}
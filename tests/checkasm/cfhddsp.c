@@ -0,0 +1,161 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+
+#include "libavcodec/cfhddsp.h"
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#define WIDTH  68
+#define HEIGHT 4
+#define BAYER_LINESIZE FFALIGN(WIDTH * 2, 64)
+#define NB_PEAKS 24
+
+static void check_difference_coding(CFHDDSPContext *c)
+{
+    LOCAL_ALIGNED_32(int16_t, band0, [WIDTH * HEIGHT]);
+    LOCAL_ALIGNED_32(int16_t, band1, [WIDTH * HEIGHT]);
+
+    declare_func(void, int16_t *band, int width, int height);
+
+    if (check_func(c->difference_coding, "difference_coding")) {
+        for (int i = 0; i < 4; i++) {
+            int width = 1 + rnd() % WIDTH;
+
+            for (int j = 0; j < WIDTH * HEIGHT; j++)
+                band0[j] = band1[j] = rnd();
+
+            call_ref(band0, width, HEIGHT);
+            call_new(band1, width, HEIGHT);
+            if (memcmp(band0, band1, WIDTH * HEIGHT * sizeof(*band0)))
+                fail();
+        }
+        bench_new(band1, WIDTH, HEIGHT);
+    }
+}
+
+static void check_peak_table(CFHDDSPContext *c)
+{
+    LOCAL_ALIGNED_32(int16_t, band0, [WIDTH * HEIGHT]);
+    LOCAL_ALIGNED_32(int16_t, band1, [WIDTH * HEIGHT]);
+    uint8_t peaks[2 * NB_PEAKS];
+
+    declare_func(int, int16_t *band, int length, int threshold,
+                 const uint8_t *peaks, int nb_peaks);
+
+    if (check_func(c->peak_table, "peak_table")) {
+        static const int thresholds[] = { 1, 50, 4000, 32768 };
+
+        for (int i = 0; i < 2 * NB_PEAKS; i++)
+            peaks[i] = rnd();
+
+        for (int i = 0; i < FF_ARRAY_ELEMS(thresholds); i++) {
+            int length   = rnd() % (WIDTH * HEIGHT + 1);
+            int nb_peaks = rnd() % (NB_PEAKS + 1);
+            int ret0, ret1;
+
+            /* mostly small values with a few peaks, as in real bands */
+            for (int j = 0; j < WIDTH * HEIGHT; j++) {
+                int v = rnd() % 16 ? (int)(rnd() % 129) - 64 : (int16_t)rnd();
+                band0[j] = band1[j] = v;
+            }
+            band0[0] = band1[0] = INT16_MIN;
+
+            ret0 = call_ref(band0, length, thresholds[i], peaks, nb_peaks);
+            ret1 = call_new(band1, length, thresholds[i], peaks, nb_peaks);
+            if (ret0 != ret1 ||
+                memcmp(band0, band1, WIDTH * HEIGHT * sizeof(*band0)))
+                fail();
+        }
+        bench_new(band1, WIDTH * HEIGHT, 4000, peaks, NB_PEAKS);
+    }
+}
+
+static void check_process_alpha(CFHDDSPContext *c)
+{
+    LOCAL_ALIGNED_32(int16_t, alpha0, [WIDTH]);
+    LOCAL_ALIGNED_32(int16_t, alpha1, [WIDTH]);
+
+    declare_func(void, int16_t *alpha, int width);
+
+    if (check_func(c->process_alpha, "process_alpha")) {
+        for (int i = 0; i < 4; i++) {
+            int width = rnd() % (WIDTH + 1);
+
+            for (int j = 0; j < WIDTH; j++)
+                alpha0[j] = alpha1[j] = rnd() & 0xfff;
+
+            call_ref(alpha0, width);
+            call_new(alpha1, width);
+            if (memcmp(alpha0, alpha1, WIDTH * sizeof(*alpha0)))
+                fail();
+        }
+        bench_new(alpha1, WIDTH);
+    }
+}
+
+static void check_process_bayer(CFHDDSPContext *c)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BAYER_LINESIZE * HEIGHT * 2]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BAYER_LINESIZE * HEIGHT * 2]);
+
+    declare_func(void, uint16_t *dst, ptrdiff_t linesize,
+                 int width, int height, int bpc);
+
+    for (int bpc = 10; bpc <= 12; bpc += 2) {
+        if (check_func(c->process_bayer, "process_bayer_%d", bpc)) {
+            int width = 2 + 2 * (rnd() % (WIDTH / 2));
+
+            for (int i = 0; i < BAYER_LINESIZE * HEIGHT * 2; i += 2)
+                AV_WN16A(buf0 + i, rnd() & ((1 << bpc) - 1));
+            memcpy(buf1, buf0, BAYER_LINESIZE * HEIGHT * 2);
+
+            call_ref((uint16_t *)buf0, BAYER_LINESIZE, width, HEIGHT, bpc);
+            call_new((uint16_t *)buf1, BAYER_LINESIZE, width, HEIGHT, bpc);
+            for (int y = 0; y < HEIGHT * 2; y++)
+                if (memcmp(buf0 + y * BAYER_LINESIZE, buf1 + y * BAYER_LINESIZE,
+                           width * sizeof(uint16_t)))
+                    fail();
+            bench_new((uint16_t *)buf1, BAYER_LINESIZE, WIDTH, HEIGHT, bpc);
+        }
+    }
+}
+
+void checkasm_check_cfhddsp(void)
+{
+    CFHDDSPContext c;
+
+    ff_cfhddsp_init(&c, 12, 0);
+
+    check_difference_coding(&c);
+    report("difference_coding");
+
+    check_peak_table(&c);
+    report("peak_table");
+
+    check_process_alpha(&c);
+    report("process_alpha");
+
+    check_process_bayer(&c);
+    report("process_bayer");
+}
@@ -90,6 +90,9 @@ static const struct {
     #if CONFIG_BSWAPDSP
         { "bswapdsp", checkasm_check_bswapdsp },
     #endif
+    #if CONFIG_CFHD_DECODER
+        { "cfhddsp", checkasm_check_cfhddsp },
+    #endif
     #if CONFIG_DCA_DECODER
         { "synth_filter", checkasm_check_synth_filter },
     #endif
@@ -191,6 +194,13 @@ static const struct {
     #if CONFIG_THRESHOLD_FILTER
         { "vf_threshold", checkasm_check_vf_threshold },
     #endif
+    #if CONFIG_V360_FILTER
+        { "vf_v360", checkasm_check_vf_v360 },
+    #endif
+#endif
+#if CONFIG_SWRESAMPLE
+    { "sw_rematrix", checkasm_check_sw_rematrix },
+    { "sw_resample", checkasm_check_sw_resample },
 #endif
 #if CONFIG_SWSCALE
     { "sw_gbrp", checkasm_check_sw_gbrp },
@@ -0,0 +1,172 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/opt.h"
+
+#include "libswresample/swresample.h"
+#include "libswresample/swresample_internal.h"
+
+#include "checkasm.h"
+
+#define LEN     256
+#define MAX_IN  8
+#define NB_OUT  2
+
+static SwrContext *init_context(enum AVSampleFormat fmt, int nb_in)
+{
+    AVChannelLayout in_layout  = { .order = AV_CHANNEL_ORDER_UNSPEC, .nb_channels = nb_in  };
+    AVChannelLayout out_layout = { .order = AV_CHANNEL_ORDER_UNSPEC, .nb_channels = NB_OUT };
+    double matrix[NB_OUT][MAX_IN];
+    SwrContext *s = NULL;
+
+    /* every output mixes more than two inputs, the second one skips the
+     * first input so that both odd and even counts are tested */
+    for (int i = 0; i < NB_OUT; i++) {
+        for (int j = 0; j < nb_in; j++) {
+            double v = (int)(rnd() % 2001 - 1000) / 1000.0;
+            matrix[i][j] = v ? v : 0.5;
+        }
+    }
+    if (nb_in > 3)
+        matrix[1][0] = 0;
+
+    if (swr_alloc_set_opts2(&s, &out_layout, fmt, 48000,
+                            &in_layout, fmt, 48000, 0, NULL) < 0 ||
+        av_opt_set_sample_fmt(s, "internal_sample_fmt", fmt, 0) < 0 ||
+        swr_set_matrix(s, matrix[0], MAX_IN) < 0 ||
+        swr_init(s) < 0)
+        swr_free(&s);
+
+    return s;
+}
+
+static void randomize_input(uint8_t *src, enum AVSampleFormat fmt)
+{
+    for (int i = 0; i < LEN; i++) {
+        if (fmt == AV_SAMPLE_FMT_FLTP)
+            ((float *)src)[i] = (float)rnd() / (UINT_MAX >> 1) - 1.0f;
+        else // small enough to not overflow the 32-bit sums, but still clip
+            ((int16_t *)src)[i] = (int)(rnd() % 8192) - 4096;
+    }
+}
+
+/* the int16 kernels use the scaled coefficients and shift of the
+ * native_simd_matrix, as the other int16 mix functions do */
+static void mix_n_1_int16_ref(SwrContext *s, int16_t *out, uint8_t **in,
+                              int nb_in, int out_i)
+{
+    const int16_t *coeffs = (const int16_t *)s->native_simd_matrix;
+
+    for (int i = 0; i < LEN; i++) {
+        int64_t v = 0;
+        int shift = 0;
+
+        for (int j = 0; j < s->matrix_ch[out_i][0]; j++) {
+            int in_i = s->matrix_ch[out_i][1 + j];
+            v    += ((const int16_t *)in[in_i])[i] * coeffs[2 * (out_i * nb_in + in_i)];
+            shift = coeffs[2 * (out_i * nb_in + in_i) + 1];
+        }
+        out[i] = av_clip_int16((v + (1 << shift >> 1)) >> shift);
+    }
+}
+
+static void check_mix_n_1(enum AVSampleFormat fmt, const char *name)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [MAX_IN], [LEN * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [NB_OUT], [LEN * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [NB_OUT], [LEN * 4]);
+
+    declare_func(void, void *out, const uint8_t **in, void *coeffp,
+                 integer nb_in, integer len);
+
+    for (int nb_in = 3; nb_in <= MAX_IN; nb_in++) {
+        SwrContext *s = init_context(fmt, nb_in);
+
+        if (!s) {
+            fail();
+            return;
+        }
+
+        if (check_func(s->mix_n_1_simd, "mix_n_1_%s_%d", name, nb_in)) {
+            AudioData in  = { .ch_count = nb_in,  .bps = av_get_bytes_per_sample(fmt) };
+            AudioData out = { .ch_count = NB_OUT, .bps = av_get_bytes_per_sample(fmt) };
+
+            for (int i = 0; i < nb_in; i++) {
+                randomize_input(src[i], fmt);
+                in.ch[i] = src[i];
+            }
+            for (int i = 0; i < NB_OUT; i++) {
+                memset(dst0[i], 0, LEN * 4);
+                memset(dst1[i], 0, LEN * 4);
+                out.ch[i] = dst0[i];
+            }
+
+            if (fmt == AV_SAMPLE_FMT_FLTP) {
+                /* the C loop of swri_rematrix() */
+                mix_n_1_func_type *mix_n_1_simd = s->mix_n_1_simd;
+                mix_1_1_func_type *mix_1_1_simd = s->mix_1_1_simd;
+                mix_2_1_func_type *mix_2_1_simd = s->mix_2_1_simd;
+
+                s->mix_n_1_simd = NULL;
+                s->mix_1_1_simd = NULL;
+                s->mix_2_1_simd = NULL;
+                swri_rematrix(s, &out, &in, LEN, 1);
+                s->mix_n_1_simd = mix_n_1_simd;
+                s->mix_1_1_simd = mix_1_1_simd;
+                s->mix_2_1_simd = mix_2_1_simd;
+            } else {
+                for (int i = 0; i < NB_OUT; i++)
+                    mix_n_1_int16_ref(s, (int16_t *)dst0[i], in.ch, nb_in, i);
+            }
+
+            for (int i = 0; i < NB_OUT; i++) {
+                /* set up as in swri_rematrix(), in[nb] pads odd counts */
+                const uint8_t *ins[MAX_IN + 1];
+                uint8_t *coeffp = s->native_simd_matrix_n + 4 * (nb_in + 1) * i;
+                int nb = s->matrix_ch[i][0];
+                int j;
+
+                for (j = 0; j < nb; j++)
+                    ins[j] = in.ch[s->matrix_ch[i][1 + j]];
+                ins[j] = ins[0];
+
+                call_new(dst1[i], ins, coeffp, nb, LEN);
+                if (memcmp(dst0[i], dst1[i], LEN * out.bps))
+                    fail();
+
+                if (i == 0)
+                    bench_new(dst1[i], ins, coeffp, nb, LEN);
+            }
+        }
+
+        swr_free(&s);
+    }
+}
+
+void checkasm_check_sw_rematrix(void)
+{
+    check_mix_n_1(AV_SAMPLE_FMT_FLTP, "float");
+    report("mix_n_1_float");
+
+    check_mix_n_1(AV_SAMPLE_FMT_S16P, "int16");
+    report("mix_n_1_int16");
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/samplefmt.h"
+
+#include "libswresample/resample.h"
+#include "libswresample/swresample_internal.h"
+
+#include "checkasm.h"
+
+#define SRC_LEN 1024
+#define DST_LEN 2048
+#define PAD_LEN (SWR_RESAMPLE_TAP_ALIGN - 1)
+
+static const int rates[][2] = {
+    { 44100, 48000 },
+    { 48000, 44100 },
+    { 96000, 48000 },
+    { 96000, 44100 },
+};
+
+static void randomize_src(uint8_t *src, enum AVSampleFormat fmt)
+{
+    int i;
+
+    switch (fmt) {
+    case AV_SAMPLE_FMT_S16P:
+    case AV_SAMPLE_FMT_S32P:
+        // full scale, so that the outputs get clipped
+        for (i = 0; i < SRC_LEN * av_get_bytes_per_sample(fmt); i += 4)
+            AV_WN32A(src + i, rnd());
+        break;
+    case AV_SAMPLE_FMT_FLTP:
+        for (i = 0; i < SRC_LEN; i++)
+            ((float *)src)[i] = (float)rnd() / (UINT_MAX >> 1) - 1.0f;
+        break;
+    case AV_SAMPLE_FMT_DBLP:
+        for (i = 0; i < SRC_LEN; i++)
+            ((double *)src)[i] = (double)rnd() / (UINT_MAX >> 1) - 1.0;
+        break;
+    }
+}
+
+static int compare_dst(const uint8_t *dst0, const uint8_t *dst1, int n,
+                       enum AVSampleFormat fmt)
+{
+    switch (fmt) {
+    case AV_SAMPLE_FMT_FLTP:
+        return float_near_abs_eps_array((const float *)dst0, (const float *)dst1,
+                                        1e-5f, n);
+    case AV_SAMPLE_FMT_DBLP:
+        return double_near_abs_eps_array((const double *)dst0, (const double *)dst1,
+                                         1e-12, n);
+    default:
+        return !memcmp(dst0, dst1, n * av_get_bytes_per_sample(fmt));
+    }
+}
+
+static void check_resample_fmt(enum AVSampleFormat fmt, const char *name)
+{
+    // the filter lengths are not multiples of SWR_RESAMPLE_TAP_ALIGN
+    static const int filter_sizes[] = { 8, 16 };
+    LOCAL_ALIGNED_32(uint8_t, src,  [(SRC_LEN + PAD_LEN) * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_LEN * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_LEN * 8]);
+    int bps = av_get_bytes_per_sample(fmt);
+    int linear, i, j;
+
+    declare_func(int, ResampleContext *c, void *dst, const void *src,
+                 int n, int update_ctx);
+
+    for (linear = 0; linear < 2; linear++) {
+        for (i = 0; i < FF_ARRAY_ELEMS(rates); i++) {
+            for (j = 0; j < FF_ARRAY_ELEMS(filter_sizes); j++) {
+                ResampleContext *c, c0, c1;
+                int64_t end_index, delta_frac;
+                int ret0, ret1, n;
+
+                c = swri_resampler.init(NULL, rates[i][1], rates[i][0], filter_sizes[j],
+                                        10, linear, 0.97, fmt, SWR_FILTER_TYPE_KAISER,
+                                        9, 0, 0, 0);
+                if (!c) {
+                    fail();
+                    return;
+                }
+                if (!(c->filter_length % SWR_RESAMPLE_TAP_ALIGN))
+                    fail();
+
+                if (check_func(linear ? c->dsp.resample_linear : c->dsp.resample_common,
+                               "resample_%s_%s_%d_%d_%d", linear ? "linear" : "common",
+                               name, rates[i][0], rates[i][1], filter_sizes[j])) {
+                    randomize_src(src, fmt);
+                    /* Only the padding swresample guarantees follows the input.
+                     * Fill it with NaNs or full scale values: the taps the SIMD
+                     * functions read beyond filter_length are zero, so they must
+                     * not change the output. */
+                    memset(src + SRC_LEN * bps, 0xff, PAD_LEN * bps);
+                    memset(dst0, 0, DST_LEN * 8);
+                    memset(dst1, 0, DST_LEN * 8);
+                    c->index = rnd() % c->phase_count;
+                    c->frac  = rnd() % c->src_incr;
+
+                    // as many outputs as multiple_resample() makes of SRC_LEN
+                    // samples, so the last window ends at the last sample
+                    end_index  = (1LL + SRC_LEN - c->filter_length) * c->phase_count;
+                    delta_frac = (end_index - c->index) * c->src_incr - c->frac;
+                    n = FFMIN((delta_frac + c->dst_incr - 1) / c->dst_incr, DST_LEN);
+                    c0 = c1 = *c;
+
+                    ret0 = call_ref(&c0, dst0, src, n, 1);
+                    ret1 = call_new(&c1, dst1, src, n, 1);
+                    if (ret0 != ret1 || c0.index != c1.index || c0.frac != c1.frac ||
+                        !compare_dst(dst0, dst1, n, fmt))
+                        fail();
+
+                    bench_new(&c1, dst1, src, n, 0);
+                }
+
+                swri_resampler.free(&c);
+            }
+        }
+    }
+}
+
+void checkasm_check_sw_resample(void)
+{
+    check_resample_fmt(AV_SAMPLE_FMT_S16P, "s16");
+    report("resample_s16");
+
+    check_resample_fmt(AV_SAMPLE_FMT_S32P, "s32");
+    report("resample_s32");
+
+    check_resample_fmt(AV_SAMPLE_FMT_FLTP, "flt");
+    report("resample_flt");
+
+    check_resample_fmt(AV_SAMPLE_FMT_DBLP, "dbl");
+    report("resample_dbl");
+}
@@ -0,0 +1,138 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/v360.h"
+#include "libavutil/mem_internal.h"
+
+#define WIDTH 64
+#define SRC_WIDTH 96
+#define SRC_HEIGHT 64
+#define SRC_STRIDE (SRC_WIDTH * 2 + 32)
+
+#define randomize_buffers(buf, size)      \
+    do {                                  \
+        int j;                            \
+        uint8_t *tmp_buf = (uint8_t *)buf;\
+        for (j = 0; j < size; j++)        \
+            tmp_buf[j] = rnd() & 0xFF;    \
+    } while (0)
+
+/* 1D weights of the interpolators sharing a window size, see vf_v360.c */
+static void calc_coeffs(int ws, float t, float *coeffs)
+{
+    switch (ws) {
+    case 1:
+        coeffs[0] = 1.f;
+        break;
+    case 2:
+        coeffs[0] = 1.f - t;
+        coeffs[1] = t;
+        break;
+    case 3:
+        coeffs[0] = (t - 1.f) * (t - 2.f) * 0.5f;
+        coeffs[1] = -t * (t - 2.f);
+        coeffs[2] =  t * (t - 1.f) * 0.5f;
+        break;
+    case 4:
+        coeffs[0] =     - t / 3.f + t * t / 2.f - t * t * t / 6.f;
+        coeffs[1] = 1.f - t / 2.f - t * t       + t * t * t / 2.f;
+        coeffs[2] =       t       + t * t / 2.f - t * t * t / 2.f;
+        coeffs[3] =     - t / 6.f               + t * t * t / 6.f;
+        break;
+    }
+}
+
+static void init_remap(int ws, int16_t *u, int16_t *v, int16_t *ker)
+{
+    for (int x = 0; x < WIDTH; x++) {
+        const int x0 = rnd() % (SRC_WIDTH  - ws);
+        const int y0 = rnd() % (SRC_HEIGHT - ws);
+        float du[4], dv[4];
+
+        calc_coeffs(ws, (rnd() & 0xFFFF) / 65536.f, du);
+        calc_coeffs(ws, (rnd() & 0xFFFF) / 65536.f, dv);
+
+        for (int i = 0; i < ws; i++) {
+            for (int j = 0; j < ws; j++) {
+                u[i * ws + j] = x0 + j;
+                v[i * ws + j] = y0 + i;
+                ker[i * ws + j] = lrintf(du[j] * dv[i] * 16385.f);
+            }
+        }
+
+        u   += ws * ws;
+        v   += ws * ws;
+        ker += ws * ws;
+    }
+}
+
+static void check_remap(int interp, int ws, int depth)
+{
+    LOCAL_ALIGNED_32(uint8_t,  src,     [SRC_STRIDE * SRC_HEIGHT + 32]);
+    LOCAL_ALIGNED_32(uint8_t,  dst_ref, [WIDTH * 2 + 32]);
+    LOCAL_ALIGNED_32(uint8_t,  dst_new, [WIDTH * 2 + 32]);
+    LOCAL_ALIGNED_32(int16_t,  u,       [WIDTH * 16 + 16]);
+    LOCAL_ALIGNED_32(int16_t,  v,       [WIDTH * 16 + 16]);
+    LOCAL_ALIGNED_32(int16_t,  ker,     [WIDTH * 16 + 16]);
+    const int bytes = depth >> 3;
+    V360Context s = { .interp = interp };
+
+    declare_func(void, uint8_t *dst, int width, const uint8_t *const src,
+                 ptrdiff_t in_linesize, const int16_t *const u,
+                 const int16_t *const v, const int16_t *const ker);
+
+    memset(u,   0, (WIDTH * 16 + 16) * sizeof(*u));
+    memset(v,   0, (WIDTH * 16 + 16) * sizeof(*v));
+    memset(ker, 0, (WIDTH * 16 + 16) * sizeof(*ker));
+    randomize_buffers(src, SRC_STRIDE * SRC_HEIGHT + 32);
+    init_remap(ws, u, v, ker);
+
+    ff_v360_init(&s, depth);
+
+    if (check_func(s.remap_line, "remap%d_%dbit_line", ws, depth)) {
+        memset(dst_ref, 0, WIDTH * 2 + 32);
+        memset(dst_new, 0, WIDTH * 2 + 32);
+        call_ref(dst_ref, WIDTH, src, SRC_STRIDE, u, v, ker);
+        call_new(dst_new, WIDTH, src, SRC_STRIDE, u, v, ker);
+        if (memcmp(dst_ref, dst_new, WIDTH * bytes))
+            fail();
+        bench_new(dst_new, WIDTH, src, SRC_STRIDE, u, v, ker);
+    }
+}
+
+void checkasm_check_vf_v360(void)
+{
+    static const struct {
+        int interp, ws;
+    } tests[] = {
+        { NEAREST,   1 },
+        { BILINEAR,  2 },
+        { LAGRANGE9, 3 },
+        { BICUBIC,   4 },
+    };
+    static const int depths[] = { 8, 16 };
+
+    for (int d = 0; d < FF_ARRAY_ELEMS(depths); d++) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++)
+            check_remap(tests[i].interp, tests[i].ws, depths[d]);
+    }
+    report("remap_line");
+}
@@ -1,3 +1,8 @@
+FATE_API_LIBAVCODEC-$(call ALLYES, CFHD_ENCODER CFHD_DECODER) += fate-api-cfhd-demosaic
+fate-api-cfhd-demosaic: $(APITESTSDIR)/api-cfhd-demosaic-test$(EXESUF)
+fate-api-cfhd-demosaic: CMD = run $(APITESTSDIR)/api-cfhd-demosaic-test$(EXESUF)
+fate-api-cfhd-demosaic: CMP = null
+
 FATE_API_LIBAVCODEC-$(call ENCDEC, FLAC, FLAC) += fate-api-flac
 fate-api-flac: $(APITESTSDIR)/api-flac-test$(EXESUF)
 fate-api-flac: CMD = run $(APITESTSDIR)/api-flac-test$(EXESUF)
@@ -27,6 +32,11 @@ fate-api-threadmessage: $(APITESTSDIR)/api-threadmessage-test$(EXESUF)
 fate-api-threadmessage: CMD = run $(APITESTSDIR)/api-threadmessage-test$(EXESUF) 3 10 30 50 2 20 40
 fate-api-threadmessage: CMP = null
 
+FATE_API_LIBAVCODEC-$(call ALLYES, MPEG4_ENCODER MPEG4_DECODER) += fate-api-thread-low-delay
+fate-api-thread-low-delay: $(APITESTSDIR)/api-thread-low-delay-test$(EXESUF)
+fate-api-thread-low-delay: CMD = run $(APITESTSDIR)/api-thread-low-delay-test$(EXESUF)
+fate-api-thread-low-delay: CMP = null
+
 FATE_API_SAMPLES-$(CONFIG_AVFORMAT) += $(FATE_API_SAMPLES_LIBAVFORMAT-yes)
 
 ifdef SAMPLES
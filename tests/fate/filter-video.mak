@@ -197,6 +197,21 @@ FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_HSTACK_FILTER) += fate-filter-hstack
 fate-filter-hstack: tests/data/filtergraphs/hstack
 fate-filter-hstack: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/hstack
 
+# the larger output ends first, the smaller one is still scaled from it
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, MULTISCALE_FILTER TRIM_FILTER) += fate-filter-multiscale
+fate-filter-multiscale: tests/data/filtergraphs/multiscale
+fate-filter-multiscale: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/multiscale -map "[a5]" -map "[b10]"
+
+# -multiscale puts the first two outputs in one multiscale filter, the
+# third one wants another pixel format and keeps its own scale filter
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, MULTISCALE_FILTER SCALE_FILTER FORMAT_FILTER) += fate-filter-multiscale-auto
+fate-filter-multiscale-auto: CMD = framecrc -c:v pgmyuv -i $(SRC) -multiscale -map 0:v -map 0:v -map 0:v -s:v:0 176x144 -s:v:1 88x72 -s:v:2 88x72 -pix_fmt:v:2 yuv444p -frames:v 5 -sws_flags +accurate_rnd+bitexact
+
+# slice-threaded filters and the scaler of one graph sharing a thread pool,
+# the output must not differ from running them on their own threads
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, HFLIP_FILTER SCALE_FILTER GBLUR_FILTER) += fate-filter-thread-pool
+fate-filter-thread-pool: CMD = framecrc -thread_pool 2 -filter_threads 4 -c:v pgmyuv -i $(SRC) -vf hflip,scale=88x72,gblur -frames:v 5 -sws_flags +accurate_rnd+bitexact
+
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_VSTACK_FILTER) += fate-filter-vstack
 fate-filter-vstack: tests/data/filtergraphs/vstack
 fate-filter-vstack: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/vstack
@@ -252,6 +267,13 @@ FATE_REMOVEGRAIN-$(call FILTERDEMDEC, REMOVEGRAIN, IMAGE2, PGMYUV) += $(FATE_REM
 fate-filter-removegrain: $(FATE_REMOVEGRAIN-yes)
 FATE_FILTER_VSYNTH-yes += $(FATE_REMOVEGRAIN-yes)
 
+# the YUV matrix changes, so the conversion is done by the vertical scaler
+FATE_SCALE_CMATRIX := yuv420p nv12 p010le
+FATE_SCALE_CMATRIX := $(addprefix fate-filter-scale-cmatrix-, $(FATE_SCALE_CMATRIX))
+$(FATE_SCALE_CMATRIX): FMT = $(word 5, $(subst -, ,$(@)))
+$(FATE_SCALE_CMATRIX): CMD = framecrc -c:v pgmyuv -i $(SRC) -frames:v 5 -vf scale,format=yuv420p10le,scale=176:144:in_color_matrix=bt2020:out_color_matrix=bt709,format=$(FMT) -sws_flags +accurate_rnd+bitexact
+FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, SCALE_FILTER FORMAT_FILTER) += $(FATE_SCALE_CMATRIX)
+
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_SEPARATEFIELDS_FILTER) += fate-filter-separatefields
 fate-filter-separatefields: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf separatefields
 
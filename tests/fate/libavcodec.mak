@@ -60,6 +60,11 @@ FATE_LIBAVCODEC-$(CONFIG_IIRFILTER) += fate-iirfilter
 fate-iirfilter: libavcodec/tests/iirfilter$(EXESUF)
 fate-iirfilter: CMD = run libavcodec/tests/iirfilter$(EXESUF)
 
+FATE_LIBAVCODEC-$(CONFIG_PCM_S16LE_DECODER) += fate-decode-packets
+fate-decode-packets: libavcodec/tests/decode_packets$(EXESUF)
+fate-decode-packets: CMD = run libavcodec/tests/decode_packets$(EXESUF)
+fate-decode-packets: CMP = null
+
 FATE_LIBAVCODEC-$(CONFIG_MPEGVIDEO) += fate-mpeg12framerate
 fate-mpeg12framerate: libavcodec/tests/mpeg12framerate$(EXESUF)
 fate-mpeg12framerate: CMD = run libavcodec/tests/mpeg12framerate$(EXESUF)
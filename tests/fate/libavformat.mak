@@ -22,6 +22,10 @@ FATE_LIBAVFORMAT-$(CONFIG_MOV_MUXER) += fate-movenc
 fate-movenc: libavformat/tests/movenc$(EXESUF)
 fate-movenc: CMD = run libavformat/tests/movenc$(EXESUF)
 
+FATE_LIBAVFORMAT-$(CONFIG_MOV_DEMUXER) += fate-gpmf
+fate-gpmf: libavformat/tests/gpmf$(EXESUF)
+fate-gpmf: CMD = run libavformat/tests/gpmf$(EXESUF)
+
 FATE_LIBAVFORMAT-$(CONFIG_IMF_DEMUXER) += fate-imf
 fate-imf: libavformat/tests/imf$(EXESUF)
 fate-imf: CMD = run libavformat/tests/imf$(EXESUF)
@@ -0,0 +1,200 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Compare the time spent decoding a stream with avcodec_send_packet() and
+ * avcodec_receive_frame() to the time spent with avcodec_decode_packets().
+ * The packets are read into memory first, so that only decoding is timed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+
+#define MAX_PACKETS 100000
+
+static int decode_single(AVCodecContext *dec, AVPacket **pkts, int nb_pkts,
+                         AVFrame *frame, int *nb_frames)
+{
+    int ret;
+
+    for (int i = 0; i <= nb_pkts; i++) {
+        ret = avcodec_send_packet(dec, i < nb_pkts ? pkts[i] : NULL);
+        if (ret < 0)
+            return ret;
+
+        while ((ret = avcodec_receive_frame(dec, frame)) >= 0)
+            (*nb_frames)++;
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int decode_batch(AVCodecContext *dec, AVPacket **pkts, int nb_pkts,
+                        AVFrame **frames, int batch_size, int *nb_frames)
+{
+    /* the flush packet is the last entry of the array */
+    const AVPacket * const *in = (const AVPacket * const *)pkts;
+    int left = nb_pkts + 1;
+    int ret;
+
+    do {
+        int nb_in = FFMIN(left, batch_size), nb_out = batch_size;
+
+        ret = avcodec_decode_packets(dec, in, &nb_in, frames, &nb_out);
+        if (ret < 0 && ret != AVERROR_EOF)
+            return ret;
+        in         += nb_in;
+        left       -= nb_in;
+        *nb_frames += nb_out;
+    } while (ret != AVERROR_EOF);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *demuxer = NULL;
+    AVCodecContext *dec = NULL;
+    const AVCodec *codec;
+    AVPacket **pkts = NULL;
+    AVFrame **frames = NULL;
+    int nb_pkts = 0, stream_idx, batch_size, nb_runs;
+    int ret;
+
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <input file> <stream index> <batch size> [<runs>]\n",
+                argv[0]);
+        return 1;
+    }
+    stream_idx = strtol(argv[2], NULL, 0);
+    batch_size = strtol(argv[3], NULL, 0);
+    nb_runs    = argc > 4 ? strtol(argv[4], NULL, 0) : 10;
+    if (batch_size <= 0 || nb_runs <= 0)
+        return 1;
+
+    ret = avformat_open_input(&demuxer, argv[1], NULL, NULL);
+    if (ret < 0) {
+        fprintf(stderr, "Error opening input file: %d\n", ret);
+        return 1;
+    }
+    if (stream_idx < 0 || stream_idx >= demuxer->nb_streams) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    codec = avcodec_find_decoder(demuxer->streams[stream_idx]->codecpar->codec_id);
+    if (!codec) {
+        ret = AVERROR_DECODER_NOT_FOUND;
+        goto end;
+    }
+    dec = avcodec_alloc_context3(codec);
+    if (!dec) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avcodec_parameters_to_context(dec, demuxer->streams[stream_idx]->codecpar);
+    if (ret < 0)
+        goto end;
+    dec->thread_count = 1;
+    ret = avcodec_open2(dec, codec, NULL);
+    if (ret < 0)
+        goto end;
+
+    /* one extra NULL entry for the flush packet */
+    pkts   = av_calloc(MAX_PACKETS + 1, sizeof(*pkts));
+    frames = av_calloc(batch_size, sizeof(*frames));
+    if (!pkts || !frames) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (int i = 0; i < batch_size; i++) {
+        frames[i] = av_frame_alloc();
+        if (!frames[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
+    while (nb_pkts < MAX_PACKETS) {
+        AVPacket *pkt = av_packet_alloc();
+        if (!pkt) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = av_read_frame(demuxer, pkt);
+        if (ret < 0) {
+            av_packet_free(&pkt);
+            break;
+        }
+        if (pkt->stream_index != stream_idx) {
+            av_packet_free(&pkt);
+            continue;
+        }
+        pkts[nb_pkts++] = pkt;
+    }
+    if (!nb_pkts) {
+        fprintf(stderr, "No packets in stream %d\n", stream_idx);
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+
+    for (int batch = 0; batch < 2; batch++) {
+        int64_t best = INT64_MAX;
+        int nb_frames;
+
+        for (int run = 0; run < nb_runs; run++) {
+            int64_t start = av_gettime_relative();
+
+            nb_frames = 0;
+            ret = batch ? decode_batch(dec, pkts, nb_pkts, frames, batch_size, &nb_frames) :
+                          decode_single(dec, pkts, nb_pkts, frames[0], &nb_frames);
+            if (ret < 0) {
+                fprintf(stderr, "Error decoding: %s\n", av_err2str(ret));
+                goto end;
+            }
+            best = FFMIN(best, av_gettime_relative() - start);
+            avcodec_flush_buffers(dec);
+        }
+
+        printf("%-6s %d packets, %d frames: %8.1f ns per packet\n",
+               batch ? "batch" : "single", nb_pkts, nb_frames,
+               best * 1000.0 / nb_pkts);
+    }
+
+end:
+    for (int i = 0; i < nb_pkts; i++)
+        av_packet_free(&pkts[i]);
+    av_freep(&pkts);
+    for (int i = 0; frames && i < batch_size; i++)
+        av_frame_free(&frames[i]);
+    av_freep(&frames);
+    avcodec_free_context(&dec);
+    avformat_close_input(&demuxer);
+
+    return ret < 0;
+}